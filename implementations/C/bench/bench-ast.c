@@ -0,0 +1,586 @@
+/*
+ * @file bench-ast.c
+ *
+ * AstArena layout benchmark.
+ *
+ * A lexed and parsed theme corpus is copied into the layout the parser used
+ * before: 20-byte nodes with the source position inline and every operand,
+ * unary and binary ones included, behind a slot in `children`. The same
+ * tree in the 12-byte layout keeps unary, binary and declaration operands
+ * in the node as a distance back and its positions in a side table.
+ *
+ * 1. Check: both layouts give the same results in both traversals.
+ * 2. Arena size: node, position and child slot bytes of each layout, and
+ *    the bytes a walk that never reports an error has to touch.
+ * 3. Traversal: a recursive walk from the root that evaluates every node
+ *    as wrapping u32 arithmetic (the shape of a checker or folding pass),
+ *    and a linear scan of the node array for an operator histogram.
+ * 4. Evaluation: the same walk as one forward scan of the post-order
+ *    arena with a value stack, no recursion and no child lookups, against
+ *    recursive descent in both layouts; and what ast_linearize costs, for
+ *    an arena Parser_reparse left out of order.
+ * 5. Sharing: the theme and a design-token corpus (a few base variables
+ *    through `$space * 2`, `rgba(0, 0, 0, 128)`, `lighten($primary, 0.1)`
+ *    and the like, some declared again at the top or inline) parsed with
+ *    and without hash-consing. Nodes made and kept, arena bytes, parse
+ *    time, and a one-value-per-node evaluation of the DAG against the
+ *    post-order scan of the tree. ast_linearize of the DAG must be the
+ *    tree node for node, and reading names through their newest
+ *    declaration must give the same in both.
+ *
+ * Usage: bench-ast [corpus-bytes] [iterations]
+ */
+
+#include "bench.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../parser/nodes-get.h"
+#include "../constants/const-lexer.h"
+#include "../error/reporter.h"
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// OLD LAYOUT
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+typedef struct LegacyNode {
+    u16 kind;
+    u16 flags;
+    ChildId firstChild;
+    u8 childLength;
+    u32 data;           // OpCode for unary and binary nodes
+    u32 sourcePos;
+} LegacyNode;
+
+typedef struct LegacyArena {
+    LegacyNode* nodes;
+    NodeId* children;
+    u32 nodeLength;
+    u32 childLength;
+    NodeId root;
+} LegacyArena;
+
+// Same ids, every child behind a slot, as ast_addChild used to make them
+static LegacyArena _toLegacy(const AstArena* ast) {
+    u32 slots = 0;
+    for (NodeId id = 0; id < ast->nodeLength; id++) slots += ast_getChildCount(ast, id);
+
+    LegacyArena old = {
+        .nodes = malloc(ast->nodeLength * sizeof(LegacyNode)),
+        .children = malloc((slots + 1) * sizeof(NodeId)),
+        .nodeLength = ast->nodeLength,
+        .root = ast->root,
+    };
+
+    for (NodeId id = 0; id < ast->nodeLength; id++) {
+        const AstNode* n = &ast->nodes[id];
+        const u32 count = ast_getChildCount(ast, id);
+        const bool op = n->kind == NODE_UNARY || n->kind == NODE_BINARY;
+
+        old.nodes[id] = (LegacyNode){
+            .kind = n->kind,
+            .flags = n->flags,
+            .firstChild = old.childLength,
+            .childLength = (u8)(count < 0xFF ? count : 0xFF),
+            .data = op ? n->info : n->data,
+            .sourcePos = ast_getPos(ast, id),
+        };
+
+        for (u32 i = 0; i < count; i++) old.children[old.childLength++] = ast_getChildOf(ast, id, i);
+    }
+
+    return old;
+}
+
+static void _freeLegacy(const LegacyArena* old) {
+    free(old->nodes);
+    free(old->children);
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// TRAVERSALS
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// u32 arithmetic that wraps, the same per node work for both layouts
+static inline
+u32 _apply(const u32 op, const u32 l, const u32 r) {
+    switch (op) {
+        case OP_ADD: return l + r;
+        case OP_SUB: return l - r;
+        case OP_MUL: return l * r;
+        case OP_AND: return l & r;
+        case OP_OR: return l | r;
+        case OP_XOR: return l ^ r;
+        case OP_SHL: return l << (r & 31);
+        case OP_SHR: return l >> (r & 31);
+        case OP_LT: return l < r;
+        case OP_GT: return l > r;
+        default: return l * 31 + r + op;
+    }
+}
+
+static inline
+u32 _applyUnary(const u32 op, const u32 v) {
+    return op == OP_NEG ? 0u - v : op == OP_BNOT ? ~v : op == OP_NOT ? !v : v;
+}
+
+// Evaluates the tree from `id` down, every child visited once
+static u32 _evalLegacy(const LegacyArena* old, const NodeId id) {
+    const LegacyNode* n = &old->nodes[id];
+    const NodeId* c = &old->children[n->firstChild];
+
+    switch (n->kind) {
+        case NODE_BINARY: return _apply(n->data, _evalLegacy(old, c[0]), _evalLegacy(old, c[1]));
+        case NODE_UNARY: return _applyUnary(n->data, _evalLegacy(old, c[0]));
+        case NODE_DECL: return n->data ^ _evalLegacy(old, c[0]);
+        case NODE_TERNARY: {
+            const u32 a = _evalLegacy(old, c[0]), b = _evalLegacy(old, c[1]), e = _evalLegacy(old, c[2]);
+            return a ? b : e;
+        }
+        case NODE_ROOT:
+        case NODE_CALL: {
+            const u32 count = n->kind == NODE_ROOT ? n->data : n->childLength;
+            u32 v = n->data;
+            for (u32 i = 0; i < count; i++) v = v * 33 + _evalLegacy(old, c[i]);
+            return v;
+        }
+        default: return n->data;
+    }
+}
+
+static u32 _evalCompact(const AstArena* ast, const NodeId id) {
+    const AstNode* n = &ast->nodes[id];
+
+    switch (n->kind) {
+        case NODE_BINARY:
+            return _apply(n->info, _evalCompact(ast, id - n->operands[0]), _evalCompact(ast, id - n->operands[1]));
+        case NODE_UNARY: return _applyUnary(n->info, _evalCompact(ast, id - n->operands[1]));
+        case NODE_DECL: return n->data ^ _evalCompact(ast, id - n->operands[1]);
+        case NODE_TERNARY: {
+            const NodeId* c = &ast->children[n->firstChild];
+            const u32 a = _evalCompact(ast, c[0]), b = _evalCompact(ast, c[1]), e = _evalCompact(ast, c[2]);
+            return a ? b : e;
+        }
+        case NODE_ROOT:
+        case NODE_CALL: {
+            const NodeId* c = &ast->children[n->firstChild];
+            const u32 count = n->kind == NODE_ROOT ? n->data : n->info;
+            u32 v = n->data;
+            for (u32 i = 0; i < count; i++) v = v * 33 + _evalCompact(ast, c[i]);
+            return v;
+        }
+        default: return n->data;
+    }
+}
+
+// _evalCompact(root) as one forward scan over a post-order arena: every
+// node pops its operands off `stack` and pushes its value
+static u32 _evalLinear(const AstArena* ast, u32* stack) {
+    u32 top = 0;
+
+    for (NodeId id = 0; id < ast->root; id++) {
+        const AstNode* n = &ast->nodes[id];
+
+        switch (n->kind) {
+            case NODE_BINARY:
+                top--;
+                stack[top - 1] = _apply(n->info, stack[top - 1], stack[top]);
+                break;
+            case NODE_UNARY: stack[top - 1] = _applyUnary(n->info, stack[top - 1]); break;
+            case NODE_DECL: stack[top - 1] ^= n->data; break;
+            case NODE_TERNARY:
+                top -= 2;
+                stack[top - 1] = stack[top - 1] ? stack[top] : stack[top + 1];
+                break;
+            case NODE_CALL: {
+                u32 v = n->data;
+                top -= n->info;
+                for (u32 i = 0; i < n->info; i++) v = v * 33 + stack[top + i];
+                stack[top++] = v;
+                break;
+            }
+            default: stack[top++] = n->data; break;
+        }
+    }
+
+    // What is left are the root declarations' values
+    u32 v = ast->nodes[ast->root].data;
+    for (u32 i = 0; i < top; i++) v = v * 33 + stack[i];
+    return v;
+}
+
+// _evalCompact(root) over a shared arena: one value per node, forward, so
+// a subtree many parents share is evaluated once
+static u32 _evalShared(const AstArena* ast, u32* values) {
+    for (NodeId id = 0; id < ast->root; id++) {
+        const AstNode* n = &ast->nodes[id];
+        const NodeId* c = &ast->children[n->firstChild];
+
+        switch (n->kind) {
+            case NODE_BINARY:
+                values[id] = _apply(n->info, values[id - n->operands[0]], values[id - n->operands[1]]);
+                break;
+            case NODE_UNARY: values[id] = _applyUnary(n->info, values[id - n->operands[1]]); break;
+            case NODE_DECL: values[id] = n->data ^ values[id - n->operands[1]]; break;
+            case NODE_TERNARY: values[id] = values[c[0]] ? values[c[1]] : values[c[2]]; break;
+            case NODE_CALL: {
+                u32 v = n->data;
+                for (u32 i = 0; i < n->info; i++) v = v * 33 + values[c[i]];
+                values[id] = v;
+                break;
+            }
+            default: values[id] = n->data; break;
+        }
+    }
+
+    const AstNode* root = &ast->nodes[ast->root];
+    u32 v = root->data;
+    for (u32 i = 0; i < root->data; i++) v = v * 33 + values[ast->children[root->firstChild + i]];
+    return v;
+}
+
+// _evalShared where declarations bind: `$name` and identifiers read the
+// newest value declared for their name, their SymbolId before that. A
+// shared read made before a declaration of its name gives the old value
+// to the reads after it, and the DAG no longer matches the tree.
+static u32 _evalBound(const AstArena* ast, u32* values, u32* names, const u32 symbols) {
+    for (u32 s = 0; s < symbols; s++) names[s] = s;
+
+    for (NodeId id = 0; id < ast->root; id++) {
+        const AstNode* n = &ast->nodes[id];
+        const NodeId* c = &ast->children[n->firstChild];
+
+        switch (n->kind) {
+            case NODE_BINARY:
+                values[id] = _apply(n->info, values[id - n->operands[0]], values[id - n->operands[1]]);
+                break;
+            case NODE_UNARY: values[id] = _applyUnary(n->info, values[id - n->operands[1]]); break;
+            case NODE_DECL:
+                values[id] = values[id - n->operands[1]];
+                if (n->data < symbols) names[n->data] = values[id];
+                break;
+            case NODE_TERNARY: values[id] = values[c[0]] ? values[c[1]] : values[c[2]]; break;
+            case NODE_CALL: {
+                u32 v = n->data;
+                for (u32 i = 0; i < n->info; i++) v = v * 33 + values[c[i]];
+                values[id] = v;
+                break;
+            }
+            case NODE_ACCESS:
+            case NODE_IDENT: values[id] = n->data < symbols ? names[n->data] : n->data; break;
+            default: values[id] = n->data; break;
+        }
+    }
+
+    const AstNode* root = &ast->nodes[ast->root];
+    u32 v = root->data;
+    for (u32 i = 0; i < root->data; i++) v = v * 33 + values[ast->children[root->firstChild + i]];
+    return v;
+}
+
+// Operator histogram and integer literal sum, in node order
+static u64 _scanLegacy(const LegacyArena* old) {
+    u32 ops[OP_GUARD + 1] = { 0 };
+    u64 ints = 0, h = 0;
+
+    for (u32 i = 0; i < old->nodeLength; i++) {
+        const LegacyNode* n = &old->nodes[i];
+        if (n->kind == NODE_BINARY || n->kind == NODE_UNARY) ops[n->data]++;
+        else if (n->kind == NODE_LIT_INT) ints += n->data;
+    }
+
+    for (u32 op = 0; op <= OP_GUARD; op++) h = h * 31 + ops[op];
+    return h + ints;
+}
+
+static u64 _scanCompact(const AstArena* ast) {
+    u32 ops[OP_GUARD + 1] = { 0 };
+    u64 ints = 0, h = 0;
+
+    for (u32 i = 0; i < ast->nodeLength; i++) {
+        const AstNode* n = &ast->nodes[i];
+        if (n->kind == NODE_BINARY || n->kind == NODE_UNARY) ops[n->info]++;
+        else if (n->kind == NODE_LIT_INT) ints += n->data;
+    }
+
+    for (u32 op = 0; op <= OP_GUARD; op++) h = h * 31 + ops[op];
+    return h + ints;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// SHARING
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// What theme files repeat: a few base variables through a few helpers,
+// with the same handful of steps
+static const char* _idioms[] = {
+    "$space * %u", "$radius + %u", "$fontSize * 1.%u", "rgba(0, 0, 0, %u)",
+    "lighten($primary, 0.%u)", "darken($surface, 0.%u)", "mix($primary, $surface, 0.%u)",
+    "alpha($foreground, 0.%u)", "$dark ? #ffffff : #000000", "max($space * %u, 4)",
+    "$space * 2 + (space: %u) + $space * 2",
+};
+
+// Base variables declared again, later reads see the new value
+static const char* _rebinds[] = {
+    "space: %u\n", "radius: %u\n", "dark: %u\n",
+};
+
+static const char* _props[] = {
+    "padding", "margin", "radius", "background", "foreground", "border", "shadow", "opacity",
+};
+
+static const u32 _steps[] = { 1, 2, 3, 4, 5, 8 };
+
+static void _genIdiom(BenchText* t, u64* rng) {
+    char buf[64];
+    const int n = snprintf(buf, sizeof(buf), _idioms[bench_randRange(rng, _bench_len(_idioms))],
+        _steps[bench_randRange(rng, _bench_len(_steps))]);
+    _bench_put(t, buf, (u32)n);
+}
+
+static BenchText _genDesignTokens(const u32 bytes, const u64 seed) {
+    BenchText t = { 0 };
+    u64 rng = seed | 1;
+
+    _bench_puts(&t, "space: 4\nradius: 6\nfontSize: 14\ndark: 0\n"
+        "primary: #3366ff\nsurface: #ffffff\nforeground: #1a1a1a\n");
+
+    while (t.length < bytes) {
+        _bench_puts(&t, _bench_words[bench_randRange(&rng, _bench_len(_bench_words))]);
+        _bench_puts(&t, "_");
+        _bench_puts(&t, _bench_words[bench_randRange(&rng, _bench_len(_bench_words))]);
+        _bench_puts(&t, "_");
+        _bench_puts(&t, _props[bench_randRange(&rng, _bench_len(_props))]);
+        _bench_puts(&t, ": ");
+
+        _genIdiom(&t, &rng);
+        if (bench_randRange(&rng, 10) < 3) {
+            _bench_puts(&t, " + ");
+            _genIdiom(&t, &rng);
+        }
+
+        _bench_puts(&t, "\n");
+
+        if (bench_randRange(&rng, 50) == 0) {
+            char buf[32];
+            const int n = snprintf(buf, sizeof(buf), _rebinds[bench_randRange(&rng, _bench_len(_rebinds))],
+                _steps[bench_randRange(&rng, _bench_len(_steps))]);
+            _bench_put(&t, buf, (u32)n);
+        }
+    }
+
+    return t;
+}
+
+static AstArena _parseText(Program* program, const TokenStore* tokens, const bool share, f64* best) {
+    const f64 begin = bench_now();
+    Parser parser = { .program = program, .tokens = *tokens, .share = share };
+    const AstArena ast = Parser_parse(&parser);
+
+    const f64 seconds = bench_now() - begin;
+    if (seconds < *best) *best = seconds;
+    return ast;
+}
+
+static usize _arenaBytes(const AstArena* ast) {
+    return (usize)ast->nodeLength * (sizeof(AstNode) + sizeof(u32)) + (usize)ast->childLength * sizeof(NodeId);
+}
+
+static bool _benchSharing(const char* name, const BenchText* text, const u32 iterations) {
+    Source src = {
+        .data = text->data, .dataLength = text->length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    const TokenStore tokens = Lexer_lex(&lexer);
+
+    f64 best[4] = { 1e9, 1e9, 1e9, 1e9 };
+    const AstArena tree = _parseText(&program, &tokens, false, &best[0]);
+    const AstArena dag = _parseText(&program, &tokens, true, &best[1]);
+
+    // Unshared again, the DAG is the tree node for node (positions aside)
+    u32* values = malloc((tree.nodeLength + 1) * sizeof(u32));
+    const u32 symbols = strPool_count(&pool) + 1;
+    u32* names = malloc(symbols * sizeof(u32));
+    const AstArena unshared = ast_linearize(&dag);
+
+    const bool same = unshared.nodeLength == tree.nodeLength && unshared.childLength == tree.childLength
+        && memcmp(unshared.nodes, tree.nodes, tree.nodeLength * sizeof(AstNode)) == 0
+        && memcmp(unshared.children, tree.children, tree.childLength * sizeof(NodeId)) == 0
+        && _evalShared(&dag, values) == _evalLinear(&tree, values)
+        && _evalBound(&dag, values, names, symbols) == _evalBound(&tree, values, names, symbols);
+    ast_release(&unshared);
+    free(names);
+
+    for (u32 it = 0; it < iterations; it++) {
+        const AstArena a = _parseText(&program, &tokens, false, &best[0]);
+        const AstArena b = _parseText(&program, &tokens, true, &best[1]);
+        ast_release(&a);
+        ast_release(&b);
+
+        f64 begin = bench_now();
+        bench_keep(_evalLinear(&tree, values));
+        f64 t = bench_now() - begin;
+        if (t < best[2]) best[2] = t;
+
+        begin = bench_now();
+        bench_keep(_evalShared(&dag, values));
+        t = bench_now() - begin;
+        if (t < best[3]) best[3] = t;
+    }
+
+    const u32 made = dag.nodeLength + dag.shareHits;
+    const usize treeBytes = _arenaBytes(&tree), dagBytes = _arenaBytes(&dag);
+
+    printf("\n%s, %u bytes: %u nodes made, %u kept, %.1f%% shared%s\n", name, text->length,
+        made, dag.nodeLength, 100.0 * dag.shareHits / made, same ? "" : ", DIFFERS FROM THE TREE");
+    printf("    arena   tree %zu bytes, dag %zu bytes (%.1f%% saved), share table %zu bytes while parsing\n",
+        (size_t)treeBytes, (size_t)dagBytes, 100.0 * (f64)(treeBytes - dagBytes) / (f64)treeBytes,
+        (size_t)(dag.shareCapacity * sizeof(AstShareSlot)));
+    printf("    parse   tree %.3f ms, dag %.3f ms\n", best[0] * 1e3, best[1] * 1e3);
+    printf("    eval    post-order scan %.3f ms, dag %.3f ms (%.2fx)\n", best[2] * 1e3, best[3] * 1e3,
+        best[2] / best[3]);
+
+    free(values);
+    ast_release(&tree);
+    ast_release(&dag);
+    tokstore_release(&tokens);
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    return same;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// BENCH
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static void _printSize(const char* name, const usize nodes, const usize positions,
+    const usize slots, const usize walked) {
+    printf("%-10s %12zu %12zu %12zu %12zu %12zu\n", name, (size_t)nodes, (size_t)positions,
+        (size_t)slots, (size_t)(nodes + positions + slots), (size_t)walked);
+}
+
+int main(const int argc, char* argv[]) {
+    const u32 bytes = argc > 1 ? (u32)strtoul(argv[1], NULL, 10) : 4u << 20;
+    const u32 iterations = argc > 2 ? (u32)strtoul(argv[2], NULL, 10) : 20;
+
+    const BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    const TokenStore tokens = Lexer_lex(&lexer);
+
+    Parser parser = { .program = &program, .tokens = tokens };
+    const AstArena ast = Parser_parse(&parser);
+    const LegacyArena old = _toLegacy(&ast);
+
+    // Check
+    const u32 walkOld = _evalLegacy(&old, old.root), walkNew = _evalCompact(&ast, ast.root);
+    const u64 scanOld = _scanLegacy(&old), scanNew = _scanCompact(&ast);
+    const bool same = walkOld == walkNew && scanOld == scanNew;
+
+    printf("%u bytes, %u tokens, %u nodes, %s\n\n", text.length, tokens.length, ast.nodeLength,
+        same ? "both layouts give the same results" : "LAYOUTS DIFFER");
+    if (!same) return 1;
+
+    // Arena size: what is used, not the planned capacity
+    printf("%-10s %12s %12s %12s %12s %12s\n", "layout", "nodes", "positions", "slots", "total", "walked");
+    _printSize("old", old.nodeLength * sizeof(LegacyNode), 0, old.childLength * sizeof(NodeId),
+        old.nodeLength * sizeof(LegacyNode) + old.childLength * sizeof(NodeId));
+    _printSize("new", ast.nodeLength * sizeof(AstNode), ast.nodeLength * sizeof(u32),
+        ast.childLength * sizeof(NodeId), ast.nodeLength * sizeof(AstNode) + ast.childLength * sizeof(NodeId));
+
+    // Post-order evaluation needs no child lookups, only a value stack
+    u32* stack = malloc((ast.nodeLength + 1) * sizeof(u32));
+    const AstArena linear = ast_linearize(&ast);
+    const u32 linearValue = _evalLinear(&linear, stack);
+
+    if (!ast.postOrder || linear.nodeLength != ast.nodeLength || linearValue != walkNew) {
+        fprintf(stderr, "linear evaluation differs from the recursive one\n");
+        return 1;
+    }
+
+    // Traversal, best of `iterations`
+    f64 best[6] = { 1e9, 1e9, 1e9, 1e9, 1e9, 1e9 };
+
+    for (u32 it = 0; it < iterations; it++) {
+        f64 begin = bench_now();
+        bench_keep(_evalLegacy(&old, old.root));
+        f64 t = bench_now() - begin;
+        if (t < best[0]) best[0] = t;
+
+        begin = bench_now();
+        bench_keep(_evalCompact(&ast, ast.root));
+        t = bench_now() - begin;
+        if (t < best[1]) best[1] = t;
+
+        begin = bench_now();
+        bench_keep(_scanLegacy(&old));
+        t = bench_now() - begin;
+        if (t < best[2]) best[2] = t;
+
+        begin = bench_now();
+        bench_keep(_scanCompact(&ast));
+        t = bench_now() - begin;
+        if (t < best[3]) best[3] = t;
+
+        begin = bench_now();
+        bench_keep(_evalLinear(&linear, stack));
+        t = bench_now() - begin;
+        if (t < best[4]) best[4] = t;
+
+        begin = bench_now();
+        const AstArena again = ast_linearize(&ast);
+        t = bench_now() - begin;
+        if (t < best[5]) best[5] = t;
+        ast_release(&again);
+    }
+
+    printf("\n%-10s %12s %12s %12s %8s\n", "traversal", "old ms", "new ms", "Mnodes/s", "speedup");
+    printf("%-10s %12.3f %12.3f %12.1f %7.2fx\n", "walk", best[0] * 1e3, best[1] * 1e3,
+        ast.nodeLength / best[1] * 1e-6, best[0] / best[1]);
+    printf("%-10s %12.3f %12.3f %12.1f %7.2fx\n", "scan", best[2] * 1e3, best[3] * 1e3,
+        ast.nodeLength / best[3] * 1e-6, best[2] / best[3]);
+
+    printf("\n%-22s %12s %12s %8s\n", "evaluation", "ms", "Mnodes/s", "speedup");
+    printf("%-22s %12.3f %12.1f %7.2fx\n", "recursive, old layout", best[0] * 1e3,
+        ast.nodeLength / best[0] * 1e-6, 1.0);
+    printf("%-22s %12.3f %12.1f %7.2fx\n", "recursive", best[1] * 1e3,
+        ast.nodeLength / best[1] * 1e-6, best[0] / best[1]);
+    printf("%-22s %12.3f %12.1f %7.2fx\n", "post-order scan", best[4] * 1e3,
+        ast.nodeLength / best[4] * 1e-6, best[0] / best[4]);
+    printf("%-22s %12.3f %12.1f\n", "ast_linearize", best[5] * 1e3, ast.nodeLength / best[5] * 1e-6);
+
+    free(stack);
+    ast_release(&linear);
+    _freeLegacy(&old);
+    ast_release(&ast);
+    tokstore_release(&tokens);
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+
+    // Sharing, on the same theme and on design tokens
+    const BenchText tokensText = _genDesignTokens(bytes, 0xDE5161);
+    const bool shared = _benchSharing("theme", &text, iterations)
+        & _benchSharing("design tokens", &tokensText, iterations);
+
+    bench_freeText(&tokensText);
+    bench_freeText(&text);
+    return shared ? 0 : 1;
+}
+
+// Build (from implementations/C):
+// gcc -O3 -pthread -o bench-ast bench/bench-ast.c parser/parser.c parser/ast.c lexer/lexer.c
+//     program/string-pool.c program/source.c error/errors.c error/reporter.c utils/strings.c utils/memory.c
@@ -0,0 +1,445 @@
+/*
+ * @file bench-convert.c
+ *
+ * Literal conversion benchmark for utils/convert.h.
+ *
+ * Integer forms (decimal, hex, hex color constants, binary masks, octal),
+ * with and without '_' separators: the SWAR / SSE2 `cvt_*ToInt` against
+ * the one-character-per-iteration `_cvt_*ToIntScalar` references. Octal
+ * takes the scalar loop on both sides, it is kept as the control row.
+ * Every generated literal is checked for an identical result before timing,
+ * including saturation and 32-bit wrap of over-long literals.
+ *
+ * Float forms: `cvt_expToFloat` / `cvt_floatToFloat` must be bit-exact
+ * with strtof over millions of random literals (short theme values, long
+ * and truncated mantissas, subnormals, overflow, exact halfway points),
+ * then are timed against strtof and the old digit loop.
+ *
+ * Usage: bench-convert [literals] [iterations] [float-checks]
+ */
+
+#include "bench.h"
+#include "../utils/convert.h"
+
+#include <math.h>
+
+typedef i32 (*IntFn)(const char* str, usize len);
+
+typedef struct Literals {
+    BenchText text;
+    u32* offsets;
+    u32* lengths;
+    u32 count;
+} Literals;
+
+typedef enum LiteralForm {
+    LF_DECIMAL,
+    LF_DECIMAL_LONG,
+    LF_HEX,
+    LF_HEX_COLOR,
+    LF_HEX_SEPARATED,
+    LF_BINARY,
+    LF_BINARY_SEPARATED,
+    LF_OCTAL,
+    LF_COUNT
+} LiteralForm;
+
+static const char* FORM_NAMES[LF_COUNT] = {
+    "decimal", "decimal >9", "hex", "hex color", "hex 0x_", "binary", "binary 0b_", "octal",
+};
+
+static void _putDigits(BenchText* t, u64* rng, const char* alphabet, const u32 count, const u32 group) {
+    const u32 n = (u32)strlen(alphabet);
+
+    for (u32 i = 0; i < count; i++) {
+        if (group && i && i % group == 0) _bench_puts(t, "_");
+        _bench_put(t, &alphabet[bench_randRange(rng, n)], 1);
+    }
+}
+
+static void _genLiteral(BenchText* t, u64* rng, const LiteralForm form) {
+    static const char* dec = "0123456789";
+    static const char* hex = "0123456789abcdefABCDEF";
+
+    switch (form) {
+        case LF_DECIMAL:
+            _putDigits(t, rng, dec, 1 + bench_randRange(rng, 9), 0);
+            break;
+
+        case LF_DECIMAL_LONG:
+            if (bench_randRange(rng, 2)) _bench_puts(t, "-");
+            _putDigits(t, rng, dec, 10 + bench_randRange(rng, 12), bench_randRange(rng, 2) ? 3 : 0);
+            break;
+
+        case LF_HEX:
+            _bench_puts(t, "0x");
+            _putDigits(t, rng, hex, 1 + bench_randRange(rng, 8), 0);
+            break;
+
+        case LF_HEX_COLOR:
+            _bench_puts(t, "0xFF");
+            _putDigits(t, rng, hex, 6, 0);
+            break;
+
+        case LF_HEX_SEPARATED:
+            _bench_puts(t, "0x");
+            _putDigits(t, rng, hex, 4 + bench_randRange(rng, 12), bench_randRange(rng, 2) ? 2 : 4);
+            break;
+
+        case LF_BINARY:
+            _bench_puts(t, "0b");
+            _putDigits(t, rng, "01", 8 + bench_randRange(rng, 25), 0);
+            break;
+
+        case LF_BINARY_SEPARATED:
+            _bench_puts(t, "0b");
+            _putDigits(t, rng, "01", 8 + bench_randRange(rng, 40), bench_randRange(rng, 2) ? 4 : 8);
+            break;
+
+        case LF_OCTAL:
+            _bench_puts(t, "0o");
+            _putDigits(t, rng, "01234567", 1 + bench_randRange(rng, 14), 0);
+            break;
+
+        default:;
+    }
+}
+
+static Literals _makeLiterals(const LiteralForm form, const u32 count, u64 seed) {
+    Literals l = { 0 };
+    l.offsets = malloc(count * sizeof(u32));
+    l.lengths = malloc(count * sizeof(u32));
+    l.count = count;
+
+    for (u32 i = 0; i < count; i++) {
+        l.offsets[i] = l.text.length;
+        _genLiteral(&l.text, &seed, form);
+        l.lengths[i] = l.text.length - l.offsets[i];
+        _bench_puts(&l.text, " ");
+    }
+
+    return l;
+}
+
+static void _freeLiterals(const Literals* l) {
+    free(l->offsets);
+    free(l->lengths);
+    bench_freeText(&l->text);
+}
+
+static IntFn _fastFn(const LiteralForm form) {
+    switch (form) {
+        case LF_DECIMAL: case LF_DECIMAL_LONG:     return cvt_decimalToInt;
+        case LF_BINARY: case LF_BINARY_SEPARATED:  return cvt_binToInt;
+        case LF_OCTAL:                             return cvt_octToInt;
+        default:                                   return cvt_hexToInt;
+    }
+}
+
+static IntFn _scalarFn(const LiteralForm form) {
+    switch (form) {
+        case LF_DECIMAL: case LF_DECIMAL_LONG:     return _cvt_decimalToIntScalar;
+        case LF_BINARY: case LF_BINARY_SEPARATED:  return _cvt_binToIntScalar;
+        case LF_OCTAL:                             return _cvt_octToIntScalar;
+        default:                                   return _cvt_hexToIntScalar;
+    }
+}
+
+static bool _verify(const char* name, const IntFn fast, const IntFn scalar, const char* s, const u32 len) {
+    const i32 a = scalar(s, len);
+    const i32 b = fast(s, len);
+    if (a == b) return true;
+
+    fprintf(stderr, "%s mismatch on '%.*s': scalar=%d fast=%d\n", name, (int)len, s, a, b);
+    return false;
+}
+
+// Hand-picked edges: empty runs, saturation, wrap, stop bytes, long runs
+static void _verifyEdges(void) {
+    static const char* decimals[] = {
+        "", "0", "-", "+7", "-0", "12345678", "123456789", "2147483647", "2147483648",
+        "-2147483648", "2147483649", "21474836470", "214748364_8", "99999999999999",
+        "4294967296", "1_2_3", "12a34", "1__2", "_1", "000000000000000000000042",
+        "12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+    };
+    static const char* hexes[] = {
+        "0x", "0x0", "-0x1", "0xFFFFFFFF", "0x1_0000_0000", "0xDEAD_beef", "0xdeadbeefcafebabe",
+        "0x0123456789abcdefABCDEF", "0xFFz", "0xFF FF", "FF", "0x_F_", "0xG",
+        "0x0000000000000000000000000000000000000000000000000000000000000000000001",
+    };
+    static const char* bins[] = {
+        "0b", "0b1", "-0b1", "0b1111_0000", "0b10101010101010101010101010101010",
+        "0b1_0000_0000_0000_0000_0000_0000_0000_0001", "0b012", "0B11", "101",
+        "0b11110000_1", "0b10101010_2", "0b11111111_", "0b1111000011110000_1010_0101",
+        "-0b11001100110011001100110011001100_11",
+        "0b1111111111111111111111111111111111111111111111111111111111111111111111",
+    };
+    static const char* octs[] = {
+        "0o", "0o7", "-0o17", "0o777_777", "0o37777777777", "0o777777777777777", "0o78", "0O12",
+    };
+
+    bool ok = true;
+    for (u32 i = 0; i < _bench_len(decimals); i++)
+        ok &= _verify("decimal", cvt_decimalToInt, _cvt_decimalToIntScalar, decimals[i], (u32)strlen(decimals[i]));
+    for (u32 i = 0; i < _bench_len(hexes); i++)
+        ok &= _verify("hex", cvt_hexToInt, _cvt_hexToIntScalar, hexes[i], (u32)strlen(hexes[i]));
+    for (u32 i = 0; i < _bench_len(bins); i++)
+        ok &= _verify("binary", cvt_binToInt, _cvt_binToIntScalar, bins[i], (u32)strlen(bins[i]));
+    for (u32 i = 0; i < _bench_len(octs); i++)
+        ok &= _verify("octal", cvt_octToInt, _cvt_octToIntScalar, octs[i], (u32)strlen(octs[i]));
+
+    if (!ok) exit(1);
+}
+
+// Best pass out of `iterations`, the VMs we bench on are noisy
+static f64 _timeInts(const IntFn fn, const Literals* l, const u32 iterations) {
+    f64 best = 1e30;
+
+    for (u32 it = 0; it < iterations; it++) {
+        const f64 begin = bench_now();
+        for (u32 i = 0; i < l->count; i++)
+            bench_keep(fn(l->text.data + l->offsets[i], l->lengths[i]));
+
+        const f64 t = bench_now() - begin;
+        if (t < best) best = t;
+    }
+
+    return best;
+}
+
+static void _benchInts(const u32 count, const u32 iterations) {
+    printf("integers    (CVT_SWAR=%d CVT_SSE2=%d), %u literals, best of %u\n",
+        CVT_SWAR, CVT_SSE2, count, iterations);
+    printf("%-12s %10s %12s %12s %9s\n", "form", "avg len", "scalar ns", "fast ns", "speedup");
+
+    for (u32 f = 0; f < LF_COUNT; f++) {
+        const Literals l = _makeLiterals((LiteralForm)f, count, 0xF00D + f);
+        const IntFn fast = _fastFn((LiteralForm)f);
+        const IntFn scalar = _scalarFn((LiteralForm)f);
+
+        for (u32 i = 0; i < l.count; i++)
+            if (!_verify(FORM_NAMES[f], fast, scalar, l.text.data + l.offsets[i], l.lengths[i])) exit(1);
+
+        const f64 per = 1e9 / (f64)count;
+        const f64 a = _timeInts(scalar, &l, iterations) * per;
+        const f64 b = _timeInts(fast, &l, iterations) * per;
+
+        printf("%-12s %10.1f %12.2f %12.2f %8.2fx\n", FORM_NAMES[f],
+            (f64)(l.text.length - l.count) / l.count, a, b, a / b);
+
+        _freeLiterals(&l);
+    }
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// FLOATS
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// The digit loop cvt_expToFloat used before, kept for the timing column
+static f32 _legacyExpToFloat(const char* str, const usize len) {
+    f32 mantissa = 0.0f, fraction = 1.0f;
+    bool inFraction = false;
+    usize i = 0;
+
+    for (; i < len; i++) {
+        const char c = str[i];
+        if (c == '_') continue;
+        if (c == 'e' || c == 'E') { i++; break; }
+        if (c == '.') { inFraction = true; continue; }
+        if (!_cvt_isDigit(c)) return mantissa;
+
+        if (inFraction) {
+            fraction *= 0.1f;
+            mantissa += (f32)(c - '0') * fraction;
+        } else {
+            mantissa = mantissa * 10.0f + (f32)(c - '0');
+        }
+    }
+
+    i32 exponent = 0, sign = 1;
+    if (i < len && (str[i] == '-' || str[i] == '+')) sign = str[i++] == '-' ? -1 : 1;
+    for (; i < len && _cvt_isDigit(str[i]); i++) exponent = exponent * 10 + (str[i] - '0');
+
+    for (i32 e = 0; e < exponent; e++) mantissa = sign > 0 ? mantissa * 10.0f : mantissa * 0.1f;
+    return mantissa;
+}
+
+static u32 _bits(const f32 f) {
+    u32 b;
+    memcpy(&b, &f, sizeof(b));
+    return b;
+}
+
+// Random float literal; `kind` picks the family
+static u32 _genFloat(char* out, u64* rng, const u32 kind) {
+    switch (kind) {
+        case 0:     // theme-like: 0.25, 12.5, 892.168
+            return (u32)sprintf(out, "%u.%u", bench_randRange(rng, 1000), bench_randRange(rng, 1000));
+
+        case 1:     // short exponent: 6e-5, 1.5e3
+            return (u32)sprintf(out, "%u.%ue%d", bench_randRange(rng, 10), bench_randRange(rng, 100),
+                (i32)bench_randRange(rng, 21) - 10);
+
+        case 2: {   // 1..30 digit mantissa, dot anywhere, exponent -70..50
+            const u32 digits = 1 + bench_randRange(rng, 30);
+            const u32 dot = bench_randRange(rng, digits + 1);
+            u32 n = 0;
+
+            for (u32 i = 0; i < digits; i++) {
+                if (i == dot) out[n++] = '.';
+                out[n++] = (char)('0' + bench_randRange(rng, 10));
+                if (bench_randRange(rng, 16) == 0) out[n++] = '_';
+            }
+            if (out[n - 1] == '_') n--;
+
+            return n + (u32)sprintf(out + n, "e%d", (i32)bench_randRange(rng, 121) - 70);
+        }
+
+        case 3: {   // random float bits printed with 9 digits, subnormals included
+            const u32 bits = (u32)bench_rand(rng) & 0x7F7FFFFF;
+            f32 f;
+            memcpy(&f, &bits, sizeof(f));
+            return (u32)sprintf(out, "%.8e", (f64)f);
+        }
+
+        default: {  // exact halfway point between two floats (a double holds it exactly)
+            const u32 bits = ((u32)bench_rand(rng) & 0x7F7FFFFF) | 1;
+            f32 f;
+            memcpy(&f, &bits, sizeof(f));
+            const f64 mid = ((f64)f + (f64)nextafterf(f, INFINITY)) / 2;
+            return (u32)sprintf(out, "%.120e", mid);
+        }
+    }
+}
+
+static bool _checkFloat(const char* s, const u32 len) {
+    char clean[256];
+    u32 n = 0;
+    for (u32 i = 0; i < len && n < sizeof(clean) - 1; i++)
+        if (s[i] != '_') clean[n++] = s[i];
+    clean[n] = '\0';
+
+    const f32 expect = strtof(clean, NULL);
+    const f32 got = cvt_expToFloat(s, len);
+    if (_bits(expect) == _bits(got)) return true;
+
+    fprintf(stderr, "float mismatch on '%.*s': strtof=%.9g (0x%08X) cvt=%.9g (0x%08X)\n",
+        (int)len, s, (f64)expect, _bits(expect), (f64)got, _bits(got));
+    return false;
+}
+
+static void _verifyFloats(const u32 checks) {
+    static const char* edges[] = {
+        "0", "0.0", ".5", "1.", "1e0", "0e99999", "1e-46", "1e-45", "7e-46", "7.1e-46", "1.4e-45",
+        "1.17549435e-38", "1.1754942e-38", "3.4028235e38", "3.4028236e38", "3.40282357e38",
+        "3.4028237e38", "1e39", "1e99999", "16777216", "16777217", "16777218", "16777219",
+        "33554434", "33554435", "0.1", "0.2", "0.3", "12.34", "1e5", "6e-5", "2.5e-7",
+        "9999999999999999999", "99999999999999999999", "18446744073709551615",
+        "18446744073709551616", "0.000000000000000000000000000000000000000000001",
+        "1.00000005960464477539062499", "1.000000059604644775390625",
+        "1.00000005960464477539062501", "1_000.000_5", "-2.5", "+2.5e1",
+        "4.7019774032891500318749461488889827112746622270883500860350068251e-38",
+    };
+
+    bool ok = true;
+    for (u32 i = 0; i < _bench_len(edges); i++)
+        ok &= _checkFloat(edges[i], (u32)strlen(edges[i]));
+    if (!ok) exit(1);
+
+    u64 rng = 0xF10A7;
+    char buf[256];
+    u32 failed = 0;
+
+    for (u32 i = 0; i < checks; i++) {
+        const u32 len = _genFloat(buf, &rng, i % 5);
+        if (!_checkFloat(buf, len) && ++failed > 10) break;
+    }
+
+    if (failed) exit(1);
+    printf("\nfloats      %u random literals + %u edges bit-exact with strtof\n",
+        checks, _bench_len(edges));
+}
+
+typedef f32 (*FloatFn)(const char* str, usize len);
+
+static f32 _strtofFn(const char* str, const usize len) {
+    (void)len;
+    return strtof(str, NULL);
+}
+
+static f64 _timeFloats(const FloatFn fn, const Literals* l, const u32 iterations) {
+    f64 best = 1e30;
+
+    for (u32 it = 0; it < iterations; it++) {
+        const f64 begin = bench_now();
+        for (u32 i = 0; i < l->count; i++)
+            bench_keep(_bits(fn(l->text.data + l->offsets[i], l->lengths[i])));
+
+        const f64 t = bench_now() - begin;
+        if (t < best) best = t;
+    }
+
+    return best;
+}
+
+static void _benchFloats(const u32 count, const u32 iterations) {
+    static const char* names[] = { "d.ddd", "d.de[+-]d", "long mantissa" };
+
+    printf("%-14s %10s %10s %10s %10s %12s\n",
+        "form", "avg len", "strtof ns", "old ns", "cvt ns", "old wrong");
+
+    for (u32 kind = 0; kind < _bench_len(names); kind++) {
+        Literals l = { 0 };
+        l.offsets = malloc(count * sizeof(u32));
+        l.lengths = malloc(count * sizeof(u32));
+        l.count = count;
+
+        u64 rng = 0xBEEF + kind;
+        char buf[256];
+        u32 wrong = 0;
+
+        for (u32 i = 0; i < count; i++) {
+            u32 len = _genFloat(buf, &rng, kind);
+
+            // No separators here, strtof reads the buffer in place
+            u32 n = 0;
+            for (u32 j = 0; j < len; j++) if (buf[j] != '_') buf[n++] = buf[j];
+            len = n;
+
+            l.offsets[i] = l.text.length;
+            l.lengths[i] = len;
+            _bench_put(&l.text, buf, len);
+            _bench_puts(&l.text, " ");
+
+            buf[len] = '\0';
+            wrong += _bits(_legacyExpToFloat(buf, len)) != _bits(strtof(buf, NULL));
+        }
+
+        const f64 per = 1e9 / (f64)count;
+        printf("%-14s %10.1f %10.2f %10.2f %10.2f %11.1f%%\n", names[kind],
+            (f64)(l.text.length - l.count) / l.count,
+            _timeFloats(_strtofFn, &l, iterations) * per,
+            _timeFloats(_legacyExpToFloat, &l, iterations) * per,
+            _timeFloats(cvt_expToFloat, &l, iterations) * per,
+            100.0 * wrong / count);
+
+        _freeLiterals(&l);
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    const u32 count = argc > 1 ? (u32)strtoul(argv[1], NULL, 10) : 1u << 20;
+    const u32 iterations = argc > 2 ? (u32)strtoul(argv[2], NULL, 10) : 5;
+    const u32 floatChecks = argc > 3 ? (u32)strtoul(argv[3], NULL, 10) : 10u << 20;
+
+    _verifyEdges();
+    _benchInts(count, iterations);
+
+    _verifyFloats(floatChecks);
+    _benchFloats(count, iterations);
+    return 0;
+}
+
+// Build (from implementations/C):
+// gcc -O3 -o bench-convert bench/bench-convert.c -lm
+// Add -DTSTM_NO_SIMD to time the SWAR path without SSE2.
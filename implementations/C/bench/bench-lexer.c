@@ -0,0 +1,740 @@
+/*
+ * @file bench-lexer.c
+ *
+ * Lexer throughput benchmark.
+ *
+ * 1. Scanner micro benchmarks: scalar vs vectorized `scan_*` on inputs
+ *    dominated by the run they scan (indentation, long identifiers,
+ *    hex runs, comment lines and banners).
+ * 2. Full `Lexer_lex` MB/s over a generated theme corpus.
+ *    Build a second binary with -DTSTM_NO_SIMD to compare end to end.
+ * 3. StringPool footprint when only identifiers are interned, against
+ *    interning every token lexeme (the old lexer behavior). Every string
+ *    handed out must still be intact after the pool grew.
+ * 4. Literal values decoded by the lexer, checked against the cvt_*
+ *    parsers that used to run on every tok_asInt / tok_asFloat.
+ * 5. Line table: lexing cost of recording line starts, and offset to
+ *    line/column lookups against the pos_getOffsetInfo rescan.
+ * 6. Capacity plan: pre-scan MB/s (vector against scalar counting, which
+ *    must agree) and planned against actual token / identifier counts.
+ * 7. Token storage: bytes per token and push / scan cost of the segmented
+ *    TokenStore against the old array of Token, regrown by copy past 90%
+ *    load. Every token read back from the store must equal the lexed one.
+ * 8. Incremental re-lex: random small edits (typing, deletes, new lines and
+ *    declarations, the odd invalid byte) through Lexer_relex. After every
+ *    edit the tokens and line table must equal a full lex of the edited
+ *    text; then the time per edit against a full Lexer_lex, by file size.
+ *
+ * Usage: bench-lexer [corpus-bytes] [iterations]
+ */
+
+#include "bench.h"
+#include "../lexer/lexer.h"
+#include "../lexer/lex-scan.h"
+#include "../error/reporter.h"
+#include "../program/capacity-plan.h"
+#include "../program/line-table.h"
+#include "../utils/position.h"
+
+typedef u32 (*ScanFn)(const char* data, u32 pos, u32 len);
+
+typedef struct ScanCase {
+    const char* name;
+    ScanFn scalar;
+    ScanFn vector;
+    const char* alphabet;   // bytes that belong to the run
+    const char* stopper;    // bytes that end a run (skipped after each scan)
+    u32 minRun;
+    u32 maxRun;
+} ScanCase;
+
+static BenchText _makeRuns(const ScanCase* c, const u32 bytes, u64 seed) {
+    BenchText t = { 0 };
+    const u32 alphaLen = (u32)strlen(c->alphabet);
+    const u32 stopLen = (u32)strlen(c->stopper);
+
+    while (t.length < bytes) {
+        const u32 run = c->minRun + bench_randRange(&seed, c->maxRun - c->minRun + 1);
+        for (u32 i = 0; i < run; i++)
+            _bench_put(&t, &c->alphabet[bench_randRange(&seed, alphaLen)], 1);
+
+        _bench_put(&t, c->stopper, stopLen);
+    }
+
+    return t;
+}
+
+static f64 _timeScan(const ScanFn fn, const BenchText* t, const u32 skip, const u32 iterations) {
+    const f64 begin = bench_now();
+
+    for (u32 it = 0; it < iterations; it++) {
+        u32 pos = 0;
+        while (pos < t->length) {
+            pos = fn(t->data, pos, t->length) + skip;
+            bench_keep(pos);
+        }
+    }
+
+    return bench_now() - begin;
+}
+
+static bool _verifyScan(const ScanCase* c, const BenchText* t, const u32 skip) {
+    u32 pos = 0;
+    while (pos < t->length) {
+        const u32 a = c->scalar(t->data, pos, t->length);
+        const u32 b = c->vector(t->data, pos, t->length);
+        if (a != b) {
+            fprintf(stderr, "%s mismatch at %u: scalar=%u vector=%u\n", c->name, pos, a, b);
+            return false;
+        }
+        pos = a + skip;
+    }
+
+    return true;
+}
+
+static const ScanCase CASES[] = {
+    { "whitespace", _scan_whitespaceScalar, scan_whitespace, " \t\n", "x", 8, 96 },
+    { "identifier", _scan_identifierScalar, scan_identifier,
+        "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", " ", 12, 64 },
+    { "hexDigits", _scan_hexDigitsScalar, scan_hexDigits, "0123456789abcdefABCDEF", " ", 6, 32 },
+    { "lineEnd", _scan_lineEndScalar, scan_lineEnd,
+        "abcdefghijklmnopqrstuvwxyz -=+*#:;()", "\n", 40, 120 },
+    { "blockEnd", _scan_blockEndScalar, scan_blockEnd,
+        "abcdefghijklmnopqrstuvwxyz =-\n", "*/", 80, 400 },
+};
+
+static void _benchScanners(const u32 bytes, const u32 iterations) {
+    printf("scanner      scalar MB/s   vector MB/s   speedup   (SCAN_WIDTH=%d)\n", SCAN_WIDTH);
+
+    for (u32 i = 0; i < _bench_len(CASES); i++) {
+        const ScanCase* c = &CASES[i];
+        const BenchText t = _makeRuns(c, bytes, 0x5EED + i);
+        const u32 skip = (u32)strlen(c->stopper);
+
+        if (!_verifyScan(c, &t, skip)) exit(1);
+
+        const f64 scalar = bench_mbps((usize)t.length * iterations,
+            _timeScan(c->scalar, &t, skip, iterations));
+        const f64 vector = bench_mbps((usize)t.length * iterations,
+            _timeScan(c->vector, &t, skip, iterations));
+
+        printf("%-12s %11.1f   %11.1f   %6.2fx\n", c->name, scalar, vector, vector / scalar);
+        bench_freeText(&t);
+    }
+}
+
+static void _benchLexer(const u32 bytes, const u32 iterations) {
+    const BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    usize tokens = 0;
+    const f64 begin = bench_now();
+
+    for (u32 it = 0; it < iterations; it++) {
+        Lexer lexer = { .program = &program, .position = 0 };
+        const TokenStore tl = Lexer_lex(&lexer);
+        tokens += tl.length;
+        tokstore_release(&tl);
+        strPool_reset(&pool);
+    }
+
+    const f64 seconds = bench_now() - begin;
+
+    printf("\nLexer_lex    %u bytes x %u: %.1f MB/s, %.1f Mtok/s, errors=%zu\n",
+        text.length, iterations,
+        bench_mbps((usize)text.length * iterations, seconds),
+        (f64)tokens / seconds * 1e-6, (size_t)reporter.errors.length);
+
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    bench_freeText(&text);
+}
+
+static void _printPool(const char* label, const usize calls, const StringPool* pool) {
+    printf("%-18s %12zu %10u %12u %10u %7u\n", label,
+        (size_t)calls, pool->hashLength, pool->used, pool->hashCapacity, pool->chunkLength);
+}
+
+static void _benchPool(const u32 bytes) {
+    const BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1024, 1024);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    const TokenStore tl = Lexer_lex(&lexer);
+
+    // Replay the old behavior: every lexeme through the pool
+    StringPool every = strPool_new(1024, 1024);
+    str_t* interned = malloc(tl.length * sizeof(str_t));
+    usize identifiers = 0;
+
+    for (usize i = 0; i < tl.length; i++) {
+        const Token tok = tokstore_at(&tl, (TokenId)i);
+        if (tok.type == tt_eof) continue;
+        if (tok.type == tt_identifier) identifiers++;
+
+        interned[i] = strPool_intern(&every, text.data + tok.start, tok_len(tok));
+    }
+
+    // Strings returned before the pool grew must not have moved
+    for (usize i = 0; i + 1 < tl.length; i++) {
+        const Token tok = tokstore_at(&tl, (TokenId)i);
+        if (interned[i].length != tok_len(tok)
+            || memcmp(interned[i].data, text.data + tok.start, tok_len(tok)) != 0) {
+            fprintf(stderr, "pooled string %zu moved or changed\n", (size_t)i);
+            exit(1);
+        }
+    }
+
+    free(interned);
+
+    printf("\nStringPool on %u bytes, %zu tokens\n", text.length, (size_t)tl.length);
+    printf("%-18s %12s %10s %12s %10s %7s\n", "mode", "intern calls", "unique", "pool bytes", "hash cap", "chunks");
+    _printPool("every token", tl.length - 1, &every);
+    _printPool("identifiers only", identifiers, &pool);
+
+    tokstore_release(&tl);
+    strPool_release(&every);
+    strPool_release(&pool);
+    reporter_clear(&reporter);
+    bench_freeText(&text);
+}
+
+static void _verifyValues(const u32 bytes) {
+    const BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1024, 1024);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    const TokenStore tl = Lexer_lex(&lexer);
+
+    usize literals = 0, mismatches = 0;
+    bool ok;
+
+    for (usize i = 0; i < tl.length; i++) {
+        const Token tok = tokstore_at(&tl, (TokenId)i);
+        const char* s = text.data + tok.start;
+        const u32 len = tok_len(tok);
+        i32 expect;
+
+        switch (tok.type) {
+            case tt_int32:    expect = cvt_decimalToInt(s, len); break;
+            case tt_hex:      expect = cvt_hexToInt(s, len); break;
+            case tt_bin:      expect = cvt_binToInt(s, len); break;
+            case tt_oct:      expect = cvt_octToInt(s, len); break;
+            case tt_mask:     expect = (i32)cvt_maskToInt(s, len); break;
+            case tt_hexColor: expect = (i32)cvt_hexStrToColor(s, len, &ok); break;
+
+            case tt_identifier: {
+                // Symbol must name the same bytes as the source span
+                const str_t name = strPool_get(&pool, tok_symbol(tok));
+                literals++;
+                if (name.length != len || memcmp(name.data, s, len) != 0) mismatches++;
+                continue;
+            }
+
+            case tt_float32:
+            case tt_exp: {
+                // Decimal-parts conversion must agree with strtof
+                char tmp[64];
+                u32 n = 0;
+                for (u32 j = 0; j < len && n < sizeof(tmp) - 1; j++)
+                    if (s[j] != CL_NumberSeparator) tmp[n++] = s[j];
+                tmp[n] = '\0';
+
+                literals++;
+                if (strtof(tmp, NULL) != tok_asFloat(tok)) mismatches++;
+                continue;
+            }
+
+            default: continue;
+        }
+
+        literals++;
+        if (expect != tok_asInt(tok)) mismatches++;
+    }
+
+    printf("\nLiteral values: %zu checked, %zu mismatches\n", (size_t)literals, (size_t)mismatches);
+    if (mismatches) exit(1);
+
+    tokstore_release(&tl);
+    strPool_release(&pool);
+    reporter_clear(&reporter);
+    bench_freeText(&text);
+}
+
+static f64 _timeLex(Program* program, const u32 iterations) {
+    const f64 begin = bench_now();
+
+    for (u32 it = 0; it < iterations; it++) {
+        if (program->source->lines) lines_reset(program->source->lines);
+
+        Lexer lexer = { .program = program, .position = 0 };
+        const TokenStore tl = Lexer_lex(&lexer);
+        tokstore_release(&tl);
+        strPool_reset(program->stringPool);
+    }
+
+    return bench_now() - begin;
+}
+
+static void _benchLines(const u32 bytes, const u32 iterations, const u32 lookups) {
+    const BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+    LineTable lines = lines_new(text.length / 32);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    const f64 plain = _timeLex(&program, iterations);
+    src.lines = &lines;
+    const f64 recorded = _timeLex(&program, iterations);
+
+    printf("\nLine table   %u lines, lexing %.1f MB/s without, %.1f MB/s with\n",
+        lines.length,
+        bench_mbps((usize)text.length * iterations, plain),
+        bench_mbps((usize)text.length * iterations, recorded));
+
+    // Same answers as the rescan, from the lexer's table and from a lazy one
+    LineTable lazy = lines_new(0);
+    u32* offsets = malloc(lookups * sizeof(u32));
+    u64 rng = 0x11E5;
+
+    for (u32 i = 0; i < lookups; i++) {
+        offsets[i] = bench_randRange(&rng, text.length + 1);
+
+        u32 expect[4], a[4], b[4];
+        pos_getOffsetInfo(text.data, text.length, offsets[i],
+            &expect[0], &expect[1], &expect[2], &expect[3]);
+        lines_getOffsetInfo(&lines, text.data, text.length, offsets[i], &a[0], &a[1], &a[2], &a[3]);
+        lines_getOffsetInfo(&lazy, text.data, text.length, offsets[i], &b[0], &b[1], &b[2], &b[3]);
+
+        if (memcmp(expect, a, sizeof(a)) != 0 || memcmp(expect, b, sizeof(b)) != 0) {
+            fprintf(stderr, "line info mismatch at offset %u: %u:%u vs %u:%u vs %u:%u\n",
+                offsets[i], expect[0], expect[1], a[0], a[1], b[0], b[1]);
+            exit(1);
+        }
+    }
+
+    u32 row, col, lineStart, lineLen;
+    f64 begin = bench_now();
+    for (u32 i = 0; i < lookups; i++) {
+        pos_getOffsetInfo(text.data, text.length, offsets[i], &row, &col, &lineStart, &lineLen);
+        bench_keep(row + col);
+    }
+    const f64 rescan = bench_now() - begin;
+
+    begin = bench_now();
+    for (u32 i = 0; i < lookups; i++) {
+        lines_getOffsetInfo(&lines, text.data, text.length, offsets[i], &row, &col, &lineStart, &lineLen);
+        bench_keep(row + col);
+    }
+    const f64 table = bench_now() - begin;
+
+    printf("%-12s %u lookups: rescan %.1f us, table %.3f us per lookup (%.0fx)\n", "",
+        lookups, rescan / lookups * 1e6, table / lookups * 1e6, rescan / table);
+
+    free(offsets);
+    lines_release(&lazy);
+    lines_release(&lines);
+    strPool_release(&pool);
+    reporter_clear(&reporter);
+    bench_freeText(&text);
+}
+
+static void _benchPlan(const u32 bytes, const u32 iterations) {
+    const BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+
+    // Scalar reference over the whole text
+    PlanCounts scalar = { 0 };
+    f64 begin = bench_now();
+    for (u32 it = 0; it < iterations; it++) {
+        scalar = (PlanCounts) { 0 };
+        for (u32 pos = 0; pos < text.length; )
+            pos = _plan_scalar(text.data, pos, text.length, text.length, &scalar);
+    }
+    const f64 scalarTime = bench_now() - begin;
+
+    CapacityPlan plan = { 0 };
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++) {
+        plan = plan_estimate(text.data, text.length);
+        bench_keep(plan.tokens);
+    }
+    const f64 planTime = bench_now() - begin;
+
+    const u32 scalarTokens = scalar.runs + (scalar.bytes - scalar.blanks - scalar.wordBytes) + 1;
+    if (scalarTokens != plan.tokens || scalar.words != plan.identifiers || scalar.newlines + 1 != plan.lines) {
+        fprintf(stderr, "plan mismatch: tokens %u vs %u, identifiers %u vs %u\n",
+            scalarTokens, plan.tokens, scalar.words, plan.identifiers);
+        exit(1);
+    }
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(plan.poolBytes, plan.poolSlots);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter, .plan = &plan };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    const TokenStore tl = Lexer_lex(&lexer);
+
+    usize identifiers = 0;
+    for (usize i = 0; i < tl.length; i++) identifiers += tokstore_type(&tl, (TokenId)i) == tt_identifier;
+
+    printf("\nCapacity plan %.1f MB/s (scalar %.1f MB/s)\n",
+        bench_mbps((usize)text.length * iterations, planTime),
+        bench_mbps((usize)text.length * iterations, scalarTime));
+    printf("%-12s planned %u, actual %zu (%+.1f%%)\n", "tokens",
+        plan.tokens, (size_t)tl.length, 100.0 * ((f64)plan.tokens / (f64)tl.length - 1));
+    printf("%-12s planned %u, actual %zu (%+.1f%%)\n", "identifiers",
+        plan.identifiers, identifiers, 100.0 * ((f64)plan.identifiers / (f64)identifiers - 1));
+    printf("%-12s planned %u, actual %u\n", "pool bytes", plan.poolBytes, pool.used);
+
+    tokstore_release(&tl);
+    strPool_release(&pool);
+    reporter_clear(&reporter);
+    bench_freeText(&text);
+}
+
+// Pre-store token list: one array of Token, copied to a 1.75x larger one
+// whenever it is more than 90% full
+typedef struct LegacyTokens {
+    Token* tokens;
+    usize length;
+    usize capacity;
+    usize peakBytes;    // Both arrays are live while realloc copies
+} LegacyTokens;
+
+static void _legacyPush(LegacyTokens* l, const Token tok) {
+    if ((float)l->length > (float)l->capacity * 0.90f) {
+        const usize capacity = (usize)((float)l->capacity * 1.75f);
+        const usize bytes = (l->capacity + capacity) * sizeof(Token);
+        if (bytes > l->peakBytes) l->peakBytes = bytes;
+
+        l->tokens = realloc(l->tokens, capacity * sizeof(Token));
+        l->capacity = capacity;
+    }
+
+    l->tokens[l->length++] = tok;
+}
+
+static bool _sameToken(const Token a, const Token b) {
+    return a.type == b.type && a.start == b.start && a.value.u == b.value.u
+        && a.lexeme.length == b.lexeme.length
+        && (a.lexeme.length == 0 || memcmp(a.lexeme.data, b.lexeme.data, a.lexeme.length) == 0);
+}
+
+static void _benchStorage(const u32 bytes, const u32 iterations) {
+    const BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    // Lexed once through pull mode, then pushed into both layouts
+    Lexer lexer = { .program = &program, .position = 0 };
+    LegacyTokens lexed = { .tokens = malloc(16 * sizeof(Token)), .capacity = 16 };
+    Token token;
+    do {
+        token = Lexer_next(&lexer);
+        _legacyPush(&lexed, token);
+    } while (token.type != tt_eof);
+
+    const usize count = lexed.length;
+    const Allocator heap = mem_heap;
+
+    f64 legacyPush = 0, storePush = 0, legacyScan = 0, storeScan = 0;
+    usize legacyPeak = 0, mismatches = 0;
+
+    for (u32 it = 0; it < iterations; it++) {
+        // Both start small, as for a source without a capacity plan
+        f64 begin = bench_now();
+        LegacyTokens l = { .tokens = malloc(16 * sizeof(Token)), .capacity = 16 };
+        for (usize i = 0; i < count; i++) _legacyPush(&l, lexed.tokens[i]);
+        legacyPush += bench_now() - begin;
+
+        begin = bench_now();
+        TokenStore ts = tokstore_new(16, src.data, &pool, heap);
+        for (usize i = 0; i < count; i++) tokstore_push(&ts, lexed.tokens[i]);
+        storePush += bench_now() - begin;
+
+        // Sequential scan of the types, what a parser loop touches most
+        begin = bench_now();
+        usize sum = 0;
+        for (usize i = 0; i < count; i++) sum += l.tokens[i].type;
+        legacyScan += bench_now() - begin;
+        bench_keep(sum);
+
+        begin = bench_now();
+        sum = 0;
+        for (TokenId i = 0; i < ts.length; i++) sum += tokstore_type(&ts, i);
+        storeScan += bench_now() - begin;
+        bench_keep(sum);
+
+        if (it == 0) {
+            for (TokenId i = 0; i < ts.length; i++)
+                mismatches += !_sameToken(tokstore_at(&ts, i), lexed.tokens[i]);
+            mismatches += ts.length != count;
+        }
+
+        legacyPeak = l.peakBytes > l.capacity * sizeof(Token) ? l.peakBytes : l.capacity * sizeof(Token);
+        free(l.tokens);
+        tokstore_release(&ts);
+    }
+
+    const f64 n = (f64)count * iterations;
+    printf("\nToken storage, %zu tokens: %zu mismatches\n", (size_t)count, (size_t)mismatches);
+    printf("%-12s %12s %12s %12s\n", "", "bytes/token", "push ns", "scan ns");
+    printf("%-12s %12.2f %12.2f %12.2f\n", "Token array",
+        (f64)legacyPeak / (f64)count, legacyPush / n * 1e9, legacyScan / n * 1e9);
+    printf("%-12s %12.2f %12.2f %12.2f\n", "TokenStore",
+        (f64)tokstore_bytesFor(count) / (f64)count, storePush / n * 1e9, storeScan / n * 1e9);
+
+    free(lexed.tokens);
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    bench_freeText(&text);
+}
+
+static const char* _editSnippets[] = {
+    "x", "7", " ", "\n", "_hover", " + 2", ".5", "#ff00aa", "0x1F", "(", ")", ", ",
+    "$primary", "\nnew_name: 0x10 + 3\n", "/* note */", ": ", "??", "@",
+};
+
+// Replaces `removed` bytes at `start` by `inserted` bytes of `insert`, the
+// text stays NUL terminated
+static SourceEdit _replace(BenchText* t, const u32 start, const u32 removed,
+    const char* insert, const u32 inserted) {
+    if (t->length - removed + inserted + 1 > t->capacity) {
+        t->capacity = (t->length - removed + inserted + 1) * 2;
+        t->data = realloc(t->data, t->capacity);
+    }
+
+    memmove(t->data + start + inserted, t->data + start + removed, t->length - start - removed + 1);
+    memcpy(t->data + start, insert, inserted);
+    t->length = t->length - removed + inserted;
+
+    return (SourceEdit) { .start = start, .oldLength = removed, .newLength = inserted };
+}
+
+// One random edit of `t`. An invalid '@' (only when
+// `errors` is set) is deleted again by the next edit, the lexer stops at it.
+static SourceEdit _randomEdit(BenchText* t, u64* rng, const bool errors, u32* invalidAt) {
+    u32 start = bench_randRange(rng, t->length + 1);
+    const u32 roll = bench_randRange(rng, 3);
+
+    // Inserts, deletes or both
+    u32 removed = roll == 0 ? 0 : bench_randRange(rng, 12);
+    const char* insert = "";
+    if (roll != 1) {
+        insert = _editSnippets[bench_randRange(rng, _bench_len(_editSnippets))];
+        if (insert[0] == '@' && (!errors || bench_randRange(rng, 8) != 0)) insert = "y";
+    }
+
+    if (*invalidAt != UINT32_MAX) {
+        start = *invalidAt;
+        removed = 1;
+        insert = "";
+        *invalidAt = UINT32_MAX;
+    } else if (insert[0] == '@') {
+        *invalidAt = start;
+    }
+
+    const u32 room = t->length - start;
+    if (removed > room) removed = room;
+    const u32 inserted = (u32)strlen(insert);
+
+    return _replace(t, start, removed, insert, inserted);
+}
+
+// Full lex of the current text with the same pool: same tokens, same ids
+static u32 _relexMismatches(Program* program, const TokenStore* tokens) {
+    Lexer lexer = { .program = program, .position = 0 };
+    Source* src = program->source;
+
+    LineTable* lines = src->lines;
+    LineTable fresh = lines_new(0);
+    src->lines = &fresh;
+
+    const TokenStore full = Lexer_lex(&lexer);
+    u32 mismatches = full.length != tokens->length;
+
+    for (TokenId i = 0; !mismatches && i < full.length; i++) {
+        mismatches += tokstore_type(&full, i) != tokstore_type(tokens, i)
+            || tokstore_start(&full, i) != tokstore_start(tokens, i)
+            || tokstore_length(&full, i) != tokstore_length(tokens, i)
+            || tokstore_value(&full, i).u != tokstore_value(tokens, i).u;
+    }
+
+    // The truncated table, finished on demand, must match a fresh one
+    lines_scanTo(lines, src->data, src->dataLength);
+    lines_scanTo(&fresh, src->data, src->dataLength);
+    mismatches += lines->length != fresh.length
+        || memcmp(lines->starts, fresh.starts, fresh.length * sizeof(u32)) != 0;
+
+    src->lines = lines;
+    lines_release(&fresh);
+    tokstore_release(&full);
+    return mismatches;
+}
+
+static int _compareF64(const void* a, const void* b) {
+    const f64 x = *(const f64*)a, y = *(const f64*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Average and median seconds per edit through Lexer_relex, and per full
+ * Lexer_lex. The average carries the edits that change how the rest of the
+ * file lexes (a deleted quote or comment end), those re-lex to eof on any
+ * size. The median is the edit that stays inside its declaration.
+ * Checked runs let the text drift edit after edit. Timed runs undo every
+ * edit right away (type, then backspace), so the text stays a valid theme
+ * and the lexer never stops early at an error the edits left behind.
+ */
+static void _timeRelex(const u32 bytes, const u32 edits, const bool check, f64* relex, f64* median,
+    f64* full, u32* mismatches) {
+    BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+    LineTable lines = lines_new(text.length / 32);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+        .lines = &lines,
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    // Best of three full lexes
+    Lexer lexer = { .program = &program, .position = 0 };
+    TokenStore tokens = { 0 };
+    *full = 1e9;
+
+    for (u32 i = 0; i < 3; i++) {
+        tokstore_release(&tokens);
+        Lexer_reset(&lexer);
+
+        const f64 begin = bench_now();
+        tokens = Lexer_lex(&lexer);
+        const f64 seconds = bench_now() - begin;
+        if (seconds < *full) *full = seconds;
+    }
+
+    u64 rng = 0xED17;
+    u32 invalidAt = UINT32_MAX;
+    f64 spent = 0;
+    f64* times = malloc(edits * 2 * sizeof(f64));
+    u32 timed = 0;
+
+    // Timed runs undo from a copy of the untouched text
+    char* pristine = check ? NULL : malloc(text.length + 1);
+    if (pristine) memcpy(pristine, text.data, text.length + 1);
+
+    for (u32 i = 0; i < edits; i++) {
+        SourceEdit edit = _randomEdit(&text, &rng, check, &invalidAt);
+
+        for (u32 pass = 0; pass < (check ? 1u : 2u); pass++) {
+            src.data = text.data;
+            src.dataLength = text.length;
+            reporter.errors.length = 0;
+
+            const f64 begin = bench_now();
+            const TokenSplice splice = Lexer_relex(&lexer, &tokens, edit);
+            const f64 seconds = bench_now() - begin;
+            spent += seconds;
+            times[timed++] = seconds;
+            bench_keep(splice.inserted);
+
+            if (check) *mismatches += _relexMismatches(&program, &tokens);
+            else if (pass == 0)
+                edit = _replace(&text, edit.start, edit.newLength, pristine + edit.start, edit.oldLength);
+        }
+    }
+
+    *relex = spent / timed;
+    qsort(times, timed, sizeof(f64), _compareF64);
+    *median = times[timed / 2];
+
+    free(times);
+    free(pristine);
+    tokstore_release(&tokens);
+    lines_release(&lines);
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    bench_freeText(&text);
+}
+
+static void _benchRelex(const u32 bytes) {
+    f64 relex, median, full;
+    u32 mismatches = 0;
+
+    const u32 checked = bytes < (256u << 10) ? bytes : 256u << 10;
+    _timeRelex(checked, 2000, true, &relex, &median, &full, &mismatches);
+    printf("\nIncremental re-lex: 2000 edits on %u bytes, %u mismatches\n", checked, mismatches);
+    if (mismatches) exit(1);
+
+    printf("%-12s %14s %12s %14s %10s\n", "bytes", "relex us/edit", "median us", "full lex us", "speedup");
+    for (u32 size = 64u << 10; size <= bytes * 4 && size <= (16u << 20); size *= 4) {
+        _timeRelex(size, 2000, false, &relex, &median, &full, &mismatches);
+        printf("%-12u %14.2f %12.2f %14.1f %9.0fx\n", size, relex * 1e6, median * 1e6, full * 1e6, full / relex);
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    const u32 bytes = argc > 1 ? (u32)strtoul(argv[1], NULL, 10) : 4u << 20;
+    const u32 iterations = argc > 2 ? (u32)strtoul(argv[2], NULL, 10) : 10;
+
+    _benchScanners(bytes, iterations);
+    _benchLexer(bytes, iterations);
+    _benchPool(bytes);
+    _verifyValues(bytes);
+    _benchLines(bytes, iterations, 2000);
+    _benchPlan(bytes, iterations);
+    _benchStorage(bytes, iterations);
+    _benchRelex(bytes);
+    return 0;
+}
+
+// Build (from implementations/C):
+// gcc -O3 -o bench-lexer bench/bench-lexer.c lexer/lexer.c program/string-pool.c
+//     program/source.c error/errors.c error/reporter.c utils/strings.c utils/memory.c
+// Add -mavx2 (or -march=native) for the 32-byte path, -DTSTM_NO_SIMD for scalar only.
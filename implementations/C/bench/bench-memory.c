@@ -0,0 +1,245 @@
+/*
+ * @file bench-memory.c
+ *
+ * Bit-buffer shift / rotate benchmark for utils/memory.c.
+ *
+ * The word / SSE2 `memBitShl`, `memBitShr`, `memBitRol` and `memBitRor`
+ * against the byte-per-iteration versions they replaced (the old rotates
+ * copy the buffer and run two full shifts). Every size from 1 to 300
+ * bytes, and a few large odd ones, is checked for identical output over
+ * edge and random shift amounts before timing.
+ *
+ * Timing runs buffers from 4 bytes to 1 MB, the same bytes processed per
+ * size, with a bit-only amount (3 bits) and a byte + bit amount.
+ *
+ * Usage: bench-memory [megabytes-per-measure]
+ */
+
+#include "bench.h"
+#include "../utils/memory.h"
+
+typedef void (*BitFn)(void* data, usize bits, usize size);
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// OLD VERSIONS
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static void _legacyShl(void* data, usize bits, const usize size) {
+    if (!size) return;
+
+    bits %= (size * 8);
+    if (!bits) return;
+
+    u8* p = (u8*)data;
+
+    const usize byteShift = bits >> 3;
+    const usize bitShift  = bits & 7;
+
+    if (byteShift) {
+        memmove(p, p + byteShift, size - byteShift);
+        memset(p + size - byteShift, 0, byteShift);
+    }
+
+    if (bitShift) {
+        for (usize i = 0; i < size - 1; ++i) {
+            p[i] = (u8)((p[i] << bitShift) |
+                        (p[i + 1] >> (8 - bitShift)));
+        }
+        p[size - 1] <<= bitShift;
+    }
+}
+
+static void _legacyShr(void* data, usize bits, const usize size) {
+    if (!size) return;
+
+    bits %= (size * 8);
+    if (!bits) return;
+
+    u8* p = (u8*)data;
+
+    const usize byteShift = bits >> 3;
+    const usize bitShift  = bits & 7;
+
+    if (byteShift) {
+        memmove(p + byteShift, p, size - byteShift);
+        memset(p, 0, byteShift);
+    }
+
+    if (bitShift) {
+        for (usize i = size - 1; i > 0; --i) {
+            p[i] = (u8)((p[i] >> bitShift) |
+                        (p[i - 1] << (8 - bitShift)));
+        }
+        p[0] >>= bitShift;
+    }
+}
+
+static void _legacyRotate(void* data, usize rotate, const usize size, const bool left) {
+    if (!size) return;
+
+    rotate %= (size * 8);
+    if (!rotate) return;
+
+    u8* p = (u8*)data;
+
+    u8 stackBuf[256];
+    u8* tmp = (size <= sizeof(stackBuf))
+        ? stackBuf
+        : (u8*)malloc(size);
+
+    if (!tmp) return;
+
+    memcpy(tmp, p, size);
+
+    if (left) {
+        _legacyShl(p, rotate, size);
+        _legacyShr(tmp, (size * 8) - rotate, size);
+    } else {
+        _legacyShr(p, rotate, size);
+        _legacyShl(tmp, (size * 8) - rotate, size);
+    }
+
+    for (usize i = 0; i < size; ++i)
+        p[i] |= tmp[i];
+
+    if (tmp != stackBuf)
+        free(tmp);
+}
+
+static void _legacyRol(void* data, const usize rotate, const usize size) {
+    _legacyRotate(data, rotate, size, true);
+}
+
+static void _legacyRor(void* data, const usize rotate, const usize size) {
+    _legacyRotate(data, rotate, size, false);
+}
+
+typedef struct BitOp {
+    const char* name;
+    BitFn fast;
+    BitFn legacy;
+} BitOp;
+
+static const BitOp _ops[] = {
+    { "shl", memBitShl, _legacyShl },
+    { "shr", memBitShr, _legacyShr },
+    { "rol", memBitRol, _legacyRol },
+    { "ror", memBitRor, _legacyRor },
+};
+
+#define OP_COUNT (sizeof(_ops) / sizeof(_ops[0]))
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CHECK
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static void _fill(u8* p, const usize size, u64* rng) {
+    for (usize i = 0; i < size; i++) p[i] = (u8)bench_rand(rng);
+}
+
+// Both versions on copies of one random buffer, false on any difference
+static bool _checkOne(const BitOp* op, u8* a, u8* b, const usize size, const usize bits, u64* rng) {
+    _fill(a, size, rng);
+    memcpy(b, a, size);
+
+    op->fast(a, bits, size);
+    op->legacy(b, bits, size);
+
+    if (memcmp(a, b, size) == 0) return true;
+
+    fprintf(stderr, "%s mismatch: %zu bytes by %zu bits\n", op->name, (size_t)size, (size_t)bits);
+    return false;
+}
+
+static void _checkSize(const usize size, u8* a, u8* b, u64* rng, u32* checks, u32* mismatches) {
+    const usize total = size * 8;
+    const usize edges[] = { 0, 1, 3, 7, 8, 9, 15, 16, 17, 63, 64, 65, 127, 128, 129,
+        total / 2, total - 9, total - 8, total - 1, total, total + 5 };
+
+    for (u32 o = 0; o < OP_COUNT; o++) {
+        for (u32 e = 0; e < sizeof(edges) / sizeof(edges[0]); e++) {
+            *checks += 1;
+            *mismatches += !_checkOne(&_ops[o], a, b, size, edges[e], rng);
+        }
+        for (u32 r = 0; r < 16; r++) {
+            *checks += 1;
+            *mismatches += !_checkOne(&_ops[o], a, b, size, (usize)bench_rand(rng) % (total * 2), rng);
+        }
+    }
+}
+
+static u32 _check(void) {
+    static const usize large[] = { 1000, 4099, 65537, 300007 };
+    const usize maxSize = 300007;
+
+    u8* a = malloc(maxSize);
+    u8* b = malloc(maxSize);
+    u64 rng = 0xC0FFEE;
+    u32 checks = 0, mismatches = 0;
+
+    for (usize size = 1; size <= 300; size++) _checkSize(size, a, b, &rng, &checks, &mismatches);
+    for (u32 i = 0; i < sizeof(large) / sizeof(large[0]); i++)
+        _checkSize(large[i], a, b, &rng, &checks, &mismatches);
+
+    printf("%u checks, %u mismatches\n", checks, mismatches);
+
+    free(a);
+    free(b);
+    return mismatches;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// THROUGHPUT
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// MB/s of `fn` over `bytes` processed in buffers of `size`
+static f64 _time(const BitFn fn, u8* buf, const usize size, const usize bits, const usize bytes) {
+    const usize rounds = bytes / size ? bytes / size : 1;
+
+    const f64 start = bench_now();
+    for (usize r = 0; r < rounds; r++) fn(buf, bits, size);
+    const f64 seconds = bench_now() - start;
+
+    bench_keep(buf[0] + buf[size - 1]);
+    return bench_mbps(rounds * size, seconds);
+}
+
+static void _benchSizes(const usize bytes) {
+    static const usize sizes[] = { 4, 16, 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576 };
+    const usize maxSize = 1048576;
+
+    u8* buf = malloc(maxSize);
+    u64 rng = 0xBEEF;
+    _fill(buf, maxSize, &rng);
+
+    for (u32 amount = 0; amount < 2; amount++) {
+        printf("\n%s\n", amount == 0 ? "3 bits" : "size/3 bytes + 5 bits");
+        printf("%-8s %-4s %12s %12s %8s\n", "bytes", "op", "old MB/s", "new MB/s", "speedup");
+
+        for (u32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            const usize size = sizes[s];
+            const usize bits = amount == 0 ? 3 : (size / 3) * 8 + 5;
+
+            for (u32 o = 0; o < OP_COUNT; o++) {
+                const f64 old = _time(_ops[o].legacy, buf, size, bits, bytes);
+                const f64 now = _time(_ops[o].fast, buf, size, bits, bytes);
+                printf("%-8zu %-4s %12.1f %12.1f %7.2fx\n",
+                    (size_t)size, _ops[o].name, old, now, old > 0 ? now / old : 0);
+            }
+        }
+    }
+
+    free(buf);
+}
+
+int main(const int argc, char* argv[]) {
+    const usize megabytes = argc > 1 ? (usize)strtoul(argv[1], NULL, 10) : 64;
+
+    if (_check() != 0) return 1;
+    _benchSizes((megabytes ? megabytes : 1) << 20);
+    return 0;
+}
+
+// Build (from implementations/C):
+// gcc -O3 -o bench-memory bench/bench-memory.c utils/memory.c
+// Add -DTSTM_NO_SIMD to time the 64-bit word path without SSE2.
@@ -0,0 +1,935 @@
+/*
+ * @file bench-parser.c
+ *
+ * Parser benchmark.
+ *
+ * 1. Precedence check: small random programs over every operator, prefix
+ *    operators, parentheses, ternaries, calls, `$` access, inline and
+ *    unnamed declarations, ';' and the odd broken declaration, parsed by
+ *    Parser_parse and by a plain recursive descent reference (one function
+ *    per precedence level, the shape of the Dart parser). Both trees,
+ *    printed in post-order with source positions, must be identical, up to
+ *    the first broken declaration. A hash-consed parse, copied back into a
+ *    tree by ast_linearize, must have the same nodes.
+ * 2. Incremental re-parse: random edits through Lexer_relex and
+ *    Parser_reparse, each undone again, and after every step the tree must
+ *    print the same as a full parse of the current text, and ast_linearize
+ *    of it must be that full parse node for node. Then Parser_reparse time
+ *    per edit from 64 KB to 4 MB.
+ * 3. Parser_parse throughput over a lexed theme corpus in MB/s,
+ *    declarations/s and nodes/s, then lex + parse fused in pull mode.
+ * 4. Parallel parse: Parser_parseParallel must give the same nodes, child
+ *    slots and errors as Parser_parse for every thread count, on a corpus
+ *    full of lines that start with `name:` inside a call (splits that are
+ *    not declarations) and broken past two thirds. Then wall time by
+ *    thread count against Parser_parse.
+ *
+ * Usage: bench-parser [corpus-bytes] [iterations]
+ */
+
+#include "bench.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../parser/nodes-get.h"
+#include "../constants/const-lexer.h"
+#include "../error/reporter.h"
+#include "../utils/threads.h"
+
+#include <stdarg.h>
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// TREE PRINTING
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static const char* _opSymbols[] = {
+    [OP_NEG] = "-", [OP_NOT] = "!", [OP_POS] = "+", [OP_BNOT] = "~",
+    [OP_ADD] = "+", [OP_SUB] = "-", [OP_MUL] = "*", [OP_DIV] = "/",
+    [OP_EQ] = "==", [OP_NEQ] = "!=", [OP_AEQ] = "~==", [OP_NAEQ] = "!~=",
+    [OP_SEQ] = "===", [OP_NSEQ] = "!==",
+    [OP_LT] = "<", [OP_GT] = ">", [OP_LE] = "<=", [OP_GE] = ">=",
+    [OP_AND] = "&", [OP_OR] = "|", [OP_XOR] = "^", [OP_LXOR] = "^^",
+    [OP_LAND] = "&&", [OP_LOR] = "||",
+    [OP_SHL] = "<<", [OP_SHR] = ">>", [OP_ROL] = "<<<", [OP_ROR] = ">>>",
+    [OP_MOD] = "%", [OP_IDIV] = "/%", [OP_POW] = "**",
+    [OP_COALESCE] = "??", [OP_GUARD] = "!!",
+};
+
+static void _emit(BenchText* out, const char* format, ...) {
+    char buf[96];
+
+    va_list args;
+    va_start(args, format);
+    const int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    _bench_put(out, buf, (u32)n);
+}
+
+// Children first, then the node: kind, data and source position. `decl`
+// is the root declaration the node is in
+static void _printNode(BenchText* out, const AstArena* ast, const u32 decl, const NodeId id) {
+    const AstNode* n = &ast->nodes[id];
+    const u32 count = ast_getChildCount(ast, id);
+    const u32 pos = ast_getPosIn(ast, decl, id);
+
+    for (u32 i = 0; i < count; i++) _printNode(out, ast, decl, ast_getChildOf(ast, id, i));
+
+    switch (n->kind) {
+        case NODE_DECL: _emit(out, "D%u@%u ", n->data, pos); break;
+        case NODE_IDENT: _emit(out, "N%u@%u ", n->data, pos); break;
+        case NODE_ACCESS: _emit(out, "$%u@%u ", n->data, pos); break;
+        case NODE_LIT_INT: _emit(out, "I%d@%u ", (i32)n->data, pos); break;
+        case NODE_LIT_FLOAT: _emit(out, "F%08x@%u ", n->data, pos); break;
+        case NODE_UNARY: _emit(out, "U%s@%u ", _opSymbols[n->info], pos); break;
+        case NODE_BINARY: _emit(out, "B%s@%u ", _opSymbols[n->info], pos); break;
+        case NODE_TERNARY: _emit(out, "?@%u ", pos); break;
+        case NODE_CALL: _emit(out, "C%u/%u@%u ", n->data, count, pos); break;
+        default: _emit(out, "X%u ", n->kind); break;
+    }
+}
+
+// One root declaration per line
+static void _printTree(BenchText* out, const AstArena* ast) {
+    if (ast->root == NODE_NONE) return;
+
+    const AstNode* root = &ast->nodes[ast->root];
+    for (u32 i = 0; i < root->data; i++) {
+        _printNode(out, ast, i, ast->children[root->firstChild + i]);
+        _bench_puts(out, "\n");
+    }
+}
+
+// Same nodes and child slots, source positions aside
+static bool _sameNodes(const AstArena* a, const AstArena* b) {
+    if (a->nodeLength != b->nodeLength || a->childLength != b->childLength || a->root != b->root)
+        return false;
+
+    return memcmp(a->nodes, b->nodes, a->nodeLength * sizeof(AstNode)) == 0
+        && memcmp(a->children, b->children, a->childLength * sizeof(NodeId)) == 0;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// REFERENCE PARSER
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Recursive descent straight from tokens to the printed form, false at
+// the first syntax error
+typedef struct RefParser {
+    const TokenStore* tokens;
+    const char* data;
+    TokenId position;
+    BenchText* out;
+} RefParser;
+
+// Binary levels from ternary down to power, left associative
+#define REF_LEVELS 12
+
+static const TokenType _refLevels[REF_LEVELS][7] = {
+    { tt_coalesce, tt_guard, tt_eof },
+    { tt_logicalOr, tt_eof },
+    { tt_logicalXor, tt_eof },
+    { tt_logicalAnd, tt_eof },
+    { tt_equalEqual, tt_notEqual, tt_approxEqual, tt_notApproxEqual,
+      tt_strictEqual, tt_strictNotEqual, tt_eof },
+    { tt_less, tt_greater, tt_lessEqual, tt_greaterEqual, tt_eof },
+    { tt_bitOr, tt_eof },
+    { tt_bitXor, tt_eof },
+    { tt_bitAnd, tt_eof },
+    { tt_shiftLeft, tt_shiftRight, tt_rotLeft, tt_rotRight, tt_eof },
+    { tt_plus, tt_minus, tt_eof },
+    { tt_star, tt_slash, tt_percent, tt_intDiv, tt_eof },
+};
+
+static TokenType _refType(const RefParser* r) {
+    return tokstore_type(r->tokens, r->position);
+}
+
+static u32 _refStart(const RefParser* r) {
+    return tokstore_start(r->tokens, r->position);
+}
+
+static bool _refMatch(RefParser* r, const TokenType type) {
+    if (_refType(r) != type) return false;
+
+    r->position++;
+    return true;
+}
+
+static bool _refIn(const u32 level, const TokenType type) {
+    for (const TokenType* t = _refLevels[level]; *t != tt_eof; t++)
+        if (*t == type) return true;
+
+    return false;
+}
+
+// Node symbol straight from the operator lexeme
+static void _refEmitOp(const RefParser* r, const char kind, const TokenId op, const u32 start) {
+    const u32 at = tokstore_start(r->tokens, op);
+    _emit(r->out, "%c%.*s@%u ", kind, (int)tokstore_length(r->tokens, op), r->data + at, start);
+}
+
+static bool _refExpression(RefParser* r);
+
+static bool _refPrimary(RefParser* r) {
+    const TokenType type = _refType(r);
+    const u32 start = _refStart(r);
+    const TokenValue value = tokstore_value(r->tokens, r->position);
+    r->position++;
+
+    switch (type) {
+        case tt_int32: case tt_hexColor: case tt_hex: case tt_oct: case tt_bin: case tt_mask:
+            _emit(r->out, "I%d@%u ", value.i, start);
+            return true;
+
+        case tt_float32: case tt_exp:
+            _emit(r->out, "F%08x@%u ", value.u, start);
+            return true;
+
+        case tt_dollar: {
+            const SymbolId name = tokstore_symbol(r->tokens, r->position);
+            if (!_refMatch(r, tt_identifier)) return false;
+
+            _emit(r->out, "$%u@%u ", name, start);
+            return true;
+        }
+
+        case tt_identifier: {
+            if (!_refMatch(r, tt_lParen)) {
+                _emit(r->out, "N%u@%u ", value.u, start);
+                return true;
+            }
+
+            u32 args = 0;
+            if (!_refMatch(r, tt_rParen)) {
+                do {
+                    if (_refType(r) == tt_rParen) break;
+                    if (!_refExpression(r)) return false;
+                    args++;
+                } while (_refMatch(r, tt_comma));
+
+                if (!_refMatch(r, tt_rParen)) return false;
+            }
+
+            _emit(r->out, "C%u/%u@%u ", value.u, args, start);
+            return true;
+        }
+
+        case tt_lParen:
+            return _refExpression(r) && _refMatch(r, tt_rParen);
+
+        default:
+            return false;
+    }
+}
+
+static bool _refUnary(RefParser* r) {
+    const TokenType type = _refType(r);
+    if (type != tt_not && type != tt_minus && type != tt_plus && type != tt_bitNot)
+        return _refPrimary(r);
+
+    const TokenId op = r->position++;
+    if (!_refUnary(r)) return false;
+
+    _refEmitOp(r, 'U', op, tokstore_start(r->tokens, op));
+    return true;
+}
+
+static bool _refPower(RefParser* r) {
+    const u32 start = _refStart(r);
+    if (!_refUnary(r)) return false;
+
+    const TokenId op = r->position;
+    if (!_refMatch(r, tt_power)) return true;
+    if (!_refPower(r)) return false;
+
+    _refEmitOp(r, 'B', op, start);
+    return true;
+}
+
+static bool _refLevel(RefParser* r, const u32 level) {
+    if (level == REF_LEVELS) return _refPower(r);
+
+    const u32 start = _refStart(r);
+    if (!_refLevel(r, level + 1)) return false;
+
+    while (_refIn(level, _refType(r))) {
+        const TokenId op = r->position++;
+        if (!_refLevel(r, level + 1)) return false;
+
+        _refEmitOp(r, 'B', op, start);
+    }
+
+    return true;
+}
+
+static bool _refTernary(RefParser* r) {
+    const u32 start = _refStart(r);
+    if (!_refLevel(r, 0)) return false;
+    if (!_refMatch(r, tt_question)) return true;
+
+    if (!_refTernary(r) || !_refMatch(r, tt_colon) || !_refTernary(r)) return false;
+
+    _emit(r->out, "?@%u ", start);
+    return true;
+}
+
+static bool _refDecl(RefParser* r) {
+    const u32 start = _refStart(r);
+
+    SymbolId name = SYMBOL_NONE;
+    if (_refType(r) == tt_identifier) name = tokstore_symbol(r->tokens, r->position++);
+
+    if (!_refMatch(r, tt_colon) || !_refExpression(r)) return false;
+
+    _emit(r->out, "D%u@%u ", name, start);
+    return true;
+}
+
+static bool _refExpression(RefParser* r) {
+    const bool ok = _refType(r) == tt_identifier && tokstore_type(r->tokens, r->position + 1) == tt_colon
+        ? _refDecl(r)
+        : _refTernary(r);
+
+    while (_refMatch(r, tt_semicolon)) {}
+    return ok;
+}
+
+static void _refProgram(RefParser* r) {
+    while (r->position < r->tokens->length && _refType(r) != tt_eof) {
+        const u32 mark = r->out->length;
+
+        if (!_refDecl(r)) {
+            r->out->length = mark;
+            break;
+        }
+        _bench_puts(r->out, "\n");
+    }
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// PRECEDENCE CHECK
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static const char* _binaryOps[] = {
+    "??", "!!", "||", "^^", "&&", "==", "!=", "~==", "!~=", "===", "!==",
+    "<", ">", "<=", ">=", "|", "^", "&", "<<", ">>", "<<<", ">>>",
+    "+", "-", "*", "/", "%", "/%", "**",
+};
+
+static const char* _prefixOps[] = { "-", "+", "!", "~" };
+
+static const char* _literals[] = {
+    "7", "42", "1.5", "0.25", "0x1F", "0b101", "0o17", "2e-3", "#a0b0c0", "#80ff0000",
+};
+
+static const char* _names[] = { "a", "b", "color", "size", "rgba", "mix" };
+
+static void _genExpr(BenchText* t, u64* rng, u32 depth);
+
+static void _genOperand(BenchText* t, u64* rng, const u32 depth) {
+    const char* name = _names[bench_randRange(rng, _bench_len(_names))];
+
+    switch (bench_randRange(rng, depth ? 9 : 4)) {
+        case 0:
+        case 1:
+            _bench_puts(t, _literals[bench_randRange(rng, _bench_len(_literals))]);
+            break;
+
+        case 2:
+            _bench_puts(t, name);
+            break;
+
+        case 3:
+            _bench_puts(t, "$");
+            _bench_puts(t, name);
+            break;
+
+        case 4:
+            // Spaced, "!" twice would lex as "!!"
+            _bench_puts(t, _prefixOps[bench_randRange(rng, _bench_len(_prefixOps))]);
+            _bench_puts(t, " ");
+            _genOperand(t, rng, depth - 1);
+            break;
+
+        case 5:
+        case 6:
+            _bench_puts(t, "(");
+            _genExpr(t, rng, depth - 1);
+            _bench_puts(t, ")");
+            break;
+
+        case 7:
+            _bench_puts(t, "(");
+            _bench_puts(t, name);
+            _bench_puts(t, ": ");
+            _genExpr(t, rng, depth - 1);
+            _bench_puts(t, ")");
+            break;
+
+        default: {
+            _bench_puts(t, name);
+            _bench_puts(t, "(");
+
+            const u32 args = bench_randRange(rng, 4);
+            for (u32 a = 0; a < args; a++) {
+                if (a) _bench_puts(t, ", ");
+                _genExpr(t, rng, depth - 1);
+            }
+
+            if (args && bench_randRange(rng, 8) == 0) _bench_puts(t, ",");
+            _bench_puts(t, ")");
+            break;
+        }
+    }
+}
+
+static void _genExpr(BenchText* t, u64* rng, const u32 depth) {
+    const u32 terms = 1 + bench_randRange(rng, 5);
+
+    for (u32 i = 0; i < terms; i++) {
+        if (i) {
+            _bench_puts(t, " ");
+            _bench_puts(t, _binaryOps[bench_randRange(rng, _bench_len(_binaryOps))]);
+            _bench_puts(t, " ");
+        }
+        _genOperand(t, rng, depth);
+    }
+
+    if (bench_randRange(rng, 6) == 0) {
+        _bench_puts(t, " ? ");
+        _genExpr(t, rng, depth ? depth - 1 : 0);
+        _bench_puts(t, " : ");
+        _genExpr(t, rng, depth ? depth - 1 : 0);
+    }
+}
+
+// A few declarations, unnamed ones, trailing ';' and now and then a
+// stray token that breaks the declaration it follows
+static void _genProgram(BenchText* t, u64* rng) {
+    static const char* broken[] = { ")", ",", "?", "(", "$", ": :" };
+    const u32 decls = 1 + bench_randRange(rng, 12);
+
+    t->length = 0;
+    for (u32 d = 0; d < decls; d++) {
+        if (bench_randRange(rng, 16) != 0) _bench_puts(t, _names[bench_randRange(rng, _bench_len(_names))]);
+        _bench_puts(t, ": ");
+        _genExpr(t, rng, 3);
+
+        if (bench_randRange(rng, 8) == 0) _bench_puts(t, ";");
+        if (bench_randRange(rng, 40) == 0) {
+            _bench_puts(t, " ");
+            _bench_puts(t, broken[bench_randRange(rng, _bench_len(broken))]);
+        }
+        _bench_puts(t, "\n");
+    }
+}
+
+static void _checkPrecedence(const u32 programs) {
+    BenchText text = { 0 }, expected = { 0 }, actual = { 0 };
+    StringPool pool = strPool_new(1 << 12, 1 << 8);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+
+    u64 rng = 0x5EED;
+    u32 decls = 0, broken = 0, mismatches = 0, shared = 0, sharedMismatches = 0;
+
+    for (u32 p = 0; p < programs; p++) {
+        _genProgram(&text, &rng);
+
+        Source src = {
+            .data = text.data, .dataLength = text.length,
+            .name = "check.tstm", .nameLength = slenof("check.tstm"),
+        };
+        Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+        reporter.errors.length = 0;
+
+        Lexer lexer = { .program = &program, .position = 0 };
+        const TokenStore tokens = Lexer_lex(&lexer);
+
+        Parser parser = { .program = &program, .tokens = tokens };
+        const AstArena ast = Parser_parse(&parser);
+
+        actual.length = 0;
+        _printTree(&actual, &ast);
+
+        expected.length = 0;
+        RefParser ref = { .tokens = &tokens, .data = text.data, .out = &expected };
+        _refProgram(&ref);
+
+        decls += ast.nodes[ast.root].data;
+        broken += reporter.errors.length != 0;
+
+        if (actual.length != expected.length || memcmp(actual.data, expected.data, actual.length) != 0) {
+            if (mismatches++ < 3)
+                fprintf(stderr, "mismatch in:\n%.*s\nexpected:\n%.*s\nactual:\n%.*s\n",
+                    (int)text.length, text.data, (int)expected.length, expected.data,
+                    (int)actual.length, actual.data);
+        }
+
+        // Hash-consed, then copied back into a tree: the same nodes
+        Parser sharing = { .program = &program, .tokens = tokens, .share = true };
+        const AstArena dag = Parser_parse(&sharing);
+        const AstArena tree = ast_linearize(&dag);
+
+        shared += dag.shareHits;
+        if (!_sameNodes(&tree, &ast) && sharedMismatches++ < 3)
+            fprintf(stderr, "shared parse differs in:\n%.*s\n", (int)text.length, text.data);
+
+        ast_release(&tree);
+        ast_release(&dag);
+        ast_release(&ast);
+        tokstore_release(&tokens);
+    }
+
+    printf("Precedence: %u programs, %u declarations, %u broken, %u mismatches, "
+        "%u nodes shared, %u shared mismatches\n",
+        programs, decls, broken, mismatches, shared, sharedMismatches);
+
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    bench_freeText(&text);
+    bench_freeText(&expected);
+    bench_freeText(&actual);
+
+    if (mismatches || sharedMismatches) exit(1);
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// INCREMENTAL RE-PARSE
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static const char* _editSnippets[] = {
+    "x", "7", " ", "\n", "_hover", " + 2", " * ", "#ff00aa", "(", ")", ", ", "? 1 : ",
+    "$primary", "\nnew_name: 0x10 + 3\n", "/* note */", ": ", "??", "-",
+};
+
+// Replaces `removed` bytes at `start` by `inserted` bytes of `insert`
+static SourceEdit _replace(BenchText* t, const u32 start, const u32 removed,
+    const char* insert, const u32 inserted) {
+    if (t->length - removed + inserted + 1 > t->capacity) {
+        t->capacity = (t->length - removed + inserted + 1) * 2;
+        t->data = realloc(t->data, t->capacity);
+    }
+
+    memmove(t->data + start + inserted, t->data + start + removed, t->length - start - removed + 1);
+    memcpy(t->data + start, insert, inserted);
+    t->length = t->length - removed + inserted;
+
+    return (SourceEdit) { .start = start, .oldLength = removed, .newLength = inserted };
+}
+
+// Same nodes, positions and child slots
+static bool _sameArena(const AstArena* a, const AstArena* b) {
+    return _sameNodes(a, b) && memcmp(a->positions, b->positions, a->nodeLength * sizeof(u32)) == 0;
+}
+
+// Full lex and parse of the current text with the same pool, printed
+static AstArena _parseFull(Program* program, BenchText* out) {
+    Lexer lexer = { .program = program, .position = 0 };
+    const TokenStore tokens = Lexer_lex(&lexer);
+
+    Parser parser = { .program = program, .tokens = tokens };
+    const AstArena ast = Parser_parse(&parser);
+
+    out->length = 0;
+    _printTree(out, &ast);
+
+    tokstore_release(&tokens);
+    return ast;
+}
+
+static void _checkReparse(const u32 bytes, const u32 edits) {
+    BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+    BenchText pristine = { 0 }, expected = { 0 }, actual = { 0 };
+    _bench_put(&pristine, text.data, text.length);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    Parser parser = { .program = &program, .tokens = Lexer_lex(&lexer) };
+    AstArena ast = Parser_parse(&parser);
+
+    u64 rng = 0xED17;
+    u32 mismatches = 0, failed = 0, linearMismatches = 0;
+    usize reparsed = 0;
+
+    for (u32 i = 0; i < edits; i++) {
+        const u32 start = bench_randRange(&rng, text.length + 1);
+        u32 removed = bench_randRange(&rng, 3) == 0 ? 0 : bench_randRange(&rng, 12);
+        if (removed > text.length - start) removed = text.length - start;
+
+        const char* insert = bench_randRange(&rng, 3) == 1 ? ""
+            : _editSnippets[bench_randRange(&rng, _bench_len(_editSnippets))];
+
+        SourceEdit edit = _replace(&text, start, removed, insert, (u32)strlen(insert));
+
+        // The edit, then its undo
+        for (u32 pass = 0; pass < 2; pass++) {
+            src.data = text.data;
+            src.dataLength = text.length;
+            reporter.errors.length = 0;
+
+            const TokenSplice splice = Lexer_relex(&lexer, &parser.tokens, edit);
+            const u32 before = ast.nodeLength;
+            failed += !Parser_reparse(&parser, &ast, &splice);
+            reparsed += ast.nodeLength - before;
+
+            actual.length = 0;
+            _printTree(&actual, &ast);
+            const AstArena full = _parseFull(&program, &expected);
+
+            if (actual.length != expected.length || memcmp(actual.data, expected.data, actual.length) != 0) {
+                if (mismatches++ < 3) fprintf(stderr, "re-parse mismatch after edit %u at %u\n", i, start);
+            }
+
+            // Back in post-order, node for node what the full parse made
+            const AstArena linear = ast_linearize(&ast);
+            if (!_sameArena(&linear, &full) && linearMismatches++ < 3)
+                fprintf(stderr, "ast_linearize differs from a full parse after edit %u at %u\n", i, start);
+
+            ast_release(&linear);
+            ast_release(&full);
+
+            if (pass == 0) edit = _replace(&text, start, edit.newLength, pristine.data + start, removed);
+        }
+    }
+
+    printf("Re-parse: %u edits and undos on %u bytes, %.1f nodes re-made per edit, %u failed, %u mismatches"
+        ", %u linearized mismatches\n",
+        edits, text.length, (f64)reparsed / (edits * 2), failed, mismatches, linearMismatches);
+
+    ast_release(&ast);
+    tokstore_release(&parser.tokens);
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    bench_freeText(&text);
+    bench_freeText(&pristine);
+    bench_freeText(&expected);
+    bench_freeText(&actual);
+
+    if (mismatches || failed || linearMismatches) exit(1);
+}
+
+static int _compareF64(const void* a, const void* b) {
+    const f64 x = *(const f64*)a, y = *(const f64*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Seconds per Parser_reparse, average and median, over `edits` random edits
+ * and their undos on a theme of `bytes`. An edit that breaks a declaration
+ * drops everything after it, its undo parses all of that again on any
+ * size; the median is the edit that stays inside its declaration. Replaced
+ * nodes pile up, the arena is linearized (untimed) when it doubled.
+ */
+static void _timeReparse(const u32 bytes, const u32 edits, f64* mean, f64* median) {
+    BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+    BenchText pristine = { 0 };
+    _bench_put(&pristine, text.data, text.length);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    Parser parser = { .program = &program, .tokens = Lexer_lex(&lexer) };
+    AstArena ast = Parser_parse(&parser);
+
+    const u32 parsed = ast.nodeLength;
+    f64* times = malloc(edits * 2 * sizeof(f64));
+    f64 spent = 0;
+    u64 rng = 0xED17;
+
+    for (u32 i = 0; i < edits; i++) {
+        const u32 start = bench_randRange(&rng, text.length + 1);
+        u32 removed = bench_randRange(&rng, 3) == 0 ? 0 : bench_randRange(&rng, 12);
+        if (removed > text.length - start) removed = text.length - start;
+
+        const char* insert = bench_randRange(&rng, 3) == 1 ? ""
+            : _editSnippets[bench_randRange(&rng, _bench_len(_editSnippets))];
+
+        SourceEdit edit = _replace(&text, start, removed, insert, (u32)strlen(insert));
+
+        for (u32 pass = 0; pass < 2; pass++) {
+            src.data = text.data;
+            src.dataLength = text.length;
+            reporter.errors.length = 0;
+
+            const TokenSplice splice = Lexer_relex(&lexer, &parser.tokens, edit);
+
+            const f64 begin = bench_now();
+            Parser_reparse(&parser, &ast, &splice);
+            const f64 seconds = bench_now() - begin;
+
+            spent += seconds;
+            times[i * 2 + pass] = seconds;
+
+            if (ast.nodeLength > parsed * 2) {
+                const AstArena linear = ast_linearize(&ast);
+                ast_release(&ast);
+                ast = linear;
+            }
+
+            if (pass == 0) edit = _replace(&text, start, edit.newLength, pristine.data + start, removed);
+        }
+    }
+
+    qsort(times, edits * 2, sizeof(f64), _compareF64);
+    *mean = spent / (edits * 2);
+    *median = times[edits];
+
+    free(times);
+    ast_release(&ast);
+    tokstore_release(&parser.tokens);
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    bench_freeText(&text);
+    bench_freeText(&pristine);
+}
+
+static void _benchReparse(const u32 bytes) {
+    printf("\n%-12s %14s %12s\n", "bytes", "reparse us", "median us");
+
+    for (u32 size = 64u << 10; size <= bytes && size <= (4u << 20); size *= 4) {
+        f64 mean, median;
+        _timeReparse(size, 1000, &mean, &median);
+        printf("%-12u %14.2f %12.2f\n", size, mean * 1e6, median * 1e6);
+    }
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// THROUGHPUT
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static void _benchParse(const u32 bytes, const u32 iterations) {
+    const BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    const TokenStore tokens = Lexer_lex(&lexer);
+
+    // Tokens lexed once, parsed `iterations` times
+    u32 decls = 0, nodes = 0;
+    f64 begin = bench_now();
+
+    for (u32 it = 0; it < iterations; it++) {
+        Parser parser = { .program = &program, .tokens = tokens };
+        const AstArena ast = Parser_parse(&parser);
+
+        decls = ast.nodes[ast.root].data;
+        nodes = ast.nodeLength;
+        ast_release(&ast);
+    }
+
+    f64 seconds = bench_now() - begin;
+
+    printf("\nParser_parse %u bytes x %u: %.1f MB/s, %.2f Mdecl/s, %.1f Mnodes/s "
+        "(%u tokens, %u decls, %u nodes, errors=%zu)\n",
+        text.length, iterations,
+        bench_mbps((usize)text.length * iterations, seconds),
+        (f64)decls * iterations / seconds * 1e-6, (f64)nodes * iterations / seconds * 1e-6,
+        tokens.length, decls, nodes, (size_t)reporter.errors.length);
+
+    // Pull mode: no TokenStore, the parser drives the lexer
+    begin = bench_now();
+
+    for (u32 it = 0; it < iterations; it++) {
+        Lexer pull = { .program = &program, .position = 0 };
+        Parser parser = { .program = &program, .lexer = &pull };
+        const AstArena ast = Parser_parse(&parser);
+
+        bench_keep(ast.nodeLength);
+        ast_release(&ast);
+    }
+
+    seconds = bench_now() - begin;
+
+    printf("Lex + parse  %u bytes x %u (pull mode): %.1f MB/s, %.2f Mdecl/s\n",
+        text.length, iterations,
+        bench_mbps((usize)text.length * iterations, seconds),
+        (f64)decls * iterations / seconds * 1e-6);
+
+    tokstore_release(&tokens);
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    bench_freeText(&text);
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// PARALLEL PARSE
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Theme lines with a call every third line whose arguments start lines
+// with `name:` (inline declarations), and a broken line at `brokenAt`
+static BenchText _genSplitTraps(const u32 bytes, const u32 brokenAt) {
+    const BenchText theme = bench_genTheme(bytes, 0xBADC0DE);
+    BenchText t = { 0 };
+    u32 line = 0, from = 0;
+    bool broken = false;
+
+    for (u32 i = 0; i < theme.length; i++) {
+        if (theme.data[i] != '\n') continue;
+
+        _bench_put(&t, theme.data + from, i + 1 - from);
+        from = i + 1;
+
+        if (++line % 3 == 0) _bench_puts(&t, "wrap: mix(\ninner: 1,\nouter: 2 + 3,\n4)\n");
+
+        if (!broken && t.length >= brokenAt) {
+            _bench_puts(&t, "broken: 1 +)\n");
+            broken = true;
+        }
+    }
+
+    bench_freeText(&theme);
+    return t;
+}
+
+static AstArena _parseWith(Program* program, const TokenStore* tokens, const u32 threads) {
+    Parser parser = { .program = program, .tokens = *tokens };
+    return threads ? Parser_parseParallel(&parser, threads) : Parser_parse(&parser);
+}
+
+static void _checkParallel(const u32 bytes) {
+    const BenchText text = _genSplitTraps(bytes, bytes / 3 * 2);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    const TokenStore tokens = Lexer_lex(&lexer);
+
+    const AstArena expected = _parseWith(&program, &tokens, 0);
+    const usize errors = reporter.errors.length;
+
+    if (errors == 0) {
+        fprintf(stderr, "parallel check text parsed without the planted error\n");
+        exit(1);
+    }
+
+    const SourceError error = reporter.errors.errs[0];
+
+    static const u32 counts[] = { 2, 3, 4, 5, 7, 8, 13, 16, 31, 64 };
+    u32 mismatches = 0;
+
+    for (u32 i = 0; i < _bench_len(counts); i++) {
+        reporter.errors.length = 0;
+        const AstArena ast = _parseWith(&program, &tokens, counts[i]);
+
+        const bool sameErrors = reporter.errors.length == errors
+            && reporter.errors.errs[0].offset == error.offset
+            && reporter.errors.errs[0].length == error.length;
+
+        if (!_sameArena(&ast, &expected) || !sameErrors) {
+            fprintf(stderr, "%u threads: tree or errors differ from Parser_parse\n", counts[i]);
+            mismatches++;
+        }
+
+        ast_release(&ast);
+    }
+
+    printf("\nParallel: %u bytes, %u tokens, %u decls up to the error at %u, %u thread counts, %u mismatches\n",
+        text.length, tokens.length, expected.nodes[expected.root].data, error.offset,
+        _bench_len(counts), mismatches);
+
+    ast_release(&expected);
+    tokstore_release(&tokens);
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    bench_freeText(&text);
+
+    if (mismatches) exit(1);
+}
+
+static void _benchParallel(const u32 bytes, const u32 iterations) {
+    const BenchText text = bench_genTheme(bytes, 0xC0FFEE);
+
+    Source src = {
+        .data = text.data, .dataLength = text.length,
+        .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+    };
+
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = &src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    const TokenStore tokens = Lexer_lex(&lexer);
+
+    const u32 hardware = thread_hardwareCount();
+    const u32 most = hardware > 8 ? hardware : 8;
+    f64 serial = 0;
+    u32 decls = 0;
+
+    printf("%-10s %12s %12s %10s   (%u logical processors)\n", "threads", "ms", "MB/s", "speedup", hardware);
+
+    for (u32 threads = 0; threads <= most; threads = threads ? threads * 2 : 1) {
+        f64 best = 1e9;
+
+        for (u32 it = 0; it < iterations; it++) {
+            const f64 begin = bench_now();
+            const AstArena ast = _parseWith(&program, &tokens, threads);
+            const f64 seconds = bench_now() - begin;
+
+            if (seconds < best) best = seconds;
+            decls = ast.nodes[ast.root].data;
+            ast_release(&ast);
+        }
+
+        char label[16];
+        if (threads) snprintf(label, sizeof(label), "%u", threads);
+        else snprintf(label, sizeof(label), "serial");
+
+        if (threads == 0) serial = best;
+        printf("%-10s %12.2f %12.1f %9.2fx\n", label, best * 1e3, bench_mbps(text.length, best), serial / best);
+    }
+
+    printf("%u declarations, %u tokens\n", decls, tokens.length);
+
+    tokstore_release(&tokens);
+    reporter_clear(&reporter);
+    strPool_release(&pool);
+    bench_freeText(&text);
+}
+
+int main(const int argc, char* argv[]) {
+    const u32 bytes = argc > 1 ? (u32)strtoul(argv[1], NULL, 10) : 4u << 20;
+    const u32 iterations = argc > 2 ? (u32)strtoul(argv[2], NULL, 10) : 10;
+
+    _checkPrecedence(20000);
+    _checkReparse(32u << 10, 1000);
+    _benchReparse(bytes);
+    _benchParse(bytes, iterations);
+    _checkParallel(1u << 20);
+    _benchParallel(bytes, iterations);
+    return 0;
+}
+
+// Build (from implementations/C):
+// gcc -O3 -pthread -o bench-parser bench/bench-parser.c parser/parser.c parser/ast.c lexer/lexer.c
+//     program/string-pool.c program/source.c error/errors.c error/reporter.c utils/strings.c utils/memory.c
@@ -0,0 +1,772 @@
+/*
+ * @file bench-pool.c
+ *
+ * StringPool interning benchmark on the identifiers of a theme source,
+ * with their real repetition (the lexer interns every occurrence).
+ *
+ * 1. Hash cost: byte-wise FNV-1a (the old pool hash) against strPool_hash.
+ * 2. Intern / hit / miss throughput of the control-byte table against the
+ *    old layout (FNV-1a, linear probing over 8-byte {hash, id} entries).
+ *    Misses are the distinct names with their last byte changed.
+ * 3. Probe length histograms for hits and misses: slot groups visited by
+ *    the pool, single slots visited by the old layout.
+ * 4. Parallel interning: a generated corpus split into files, the first
+ *    one lexed into a shared base pool, the rest lexed on 1..N threads
+ *    into overlay pools and merged in file order. Every thread count must
+ *    give the ids of a single threaded compile, token for token.
+ * 5. Warm start: interning the distinct names into a fresh pool against
+ *    mapping a saved snapshot of it, then the same stream interned through
+ *    overlays over the snapshot and over the heap pool, which must agree.
+ * 6. Compile loop: many small themes lexed back to back into one pool
+ *    sized for a large theme, reset between them. Reset cost against the
+ *    table clear it replaced, with and without shrink on reset. Each
+ *    compile must get the ids a fresh pool gives it.
+ *
+ * Usage: bench-pool [corpus-bytes | file.tstm] [iterations] [max-threads]
+ */
+
+#include "bench.h"
+#include "../constants/const-lexer.h"
+#include "../lexer/lexer.h"
+#include "../error/reporter.h"
+#include "../utils/threads.h"
+
+typedef struct Name {
+    const char* data;
+    u32 length;
+} Name;
+
+typedef struct NameList {
+    Name* names;
+    u32 length;
+} NameList;
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// OLD LAYOUT
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Pre control-byte pool: FNV-1a, linear probing, full hash per slot.
+// Names are kept as views, not copied, which only flatters it.
+typedef struct LegacyEntry {
+    u32 hash;
+    u32 symbol;         // 0 means empty
+} LegacyEntry;
+
+typedef struct LegacyPool {
+    LegacyEntry* table;
+    Name* symbols;
+    u32 capacity;
+    u32 length;
+} LegacyPool;
+
+static inline
+u32 _legacyHash(const char* data, const u32 len) {
+    u32 hash = 2166136261u;
+    for (u32 i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+static LegacyPool _legacyNew(const u32 capacity, const u32 names) {
+    return (LegacyPool) {
+        .table = calloc(capacity, sizeof(LegacyEntry)),
+        .symbols = malloc((names + 1) * sizeof(Name)),
+        .capacity = capacity,
+    };
+}
+
+// Slot of `name` or the empty slot where it would go, `probes` counts slots
+static inline
+u32 _legacySlot(const LegacyPool* p, const Name name, const u32 hash, u32* probes) {
+    u32 index = hash & (p->capacity - 1);
+    *probes = 1;
+
+    while (p->table[index].symbol != 0) {
+        const LegacyEntry* e = &p->table[index];
+        if (e->hash == hash) {
+            const Name s = p->symbols[e->symbol - 1];
+            if (s.length == name.length && memcmp(s.data, name.data, name.length) == 0) return index;
+        }
+
+        index = (index + 1) & (p->capacity - 1);
+        (*probes)++;
+    }
+
+    return index;
+}
+
+static void _legacyGrow(LegacyPool* p) {
+    const u32 capacity = p->capacity * 2;
+    LegacyEntry* table = calloc(capacity, sizeof(LegacyEntry));
+
+    for (u32 i = 0; i < p->capacity; i++) {
+        if (p->table[i].symbol == 0) continue;
+
+        u32 index = p->table[i].hash & (capacity - 1);
+        while (table[index].symbol != 0) index = (index + 1) & (capacity - 1);
+        table[index] = p->table[i];
+    }
+
+    free(p->table);
+    p->table = table;
+    p->capacity = capacity;
+}
+
+static u32 _legacyIntern(LegacyPool* p, const Name name) {
+    const u32 hash = _legacyHash(name.data, name.length);
+    u32 probes;
+    u32 index = _legacySlot(p, name, hash, &probes);
+    if (p->table[index].symbol) return p->table[index].symbol;
+
+    if ((f32)p->length / (f32)p->capacity >= 0.75f) {
+        _legacyGrow(p);
+        index = _legacySlot(p, name, hash, &probes);
+    }
+
+    p->symbols[p->length] = name;
+    p->table[index] = (LegacyEntry) { .hash = hash, .symbol = ++p->length };
+    return p->length;
+}
+
+static inline
+u32 _legacyFind(const LegacyPool* p, const Name name, u32* probes) {
+    const u32 hash = _legacyHash(name.data, name.length);
+    return p->table[_legacySlot(p, name, hash, probes)].symbol;
+}
+
+static void _legacyRelease(const LegacyPool* p) {
+    free(p->table);
+    free(p->symbols);
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// INPUT
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Identifier occurrences of `src`, in source order
+static NameList _identifiers(Source* src) {
+    StringPool pool = strPool_new(1 << 16, 1 << 12);
+    ErrorReporter reporter = reporter_new(16, reporter_defaultPrinter, 0);
+    Program program = { .stringPool = &pool, .source = src, .reporter = &reporter };
+
+    Lexer lexer = { .program = &program, .position = 0 };
+    const TokenStore tl = Lexer_lex(&lexer);
+
+    NameList list = { .names = malloc(tl.length * sizeof(Name)) };
+    for (usize i = 0; i < tl.length; i++) {
+        const Token tok = tokstore_at(&tl, (TokenId)i);
+        if (tok.type == tt_identifier)
+            list.names[list.length++] = (Name) { src->data + tok.start, tok_len(tok) };
+    }
+
+    tokstore_release(&tl);
+    strPool_release(&pool);
+    reporter_clear(&reporter);
+    return list;
+}
+
+// One changed copy of every distinct name: same length, last byte '#',
+// which never appears in an identifier, so every lookup misses
+static NameList _misses(const NameList* names, char** storage) {
+    StringPool seen = strPool_new(1 << 16, 1 << 12);
+    NameList list = { .names = malloc(names->length * sizeof(Name)) };
+
+    usize bytes = 0;
+    for (u32 i = 0; i < names->length; i++) bytes += names->names[i].length;
+
+    char* out = *storage = malloc(bytes);
+    for (u32 i = 0; i < names->length; i++) {
+        const Name n = names->names[i];
+        const u32 before = seen.hashLength;
+        strPool_internId(&seen, n.data, n.length);
+        if (seen.hashLength == before) continue;
+
+        memcpy(out, n.data, n.length);
+        out[n.length - 1] = '#';
+        list.names[list.length++] = (Name) { out, n.length };
+        out += n.length;
+    }
+
+    strPool_release(&seen);
+    return list;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// BENCHMARKS
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static void _benchHash(const NameList* names, const u32 iterations) {
+    f64 begin = bench_now();
+    for (u32 it = 0; it < iterations; it++)
+        for (u32 i = 0; i < names->length; i++)
+            bench_keep(_legacyHash(names->names[i].data, names->names[i].length));
+    const f64 fnv = bench_now() - begin;
+
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++)
+        for (u32 i = 0; i < names->length; i++)
+            bench_keep(strPool_hash(names->names[i].data, names->names[i].length));
+    const f64 wy = bench_now() - begin;
+
+    const f64 ops = (f64)names->length * iterations;
+    printf("hash         fnv1a %6.2f ns   strPool_hash %6.2f ns   (%.2fx)\n",
+        fnv / ops * 1e9, wy / ops * 1e9, fnv / wy);
+}
+
+#define HISTOGRAM 5
+
+static const char* _histogramLabels[2][HISTOGRAM] = {
+    { "1", "2", "3", "4", "5+" },           // groups
+    { "1", "2", "3-4", "5-8", "9+" },       // slots
+};
+
+static void _countProbe(u32 histogram[HISTOGRAM], const u32 probes, const bool slots) {
+    u32 bucket;
+    if (!slots) bucket = probes >= 5 ? 4 : probes - 1;
+    else bucket = probes <= 2 ? probes - 1 : probes <= 4 ? 2 : probes <= 8 ? 3 : 4;
+
+    histogram[bucket]++;
+}
+
+static void _printHistogram(const char* name, const u32 histogram[HISTOGRAM], const bool slots,
+    const u64 probes, const u32 lookups) {
+    printf("  %-20s avg %5.2f |", name, (f64)probes / lookups);
+    for (u32 b = 0; b < HISTOGRAM; b++)
+        printf(" %s:%5.1f%%", _histogramLabels[slots][b], 100.0 * histogram[b] / lookups);
+    printf("\n");
+}
+
+static void _benchTables(const NameList* names, const NameList* misses, const u32 iterations) {
+    const f64 interned = (f64)names->length * iterations;
+    const f64 hitOps = (f64)names->length * iterations;
+    const f64 missOps = (f64)misses->length * iterations;
+
+    // Intern from a small table, both layouts grow on the way
+    f64 begin = bench_now();
+    for (u32 it = 0; it < iterations; it++) {
+        StringPool pool = strPool_new(1 << 12, 16);
+        for (u32 i = 0; i < names->length; i++)
+            bench_keep(strPool_internId(&pool, names->names[i].data, names->names[i].length));
+        strPool_release(&pool);
+    }
+    const f64 poolIntern = bench_now() - begin;
+
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++) {
+        LegacyPool legacy = _legacyNew(16, names->length);
+        for (u32 i = 0; i < names->length; i++)
+            bench_keep(_legacyIntern(&legacy, names->names[i]));
+        _legacyRelease(&legacy);
+    }
+    const f64 legacyIntern = bench_now() - begin;
+
+    // Filled tables for lookups
+    StringPool pool = strPool_new(1 << 12, 16);
+    LegacyPool legacy = _legacyNew(16, names->length);
+    for (u32 i = 0; i < names->length; i++) {
+        const SymbolId a = strPool_internId(&pool, names->names[i].data, names->names[i].length);
+        const u32 b = _legacyIntern(&legacy, names->names[i]);
+        if (a != b) {
+            fprintf(stderr, "symbol mismatch for name %u: %u vs %u\n", i, a, b);
+            exit(1);
+        }
+    }
+
+    u32 probes;
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++)
+        for (u32 i = 0; i < names->length; i++)
+            bench_keep(strPool_findId(&pool, names->names[i].data, names->names[i].length));
+    const f64 poolHit = bench_now() - begin;
+
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++)
+        for (u32 i = 0; i < names->length; i++)
+            bench_keep(_legacyFind(&legacy, names->names[i], &probes));
+    const f64 legacyHit = bench_now() - begin;
+
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++)
+        for (u32 i = 0; i < misses->length; i++)
+            bench_keep(strPool_findId(&pool, misses->names[i].data, misses->names[i].length));
+    const f64 poolMiss = bench_now() - begin;
+
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++)
+        for (u32 i = 0; i < misses->length; i++)
+            bench_keep(_legacyFind(&legacy, misses->names[i], &probes));
+    const f64 legacyMiss = bench_now() - begin;
+
+    printf("\n%u names, %u distinct: pool %u slots (load %.2f), old %u slots (load %.2f)\n",
+        names->length, pool.hashLength,
+        pool.hashCapacity, (f64)pool.hashLength / pool.hashCapacity,
+        legacy.capacity, (f64)legacy.length / legacy.capacity);
+
+    printf("%-12s %10s %10s %8s\n", "ns/op", "old", "pool", "speedup");
+    printf("%-12s %10.2f %10.2f %7.2fx\n", "intern",
+        legacyIntern / interned * 1e9, poolIntern / interned * 1e9, legacyIntern / poolIntern);
+    printf("%-12s %10.2f %10.2f %7.2fx\n", "find hit",
+        legacyHit / hitOps * 1e9, poolHit / hitOps * 1e9, legacyHit / poolHit);
+    printf("%-12s %10.2f %10.2f %7.2fx\n", "find miss",
+        legacyMiss / missOps * 1e9, poolMiss / missOps * 1e9, legacyMiss / poolMiss);
+
+    // Probe lengths, and a correctness pass over both lookups
+    u32 hist[4][HISTOGRAM] = { { 0 } };
+    u64 total[4] = { 0 };
+
+    for (u32 i = 0; i < names->length; i++) {
+        const Name n = names->names[i];
+        const u32 groups = strPool_probeGroups(&pool, n.data, n.length);
+        const bool hit = strPool_findId(&pool, n.data, n.length) == _legacyFind(&legacy, n, &probes);
+
+        if (!hit) {
+            fprintf(stderr, "find mismatch for name %u\n", i);
+            exit(1);
+        }
+
+        _countProbe(hist[0], groups, false);
+        _countProbe(hist[1], probes, true);
+        total[0] += groups;
+        total[1] += probes;
+    }
+
+    for (u32 i = 0; i < misses->length; i++) {
+        const Name n = misses->names[i];
+        const u32 groups = strPool_probeGroups(&pool, n.data, n.length);
+
+        if (strPool_findId(&pool, n.data, n.length) != SYMBOL_NONE
+            || _legacyFind(&legacy, n, &probes) != 0) {
+            fprintf(stderr, "miss found for name %u\n", i);
+            exit(1);
+        }
+
+        _countProbe(hist[2], groups, false);
+        _countProbe(hist[3], probes, true);
+        total[2] += groups;
+        total[3] += probes;
+    }
+
+    printf("\nprobe lengths\n");
+    _printHistogram("pool hit (groups)", hist[0], false, total[0], names->length);
+    _printHistogram("old hit (slots)", hist[1], true, total[1], names->length);
+    _printHistogram("pool miss (groups)", hist[2], false, total[2], misses->length);
+    _printHistogram("old miss (slots)", hist[3], true, total[3], misses->length);
+
+    strPool_release(&pool);
+    _legacyRelease(&legacy);
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// PARALLEL
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#define UNITS 32
+
+// One theme file of the parallel compile
+typedef struct Unit {
+    BenchText text;
+    Source src;
+    ErrorReporter reporter;
+    StringPool pool;            // Overlay over the shared base
+    TokenStore tokens;
+    SymbolId* remap;
+} Unit;
+
+typedef struct Worker {
+    Unit* units;
+    const StringPool* base;
+    u32 first;                  // Lexes units first, first + stride, ...
+    u32 stride;
+} Worker;
+
+static void _lexUnits(void* arg) {
+    const Worker* w = arg;
+
+    for (u32 i = w->first; i < UNITS; i += w->stride) {
+        Unit* u = &w->units[i];
+        u->pool = strPool_overlay(w->base, 1 << 14, 1 << 10);
+
+        Program program = { .stringPool = &u->pool, .source = &u->src, .reporter = &u->reporter };
+        Lexer lexer = { .program = &program, .position = 0 };
+        u->tokens = Lexer_lex(&lexer);
+    }
+}
+
+static TokenStore _lexInto(StringPool* pool, Unit* u) {
+    Program program = { .stringPool = pool, .source = &u->src, .reporter = &u->reporter };
+    Lexer lexer = { .program = &program, .position = 0 };
+    return Lexer_lex(&lexer);
+}
+
+// Lexes units 1.. on `threads` threads over a base holding unit 0, merges
+// in unit order and checks every identifier against the reference ids
+static f64 _runParallel(Unit* units, const u32 threads, const TokenStore* reference,
+    const u32 referenceSymbols) {
+    StringPool base = strPool_new(1 << 16, 1 << 12);
+    const TokenStore baseTokens = _lexInto(&base, &units[0]);
+
+    Thread* handles = malloc(threads * sizeof(Thread));
+    Worker* workers = malloc(threads * sizeof(Worker));
+
+    const f64 begin = bench_now();
+
+    for (u32 t = 0; t < threads; t++) {
+        workers[t] = (Worker) { .units = units, .base = &base, .first = 1 + t, .stride = threads };
+
+        if (threads == 1) _lexUnits(&workers[t]);
+        else if (!thread_start(&handles[t], _lexUnits, &workers[t])) {
+            fprintf(stderr, "cannot start thread %u\n", t);
+            exit(1);
+        }
+    }
+
+    if (threads > 1)
+        for (u32 t = 0; t < threads; t++) thread_join(&handles[t]);
+
+    // The base is written again only now, after every overlay finished
+    for (u32 i = 1; i < UNITS; i++) {
+        Unit* u = &units[i];
+        u->remap = malloc((u->pool.hashLength + 1) * sizeof(SymbolId));
+        if (!strPool_merge(&base, &u->pool, u->remap)) exit(1);
+    }
+
+    const f64 seconds = bench_now() - begin;
+    free(handles);
+    free(workers);
+
+    if (strPool_count(&base) != referenceSymbols) {
+        fprintf(stderr, "%u threads: %u symbols, expected %u\n", threads, strPool_count(&base), referenceSymbols);
+        exit(1);
+    }
+
+    for (u32 i = 1; i < UNITS; i++) {
+        const Unit* u = &units[i];
+
+        for (usize k = 0; k < u->tokens.length; k++) {
+            const SymbolId id = tokstore_symbol(&u->tokens, (TokenId)k);
+            if (id == SYMBOL_NONE) continue;
+
+            if (strPool_remap(&u->pool, u->remap, id) != tokstore_symbol(&reference[i], (TokenId)k)) {
+                fprintf(stderr, "%u threads: unit %u token %zu has a different symbol\n", threads, i, (size_t)k);
+                exit(1);
+            }
+        }
+
+        tokstore_release(&u->tokens);
+        strPool_release(&u->pool);
+        free(u->remap);
+    }
+
+    tokstore_release(&baseTokens);
+    strPool_release(&base);
+    return seconds;
+}
+
+static void _benchParallel(const u32 bytes, const u32 iterations, const u32 maxThreads) {
+    Unit* units = calloc(UNITS, sizeof(Unit));
+    TokenStore* reference = malloc(UNITS * sizeof(TokenStore));
+    usize total = 0;
+
+    for (u32 i = 0; i < UNITS; i++) {
+        Unit* u = &units[i];
+        u->text = bench_genTheme(bytes / UNITS, 0xC0FFEE + 2 * i);
+        u->src = (Source) {
+            .data = u->text.data, .dataLength = u->text.length,
+            .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+        };
+        u->reporter = reporter_new(16, reporter_defaultPrinter, 0);
+        if (i) total += u->text.length;
+    }
+
+    // Reference: every unit into one pool on one thread, in unit order
+    StringPool single = strPool_new(1 << 16, 1 << 12);
+    for (u32 i = 0; i < UNITS; i++) reference[i] = _lexInto(&single, &units[i]);
+    const u32 symbols = strPool_count(&single);
+
+    // Same work on one thread without overlays, the cost to beat
+    f64 sequential = 0;
+    for (u32 it = 0; it < iterations; it++) {
+        StringPool pool = strPool_new(1 << 16, 1 << 12);
+        const TokenStore head = _lexInto(&pool, &units[0]);
+
+        const f64 begin = bench_now();
+        for (u32 i = 1; i < UNITS; i++) {
+            const TokenStore tl = _lexInto(&pool, &units[i]);
+            tokstore_release(&tl);
+        }
+        sequential += bench_now() - begin;
+
+        tokstore_release(&head);
+        strPool_release(&pool);
+    }
+    sequential /= iterations;
+
+    printf("\nparallel: %u files, %zu bytes after the base file, %u symbols, %u hardware threads\n",
+        UNITS - 1, (size_t)total, symbols, thread_hardwareCount());
+    printf("%-12s %10s %10s %8s\n", "threads", "ms", "MB/s", "speedup");
+    printf("%-12s %10.2f %10.1f %8s\n", "sequential", sequential * 1e3, bench_mbps(total, sequential), "-");
+
+    f64 one = 0;
+    for (u32 threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2) {
+        f64 seconds = 0;
+        for (u32 it = 0; it < iterations; it++) seconds += _runParallel(units, threads, reference, symbols);
+        seconds /= iterations;
+
+        if (threads == 1) one = seconds;
+        printf("%-12u %10.2f %10.1f %7.2fx\n", threads, seconds * 1e3, bench_mbps(total, seconds), one / seconds);
+    }
+
+    printf("ids identical to the single threaded compile for every thread count\n");
+
+    for (u32 i = 0; i < UNITS; i++) {
+        tokstore_release(&reference[i]);
+        reporter_clear(&units[i].reporter);
+        bench_freeText(&units[i].text);
+    }
+
+    strPool_release(&single);
+    free(reference);
+    free(units);
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// SNAPSHOT
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#define SNAPSHOT_PATH "bench-pool.snapshot"
+
+static void _benchSnapshot(const NameList* names, const NameList* misses, const u32 iterations) {
+    // Cold start: every name interned again
+    f64 begin = bench_now();
+    for (u32 it = 0; it < iterations; it++) {
+        StringPool pool = strPool_new(0, 16);
+        for (u32 i = 0; i < names->length; i++)
+            bench_keep(strPool_internId(&pool, names->names[i].data, names->names[i].length));
+        strPool_release(&pool);
+    }
+    const f64 cold = (bench_now() - begin) / iterations;
+
+    StringPool heap = strPool_new(0, 16);
+    for (u32 i = 0; i < names->length; i++)
+        strPool_internId(&heap, names->names[i].data, names->names[i].length);
+
+    if (!strPool_save(&heap, SNAPSHOT_PATH)) exit(1);
+
+    // Warm start: map the file and look one name up
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++) {
+        const StringPool loaded = strPool_load(SNAPSHOT_PATH);
+        if (loaded.ctrl == NULL) exit(1);
+
+        bench_keep(strPool_findId(&loaded, names->names[0].data, names->names[0].length));
+        strPool_release(&loaded);
+    }
+    const f64 warm = (bench_now() - begin) / iterations;
+
+    const StringPool snapshot = strPool_load(SNAPSHOT_PATH);
+    if (snapshot.ctrl == NULL) exit(1);
+
+    // Hits straight from the mapping against the heap table
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++)
+        for (u32 i = 0; i < names->length; i++)
+            bench_keep(strPool_findId(&heap, names->names[i].data, names->names[i].length));
+    const f64 heapHit = bench_now() - begin;
+
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++)
+        for (u32 i = 0; i < names->length; i++)
+            bench_keep(strPool_findId(&snapshot, names->names[i].data, names->names[i].length));
+    const f64 mappedHit = bench_now() - begin;
+
+    // New strings go to overlays, both bases must hand out the same ids
+    StringPool overHeap = strPool_overlay(&heap, 0, 16);
+    StringPool overSnapshot = strPool_overlay(&snapshot, 0, 16);
+
+    for (u32 pass = 0; pass < 2; pass++) {
+        const NameList* list = pass ? misses : names;
+
+        for (u32 i = 0; i < list->length; i++) {
+            const Name n = list->names[i];
+            const SymbolId a = strPool_internId(&overHeap, n.data, n.length);
+            const SymbolId b = strPool_internId(&overSnapshot, n.data, n.length);
+            const str_t sa = strPool_get(&overHeap, a), sb = strPool_get(&overSnapshot, b);
+
+            if (a == SYMBOL_NONE || a != b || sa.length != n.length || sb.length != n.length
+                || memcmp(sb.data, n.data, n.length) != 0) {
+                fprintf(stderr, "snapshot mismatch for name %u of pass %u\n", i, pass);
+                exit(1);
+            }
+        }
+    }
+
+    const f64 ops = (f64)names->length * iterations;
+    printf("\nsnapshot: %u symbols, %u slots\n", snapshot.hashLength, snapshot.hashCapacity);
+    printf("  cold intern %10.3f ms   load %10.3f ms   (%.0fx)\n", cold * 1e3, warm * 1e3, cold / warm);
+    printf("  find hit    heap %6.2f ns   mapped %6.2f ns\n", heapHit / ops * 1e9, mappedHit / ops * 1e9);
+    printf("  overlay ids over the snapshot match the heap pool (%u new)\n", overSnapshot.hashLength);
+
+    strPool_release(&overHeap);
+    strPool_release(&overSnapshot);
+    strPool_release(&snapshot);
+    strPool_release(&heap);
+    remove(SNAPSHOT_PATH);
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// RESET
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#define SMALL_THEMES 64
+#define SMALL_BYTES 2048
+
+// Lexes every small theme into `pool` with a reset after each, returns the
+// seconds spent in strPool_reset. `check` compares ids with `fresh`.
+static f64 _compileLoop(StringPool* pool, Unit* themes, const TokenStore* fresh, const bool check) {
+    f64 resetting = 0;
+
+    for (u32 i = 0; i < SMALL_THEMES; i++) {
+        const TokenStore tl = _lexInto(pool, &themes[i]);
+
+        for (usize k = 0; check && k < tl.length; k++) {
+            if (tokstore_symbol(&tl, (TokenId)k) != tokstore_symbol(&fresh[i], (TokenId)k)) {
+                fprintf(stderr, "theme %u token %zu: symbol differs from a fresh pool\n", i, (size_t)k);
+                exit(1);
+            }
+        }
+
+        tokstore_release(&tl);
+
+        const f64 begin = bench_now();
+        strPool_reset(pool);
+        resetting += bench_now() - begin;
+    }
+
+    return resetting;
+}
+
+static void _benchReset(const u32 iterations) {
+    Unit* themes = calloc(SMALL_THEMES, sizeof(Unit));
+    TokenStore* fresh = malloc(SMALL_THEMES * sizeof(TokenStore));
+
+    for (u32 i = 0; i < SMALL_THEMES; i++) {
+        Unit* u = &themes[i];
+        u->text = bench_genTheme(SMALL_BYTES, 0xBEEF + 2 * i);
+        u->src = (Source) {
+            .data = u->text.data, .dataLength = u->text.length,
+            .name = "small.tstm", .nameLength = slenof("small.tstm"),
+        };
+        u->reporter = reporter_new(16, reporter_defaultPrinter, 0);
+
+        StringPool pool = strPool_new(0, 16);
+        fresh[i] = _lexInto(&pool, u);
+        strPool_release(&pool);
+    }
+
+    // Sized for a theme of a few MB, like a service that also compiles those
+    const u32 slots = 1 << 17;
+    const u32 compiles = SMALL_THEMES * iterations;
+
+    StringPool pool = strPool_new(0, slots);
+    f64 reset = 0;
+    f64 begin = bench_now();
+    for (u32 it = 0; it < iterations; it++) reset += _compileLoop(&pool, themes, fresh, it == 0);
+    const f64 loop = bench_now() - begin;
+    strPool_release(&pool);
+
+    // What every reset did before: clear all control bytes
+    u8* ctrl = malloc(slots);
+    begin = bench_now();
+    for (u32 c = 0; c < compiles; c++) {
+        memset(ctrl, STRPOOL_EMPTY, slots);
+        bench_keep(ctrl[c % slots]);
+    }
+    const f64 clear = bench_now() - begin;
+    free(ctrl);
+
+    // Grown big by one large compile, then only small ones
+    pool = strPool_new(0, 16);
+    pool.shrinkAfter = 8;
+    for (u32 i = 0; i < slots / 2; i++) {
+        char name[16];
+        const int n = snprintf(name, sizeof(name), "name%u", i);
+        strPool_internId(&pool, name, (u32)n);
+    }
+
+    const u32 grown = pool.hashCapacity;
+    strPool_reset(&pool);
+
+    f64 shrinkReset = 0;
+    begin = bench_now();
+    for (u32 it = 0; it < iterations; it++) shrinkReset += _compileLoop(&pool, themes, fresh, true);
+    const f64 shrinkLoop = bench_now() - begin;
+    const u32 shrunk = pool.hashCapacity;
+    strPool_release(&pool);
+
+    printf("\ncompile loop: %u themes of %u bytes, %u slot table\n", SMALL_THEMES, SMALL_BYTES, slots);
+    printf("  reset %8.1f ns   table clear %8.1f ns   (%.0fx)\n",
+        reset / compiles * 1e9, clear / compiles * 1e9, clear / reset);
+    printf("  %-14s %8.2f us/compile\n", "epoch reset", loop / compiles * 1e6);
+    printf("  %-14s %8.2f us/compile, reset %.1f ns, table %u -> %u slots\n", "shrink after 8",
+        shrinkLoop / compiles * 1e6, shrinkReset / compiles * 1e9, grown, shrunk);
+    printf("  ids identical to a fresh pool for every compile\n");
+
+    for (u32 i = 0; i < SMALL_THEMES; i++) {
+        tokstore_release(&fresh[i]);
+        reporter_clear(&themes[i].reporter);
+        bench_freeText(&themes[i].text);
+    }
+
+    free(fresh);
+    free(themes);
+}
+
+int main(const int argc, char* argv[]) {
+    const bool fromFile = argc > 1 && (argv[1][0] < '0' || argv[1][0] > '9');
+    const u32 bytes = argc > 1 && !fromFile ? (u32)strtoul(argv[1], NULL, 10) : 4u << 20;
+    const u32 iterations = argc > 2 ? (u32)strtoul(argv[2], NULL, 10) : 10;
+    const u32 hardware = thread_hardwareCount();
+    const u32 maxThreads = argc > 3 ? (u32)strtoul(argv[3], NULL, 10) : hardware > 4 ? hardware : 4;
+
+    BenchText text = { 0 };
+    Source src;
+
+    if (fromFile) {
+        src = source_mapFile(argv[1]);
+        if (src.data == NULL) return 1;
+    } else {
+        text = bench_genTheme(bytes, 0xC0FFEE);
+        src = (Source) {
+            .data = text.data, .dataLength = text.length,
+            .name = "bench.tstm", .nameLength = slenof("bench.tstm"),
+        };
+    }
+
+    const NameList names = _identifiers(&src);
+    if (names.length == 0) {
+        fprintf(stderr, "no identifiers in input\n");
+        return 1;
+    }
+
+    char* missStorage;
+    const NameList misses = _misses(&names, &missStorage);
+
+    _benchHash(&names, iterations);
+    _benchTables(&names, &misses, iterations);
+    _benchParallel(bytes, iterations, maxThreads ? maxThreads : 1);
+    _benchSnapshot(&names, &misses, iterations);
+    _benchReset(iterations);
+
+    free(missStorage);
+    free(misses.names);
+    free(names.names);
+    source_release(&src);
+    bench_freeText(&text);
+    return 0;
+}
+
+// Build (from implementations/C):
+// gcc -O3 -pthread -o bench-pool bench/bench-pool.c lexer/lexer.c program/string-pool.c
+//     program/source.c error/errors.c error/reporter.c utils/strings.c utils/memory.c
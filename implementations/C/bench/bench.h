@@ -0,0 +1,251 @@
+/*
+ * @file bench.h
+ *
+ * Tiny helpers shared by the bench-*.c programs:
+ * a monotonic timer, a deterministic RNG and a synthetic theme generator
+ * that mimics our generated theme files (comment banners, long identifiers,
+ * hex colors, numeric literals, calls, operators and conditionals).
+ */
+
+#pragma once
+
+#include "../utils/short-types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OS_isWINDOWS
+#   include <windows.h>
+#else
+#   include <time.h>
+#endif
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// TIMER
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Monotonic time in seconds
+static inline
+f64 bench_now(void) {
+#if OS_isWINDOWS
+    static LARGE_INTEGER freq;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (f64)counter.QuadPart / (f64)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Throughput in MB/s
+static inline
+f64 bench_mbps(const usize bytes, const f64 seconds) {
+    return seconds > 0 ? (f64)bytes / (1024.0 * 1024.0) / seconds : 0;
+}
+
+// Keep the optimizer from dropping a computed value
+static volatile u64 bench_sink;
+#define bench_keep(x) (bench_sink += (u64)(x))
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// RNG (xorshift64*)
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static inline
+u64 bench_rand(u64* state) {
+    u64 x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static inline
+u32 bench_randRange(u64* state, const u32 n) {
+    return (u32)(bench_rand(state) % n);
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// THEME CORPUS
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+typedef struct BenchText {
+    char* data;
+    u32 length;
+    u32 capacity;
+} BenchText;
+
+static inline
+void _bench_put(BenchText* t, const char* s, const u32 len) {
+    if (t->length + len + 1 > t->capacity) {
+        t->capacity = (t->length + len + 1) * 2;
+        t->data = realloc(t->data, t->capacity);
+    }
+
+    memcpy(t->data + t->length, s, len);
+    t->length += len;
+    t->data[t->length] = '\0';
+}
+
+static inline
+void _bench_puts(BenchText* t, const char* s) {
+    _bench_put(t, s, (u32)strlen(s));
+}
+
+#define _bench_len(x) ((u32)(sizeof(x) / sizeof((x)[0])))
+
+static const char* _bench_words[] = {
+    "primary", "secondary", "surface", "background", "foreground", "accent",
+    "border", "shadow", "radius", "spacing", "padding", "margin", "opacity",
+    "button", "header", "sidebar", "toolbar", "dialog", "tooltip", "card",
+    "hover", "pressed", "disabled", "focused", "selected", "container",
+};
+
+static const char* _bench_calls[] = {
+    "rgba", "rgb", "lighten", "darken", "mix", "alpha", "min", "max", "clamp",
+};
+
+static const char* _bench_unary[] = { "-", "!", "~" };
+
+static const char* _bench_ops[] = {
+    "+", "-", "*", "/", "%", "/%", "**", "&", "|", "^", "<<", ">>",
+    "==", "!=", "<=", ">=", "&&", "||", "??", "!!",
+};
+
+// Append a generated theme identifier like `button_hover_border_radius2`
+static inline
+void _bench_identifier(BenchText* t, u64* rng) {
+    const u32 parts = 2 + bench_randRange(rng, 4);
+    for (u32 p = 0; p < parts; p++) {
+        if (p) _bench_puts(t, "_");
+        _bench_puts(t, _bench_words[bench_randRange(rng, _bench_len(_bench_words))]);
+    }
+
+    if (bench_randRange(rng, 3) == 0) {
+        char num[8];
+        const int n = snprintf(num, sizeof(num), "%u", bench_randRange(rng, 100));
+        _bench_put(t, num, (u32)n);
+    }
+}
+
+static inline
+void _bench_operand(BenchText* t, u64* rng, const u32 depth) {
+    char buf[64];
+    int n = 0;
+
+    switch (bench_randRange(rng, depth ? 9 : 6)) {
+        case 0:
+            n = snprintf(buf, sizeof(buf), "%u", bench_randRange(rng, 100000));
+            break;
+
+        case 1:
+            n = snprintf(buf, sizeof(buf), "%u.%u",
+                bench_randRange(rng, 1000), bench_randRange(rng, 1000));
+            break;
+
+        case 2:
+            n = snprintf(buf, sizeof(buf), "#%06x", bench_randRange(rng, 0xFFFFFF));
+            break;
+
+        case 3:
+            n = snprintf(buf, sizeof(buf), "0x%08X", (u32)bench_rand(rng));
+            break;
+
+        case 4:
+            _bench_puts(t, "$");
+            _bench_identifier(t, rng);
+            return;
+
+        case 5:
+            n = snprintf(buf, sizeof(buf), "%ue-%u",
+                1 + bench_randRange(rng, 9), bench_randRange(rng, 10));
+            break;
+
+        case 6:
+            // A plain operand, "!" twice would lex as "!!"
+            _bench_puts(t, _bench_unary[bench_randRange(rng, _bench_len(_bench_unary))]);
+            _bench_operand(t, rng, 0);
+            return;
+
+        case 7:
+            _bench_puts(t, "(");
+            _bench_operand(t, rng, depth - 1);
+            _bench_puts(t, " > ");
+            _bench_operand(t, rng, depth - 1);
+            _bench_puts(t, " ? ");
+            _bench_operand(t, rng, depth - 1);
+            _bench_puts(t, " : ");
+            _bench_operand(t, rng, depth - 1);
+            _bench_puts(t, ")");
+            return;
+
+        default: {
+            _bench_puts(t, _bench_calls[bench_randRange(rng, _bench_len(_bench_calls))]);
+            _bench_puts(t, "(");
+            const u32 args = 1 + bench_randRange(rng, 4);
+            for (u32 a = 0; a < args; a++) {
+                if (a) _bench_puts(t, ", ");
+                _bench_operand(t, rng, depth - 1);
+            }
+            _bench_puts(t, ")");
+            return;
+        }
+    }
+
+    _bench_put(t, buf, (u32)n);
+}
+
+/**
+ * Generates roughly `bytes` bytes of theme source.
+ * Output is deterministic for a given seed and always NUL terminated.
+ */
+static inline
+BenchText bench_genTheme(const u32 bytes, const u64 seed) {
+    BenchText t = { 0 };
+    u64 rng = seed | 1;
+
+    while (t.length < bytes) {
+        const u32 roll = bench_randRange(&rng, 100);
+
+        if (roll < 3) {
+            _bench_puts(&t,
+                "/* ==========================================================\n"
+                " *  Generated section - do not edit by hand\n"
+                " * ========================================================== */\n");
+            continue;
+        }
+
+        if (roll < 10) {
+            _bench_puts(&t, "// ----------------------------------------------------------\n");
+            continue;
+        }
+
+        _bench_identifier(&t, &rng);
+        _bench_puts(&t, ": ");
+
+        const u32 terms = 1 + bench_randRange(&rng, 4);
+        for (u32 i = 0; i < terms; i++) {
+            if (i) {
+                _bench_puts(&t, " ");
+                _bench_puts(&t, _bench_ops[bench_randRange(&rng, _bench_len(_bench_ops))]);
+                _bench_puts(&t, " ");
+            }
+            _bench_operand(&t, &rng, 2);
+        }
+
+        _bench_puts(&t, "\n");
+    }
+
+    return t;
+}
+
+static inline
+void bench_freeText(const BenchText* t) {
+    free(t->data);
+}
@@ -15,6 +15,7 @@ gcc ^
     -o tstm.exe ^
     tstm.c ^
     program\string-pool.c ^
+    program\source.c ^
     error\errors.c ^
     error\reporter.c ^
     lexer\lexer.c ^
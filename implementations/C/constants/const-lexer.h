@@ -19,122 +19,68 @@
 
 #define CL_NumberSeparator '_'
 
-#define CL_RotateLeft "<<<"
-#define CL_RotateRight ">>>"
-#define CL_ShiftLeft "<<"
-#define CL_ShiftRight ">>"
-#define CL_IntDiv "/%"
-#define CL_Power "**"
-#define CL_StrictEqual "==="
-#define CL_StrictNotEqual "!=="
-#define CL_ApproxEqual "~=="
-#define CL_NotApproxEqual "!~="
-#define CL_EqualEqual "=="
-#define CL_NotEqual "!="
-#define CL_LessEqual "<="
-#define CL_GreaterEqual ">="
-#define CL_LogicalAnd "&&"
-#define CL_LogicalOr "||"
-#define CL_LogicalXor "^^"
-#define CL_Coalesce "??"
-#define CL_Guard "!!"
-#define CL_Dollar '$'
-#define CL_BitAnd '&'
-#define CL_BitOr '|'
-#define CL_BitXor '^'
-#define CL_BitNot '~'
-#define CL_Plus '+'
-#define CL_Minus '-'
-#define CL_Star '*'
-#define CL_Slash '/'
-#define CL_Percent '%'
-#define CL_LParen '('
-#define CL_RParen ')'
-#define CL_Comma ','
-#define CL_Less '<'
-#define CL_Greater '>'
-#define CL_Not '!'
-#define CL_Question '?'
-#define CL_Colon ':'
-#define CL_Semicolon ';'
 #define CL_Hash '#'
 
-static const
-char CL_Operators1[] = {
-    CL_Dollar,
-    CL_BitAnd,
-    CL_BitOr,
-    CL_BitXor,
-    CL_BitNot,
-    CL_Plus,
-    CL_Minus,
-    CL_Star,
-    CL_Slash,
-    CL_Percent,
-    CL_LParen,
-    CL_RParen,
-    CL_Comma,
-    CL_Less,
-    CL_Greater,
-    CL_Not,
-    CL_Question,
-    CL_Colon,
-    CL_Semicolon,
-    CL_Hash,
-};
-
-static const
-char* CL_Operators2[] = {
-  CL_ShiftLeft,
-  CL_ShiftRight,
-  CL_IntDiv,
-  CL_Power,
-  CL_EqualEqual,
-  CL_NotEqual,
-  CL_LessEqual,
-  CL_GreaterEqual,
-  CL_LogicalAnd,
-  CL_LogicalOr,
-  CL_LogicalXor,
-  CL_Coalesce,
-  CL_Guard,
-};
-
-static const
-char* CL_Operators3[] = {
-  CL_RotateLeft,
-  CL_RotateRight,
-  CL_StrictEqual,
-  CL_StrictNotEqual,
-  CL_ApproxEqual,
-  CL_NotApproxEqual,
-};
+/**
+ * Every operator: token type, then its bytes ('\0' padded to three).
+ * CL_isOperator and the lexer's dispatch tables (lexer/lex-ops.h) are
+ * derived from this one list. `arg` is handed through to every `X`.
+ */
+#define CL_OPERATORS(X, arg) \
+    X(arg, tt_dollar,         '$', 0,   0  ) \
+    X(arg, tt_bitAnd,         '&', 0,   0  ) \
+    X(arg, tt_logicalAnd,     '&', '&', 0  ) \
+    X(arg, tt_bitOr,          '|', 0,   0  ) \
+    X(arg, tt_logicalOr,      '|', '|', 0  ) \
+    X(arg, tt_bitXor,         '^', 0,   0  ) \
+    X(arg, tt_logicalXor,     '^', '^', 0  ) \
+    X(arg, tt_bitNot,         '~', 0,   0  ) \
+    X(arg, tt_approxEqual,    '~', '=', '=') \
+    X(arg, tt_plus,           '+', 0,   0  ) \
+    X(arg, tt_minus,          '-', 0,   0  ) \
+    X(arg, tt_star,           '*', 0,   0  ) \
+    X(arg, tt_power,          '*', '*', 0  ) \
+    X(arg, tt_slash,          '/', 0,   0  ) \
+    X(arg, tt_intDiv,         '/', '%', 0  ) \
+    X(arg, tt_percent,        '%', 0,   0  ) \
+    X(arg, tt_lParen,         '(', 0,   0  ) \
+    X(arg, tt_rParen,         ')', 0,   0  ) \
+    X(arg, tt_comma,          ',', 0,   0  ) \
+    X(arg, tt_less,           '<', 0,   0  ) \
+    X(arg, tt_shiftLeft,      '<', '<', 0  ) \
+    X(arg, tt_rotLeft,        '<', '<', '<') \
+    X(arg, tt_lessEqual,      '<', '=', 0  ) \
+    X(arg, tt_greater,        '>', 0,   0  ) \
+    X(arg, tt_shiftRight,     '>', '>', 0  ) \
+    X(arg, tt_rotRight,       '>', '>', '>') \
+    X(arg, tt_greaterEqual,   '>', '=', 0  ) \
+    X(arg, tt_not,            '!', 0,   0  ) \
+    X(arg, tt_notEqual,       '!', '=', 0  ) \
+    X(arg, tt_strictNotEqual, '!', '=', '=') \
+    X(arg, tt_notApproxEqual, '!', '~', '=') \
+    X(arg, tt_guard,          '!', '!', 0  ) \
+    X(arg, tt_question,       '?', 0,   0  ) \
+    X(arg, tt_coalesce,       '?', '?', 0  ) \
+    X(arg, tt_colon,          ':', 0,   0  ) \
+    X(arg, tt_semicolon,      ';', 0,   0  ) \
+    X(arg, tt_equalEqual,     '=', '=', 0  ) \
+    X(arg, tt_strictEqual,    '=', '=', '=')
 
 static inline
 bool CL_isWhitespace(const char c) {
     return c == ' ' || c == '\t' || c == '\v' || c == '\r' || c == '\f' || c == '\n';
 }
 
+#define _CL_STARTS_WITH(c, type, a, b, d) || (c) == (a)
+
+// Starts an operator, or a color literal
 static inline
 bool CL_isOperator(const char c) {
-    for (u16 i = 0; i < lenof(CL_Operators1); i++) {
-        if (CL_Operators1[i] == c)
-            return true;
-    }
-
-    for (u16 i = 0; i < lenof(CL_Operators2); i++) {
-        if (CL_Operators2[i][0] == c)
-            return true;
-    }
-
-    for (u16 i = 0; i < lenof(CL_Operators3); i++) {
-        if (CL_Operators3[i][0] == c)
-            return true;
-    }
-
-    return false;
+    return c == CL_Hash CL_OPERATORS(_CL_STARTS_WITH, c);
 }
 
+#undef _CL_STARTS_WITH
+
 static inline
 bool CL_isAlpha(const char c) {
     return 'a' <= (c | 32) && (c | 32) <= 'z';
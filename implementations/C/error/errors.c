@@ -1,5 +1,6 @@
 #include "errors.h"
 #include "../constants/const-errors.h"
+#include "../program/line-table.h"
 #include "../utils/memory.h"
 #include "../utils/position.h"
 #include "../utils/strings.h"
@@ -7,6 +8,12 @@
 #include <stdio.h>
 
 string_t serr_format(const SourceError* se, const Source src, const bool colored) {
+    const Allocator heap = mem_heap;
+    return serr_formatWith(se, src, colored, &heap);
+}
+
+string_t serr_formatWith(const SourceError* se, const Source src, const bool colored,
+    const Allocator* allocator) {
     char buffer[2048];
 
     const str_t fname = src.name == NULL
@@ -17,8 +24,13 @@ string_t serr_format(const SourceError* se, const Source src, const bool colored
 
     // Get required position info
     u32 line, col, lineStart, lineLen;
-    pos_getOffsetInfo(src.data, src.dataLength, se->offset,
-        &line, &col, &lineStart, &lineLen);
+    if (src.lines != NULL && src.lines->starts != NULL) {
+        lines_getOffsetInfo(src.lines, src.data, src.dataLength, se->offset,
+            &line, &col, &lineStart, &lineLen);
+    } else {
+        pos_getOffsetInfo(src.data, src.dataLength, se->offset,
+            &line, &col, &lineStart, &lineLen);
+    }
 
     const u32 spaceCount = col - 1;
     const u32 caretCount = se->length;
@@ -86,8 +98,15 @@ string_t serr_format(const SourceError* se, const Source src, const bool colored
 
         // TODO: add log file property at program if it not null,
         //  log into that file.
+
+        // Keep only what the buffer holds
+        len = sizeof(buffer);
     }
 
-    char* clone = memClone(buffer, len);
+    char* clone = memAlloc(allocator, len + 1);
+    if (!clone) return string_null;
+
+    memCopy(clone, buffer, len);
+    clone[len] = '\0';
     return (string_t) { .data = clone, .length = len };
 }
@@ -44,5 +44,15 @@ string_t serr_toString(const SourceError* se) {
         SourceErrorKind_names[se->kind], se->message.data, se->offset);
 }
 
+// serr_toString into `length + 1` bytes from `allocator`
+static inline
+string_t serr_toStringWith(const SourceError* se, const Allocator* allocator) {
+    return string_buildWith(allocator, "%s(%s) at offset %u",
+        SourceErrorKind_names[se->kind], se->message.data, se->offset);
+}
+
 string_t serr_format(const SourceError* se, Source src, bool colored);
 
+// serr_format into `length + 1` bytes from `allocator`
+string_t serr_formatWith(const SourceError* se, Source src, bool colored, const Allocator* allocator);
+
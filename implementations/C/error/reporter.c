@@ -12,15 +12,13 @@ bool _reporter_tryGrow(ErrorReporter* re) {
 
     const usize newCapacity = (usize)((float)re->errors.capacity * 1.75f);
 
-    SourceError* errors = malloc(newCapacity * sizeof(SourceError));
+    SourceError* errors = memResize(&re->allocator, re->errors.errs,
+        re->errors.capacity * sizeof(SourceError), newCapacity * sizeof(SourceError));
     if (!errors) {
         fprintf(stderr, "Reporter push Error: Memory allocation failed during growing.\n");
         return true;  // Return true on failure
     }
 
-    memCopy(errors, re->errors.errs, re->errors.length * sizeof(SourceError));
-    free(re->errors.errs);
-
     re->errors.errs = errors;
     re->errors.capacity = newCapacity;
     re->errors.length = re->errors.length;
@@ -28,11 +26,17 @@ bool _reporter_tryGrow(ErrorReporter* re) {
 }
 
 ErrorReporter reporter_new(const usize capacity, const ErrorPrinter printer, const u8 flags)  {
+    return reporter_newWith(capacity, printer, flags, mem_heap);
+}
+
+ErrorReporter reporter_newWith(const usize capacity, const ErrorPrinter printer, const u8 flags,
+    const Allocator allocator) {
     ErrorReporter rep;
     rep.printer = printer;
     rep.flags = flags | REPORT_ENABLE;
+    rep.allocator = allocator;
 
-    rep.errors.errs = malloc(capacity * sizeof(ErrorReporter));
+    rep.errors.errs = memAlloc(&rep.allocator, capacity * sizeof(SourceError));
     if (!rep.errors.errs) return REPORTER_NULL;
 
     rep.errors.length = 0;
@@ -44,7 +48,7 @@ ErrorReporter reporter_new(const usize capacity, const ErrorPrinter printer, con
 void reporter_clear(ErrorReporter* reporter) {
     if (!reporter) return;
 
-    free(reporter->errors.errs);
+    memFree(&reporter->allocator, reporter->errors.errs, reporter->errors.capacity * sizeof(SourceError));
     reporter->errors.errs = NULL;
     reporter->errors.length = 0;
     reporter->errors.capacity = 0;
@@ -58,29 +62,35 @@ bool reporter_push(ErrorReporter* re, const SourceError error, const Source src)
 
     re->errors.errs[re->errors.length++] = error;
     if (re->flags & REPORT_PRINT_IMMEDIATELY) {
-        const string_t str = serr_format(&error, src, (re->flags & REPORT_COLORED) != 0);
+        const string_t str = serr_formatWith(&error, src, (re->flags & REPORT_COLORED) != 0, &re->allocator);
         re->printer(str);
+        memFree(&re->allocator, str.data, str.length + 1);
     }
 
     return (re->flags & REPORT_BREAK_ON_PUSH) != 0;
 }
 string_t reporter_formatAll(const ErrorReporter* re, const Source src) {
+    return re ? reporter_formatAllWith(re, src, re->allocator) : string_null;
+}
+
+string_t reporter_formatAllWith(const ErrorReporter* re, const Source src, const Allocator allocator) {
     if (!re) return string_null;
 
     usize resLength = 0;
-    string_t* errors = malloc(re->errors.length * sizeof(str_t));
+    const Allocator* a = &allocator;
+    string_t* errors = memAlloc(a, re->errors.length * sizeof(string_t));
 
     if (!errors) return string_null;
 
     // Format all errors
     if (src.data == str_null.data) {
         for (u32 i = 0; i < re->errors.length; i++) {
-            errors[i] = serr_toString(&re->errors.errs[i]);
+            errors[i] = serr_toStringWith(&re->errors.errs[i], a);
             resLength += errors[i].length;
         }
     } else {
         for (u32 i = 0; i < re->errors.length; i++) {
-            errors[i] = serr_format(&re->errors.errs[i], src, re->flags & REPORT_COLORED);
+            errors[i] = serr_formatWith(&re->errors.errs[i], src, re->flags & REPORT_COLORED, a);
             resLength += errors[i].length;
         }
     }
@@ -91,11 +101,11 @@ string_t reporter_formatAll(const ErrorReporter* re, const Source src) {
     }
 
     // Join errors into res the separator is "\n\n"
-    char* res = malloc(resLength + 1); // +1 for null terminator
+    char* res = memAlloc(a, resLength + 1); // +1 for null terminator
     if (!res) {
         // Clean up errors before returning
-        for (u32 i = 0; i < re->errors.length; i++) free(errors[i].data);
-        free(errors);
+        for (u32 i = 0; i < re->errors.length; i++) memFree(a, errors[i].data, errors[i].length + 1);
+        memFree(a, errors, re->errors.length * sizeof(string_t));
         return string_null;
     }
 
@@ -114,25 +124,29 @@ string_t reporter_formatAll(const ErrorReporter* re, const Source src) {
             *current++ = err.data[j];
 
         // Free the individual error string
-        free((void*)err.data);
+        memFree(a, err.data, err.length + 1);
     }
 
     // Null terminate the result
     *current = '\0';
 
     // Free the errors array
-    free(errors);
+    memFree(a, errors, re->errors.length * sizeof(string_t));
 
     return (string_t) { .data=res, .length=resLength };
 }
 
 bool reporter_throwIfAny(const ErrorReporter* re, const Source src) {
+    return re ? reporter_throwIfAnyWith(re, src, re->allocator) : false;
+}
+
+bool reporter_throwIfAnyWith(const ErrorReporter* re, const Source src, const Allocator allocator) {
     if (!re) return false;
     if (!reporter_hasErrors(re)) return false;
 
-    const string_t msg = reporter_formatAll(re, src);
+    const string_t msg = reporter_formatAllWith(re, src, allocator);
     re->printer(msg);
-    free(msg.data);
+    memFree(&allocator, msg.data, msg.length + 1);
 
     return true;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "errors.h"
+#include "../utils/memory.h"
 
 #define REPORT_NULL                (1u << 0)
 #define REPORT_COLORED             (1u << 1)
@@ -19,10 +20,12 @@ typedef struct ErrorReporter {
         usize capacity;
     } errors;
     ErrorPrinter printer;
+    Allocator allocator;    // Error list and formatted messages
     u8 flags;
 } ErrorReporter;
 
 ErrorReporter reporter_new(usize capacity, ErrorPrinter printer, u8 flags);
+ErrorReporter reporter_newWith(usize capacity, ErrorPrinter printer, u8 flags, Allocator allocator);
 
 static inline
 bool reporter_isNull(const ErrorReporter* reporter) {
@@ -41,8 +44,12 @@ bool reporter_hasBreakError(const ErrorReporter* reporter) {
 
 void reporter_clear(ErrorReporter* reporter);
 bool reporter_push(ErrorReporter* re, SourceError error, Source src);
+// Every error formatted, free the result with the reporter's allocator
 string_t reporter_formatAll(const ErrorReporter* re, Source src);
+// Same, the report and its scratch memory come from `allocator`
+string_t reporter_formatAllWith(const ErrorReporter* re, Source src, Allocator allocator);
 bool reporter_throwIfAny(const ErrorReporter* re, Source src);
+bool reporter_throwIfAnyWith(const ErrorReporter* re, Source src, Allocator allocator);
 void reporter_log(string_t string);
 
 void reporter_defaultPrinter(string_t string);
\ No newline at end of file
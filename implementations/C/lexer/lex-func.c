@@ -4,6 +4,10 @@
 
 #include "token.h"
 #include "lexer.h"
+#include "lex-scan.h"
+#include "lex-ops.h"
+#include "../program/capacity-plan.h"
+#include "../program/line-table.h"
 #include "../constants/const-lexer.h"
 #include "../error/errors.h"
 #include "../error/reporter.h"
@@ -63,6 +67,13 @@ bool _lex_advance(Lexer* lx, const u32 len) {
     return !_lex_isAtEnd(lx);
 }
 
+// Plain view of the source bytes [start, start + len), no interning.
+// Only identifiers need identity, every other token is just a span.
+static inline
+str_t _lex_span(const Lexer* lx, const u32 start, const u32 len) {
+    return str_new(lx->program->source->data + start, len);
+}
+
 #define _lex_matcha(lx, s) _lex_match(lx, s, slenof(s))
 #define _lex_isa(lx, s) _lex_is(lx, s, slenof(s))
 #define _lex_advancea(lx, s) _lex_advance(lx, slenof(s))
@@ -71,23 +82,48 @@ bool _lex_advance(Lexer* lx, const u32 len) {
 // LEXER SKIP HELPERS
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
+// Line starts inside the skipped range [from, position)
+static inline
+void _lex_recordLines(const Lexer* lx, const u32 from) {
+    LineTable* lines = lx->program->source->lines;
+    if (lines != NULL && lx->position > from)
+        lines_record(lines, lx->program->source->data, from, lx->position);
+}
+
 void _lex_skipWhitespace(Lexer* lx) {
-    while (!_lex_isAtEnd(lx) && CL_isWhitespace(_lex_current(lx)))
-        lx->position++;
+    const u32 from = lx->position;
+    lx->position = scan_whitespace(
+        lx->program->source->data, lx->position, lx->program->source->dataLength);
+
+    _lex_recordLines(lx, from);
 }
 
 void _lex_skipLineComment(Lexer* lx) {
     while (_lex_matcha(lx, CL_LineComment)) {
-        while (!(_lex_isAtEnd(lx) || _lex_matcha(lx, CL_newline)))
+        lx->position = scan_lineEnd(
+            lx->program->source->data, lx->position, lx->program->source->dataLength);
+
+        // Consume the '\n' itself (covers "\r\n" as well),
+        // the comment text has no other one to record
+        if (!_lex_isAtEnd(lx)) {
             lx->position++;
+            _lex_recordLines(lx, lx->position - 1);
+        }
     }
 }
 
 void _lex_skipBlockComment(Lexer* lx) {
+    const u32 from = lx->position;
+
     while (_lex_matcha(lx, CL_BlockCommentStart)) {
-        while (!(_lex_isAtEnd(lx) || _lex_matcha(lx, CL_BlockCommentEnd)))
-            lx->position++;
+        lx->position = scan_blockEnd(
+            lx->program->source->data, lx->position, lx->program->source->dataLength);
+
+        if (!_lex_isAtEnd(lx))
+            lx->position += slenof(CL_BlockCommentEnd);
     }
+
+    _lex_recordLines(lx, from);
 }
 
 void _lex_skipComment(Lexer* lx) {
@@ -120,10 +156,7 @@ Token _lex_nextTok(Lexer* lx) {
     const u32 start = lx->position;
     u32 len = 0;
 
-#define ifMatch(s) if (_lex_matcha(lx, s))
-#define tokenof(type) tok_new(type, strPool_intern( \
-    lx->program->stringPool, \
-    lx->program->source->data + start, len), start)
+#define tokenof(type) tok_new(type, _lex_span(lx, start, len), start)
 
     if (CL_isNumberStart(c))
         return _lex_number(lx);
@@ -131,148 +164,18 @@ Token _lex_nextTok(Lexer* lx) {
     if (CL_isIdentifierStart(c))
         return _lex_identifier(lx);
 
-    if (CL_isWhitespace(c))
-        goto Single;
-
-    if (CL_isWhitespace(c))
-        goto Double;
-
-    // Handle triple char operators
-    len = 3;
-
-    ifMatch (CL_RotateLeft)
-        return tokenof(tt_rotLeft);
-
-    ifMatch (CL_RotateRight)
-        return tokenof(tt_rotRight);
-
-    ifMatch (CL_StrictEqual)
-        return tokenof(tt_strictEqual);
-
-    ifMatch (CL_StrictNotEqual)
-        return tokenof(tt_strictNotEqual);
-
-    ifMatch (CL_ApproxEqual)
-        return tokenof(tt_approxEqual);
-
-    ifMatch (CL_NotApproxEqual)
-        return tokenof(tt_notApproxEqual);
-
-    // Handle double char operators
-Double:
-    len = 2;
-
-    ifMatch (CL_ShiftLeft)
-        return tokenof(tt_shiftLeft);
-
-    ifMatch (CL_ShiftRight)
-        return tokenof(tt_shiftRight);
-
-    ifMatch (CL_IntDiv)
-        return tokenof(tt_intDiv);
-
-    ifMatch (CL_Power)
-        return tokenof(tt_power);
-
-    ifMatch (CL_EqualEqual)
-        return tokenof(tt_equalEqual);
-
-    ifMatch (CL_NotEqual)
-        return tokenof(tt_notEqual);
-
-    ifMatch (CL_LessEqual)
-        return tokenof(tt_lessEqual);
-
-    ifMatch (CL_GreaterEqual)
-        return tokenof(tt_greaterEqual);
-
-    ifMatch (CL_LogicalAnd)
-        return tokenof(tt_logicalAnd);
-
-    ifMatch (CL_LogicalOr)
-        return tokenof(tt_logicalOr);
-
-    ifMatch (CL_LogicalXor)
-        return tokenof(tt_logicalXor);
-
-    ifMatch (CL_Coalesce)
-        return tokenof(tt_coalesce);
-
-    ifMatch (CL_Guard)
-        return tokenof(tt_guard);
-
-    // Handle single char operators
-Single:
-    len = 1;
-
-    lx->position++;
-    switch (c) {
-        case CL_Dollar:
-            return tokenof(tt_dollar);
-
-        case CL_BitAnd:
-            return tokenof(tt_bitAnd);
-
-        case CL_BitOr:
-            return tokenof(tt_bitOr);
-
-        case CL_BitXor:
-            return tokenof(tt_bitXor);
-
-        case CL_BitNot:
-            return tokenof(tt_bitNot);
-
-        case CL_Plus:
-            return tokenof(tt_plus);
-
-        case CL_Minus:
-            return tokenof(tt_minus);
-
-        case CL_Star:
-            return tokenof(tt_star);
-
-        case CL_Slash:
-            return tokenof(tt_slash);
-
-        case CL_Percent:
-            return tokenof(tt_percent);
-
-        case CL_LParen:
-            return tokenof(tt_lParen);
-
-        case CL_RParen:
-            return tokenof(tt_rParen);
-
-        case CL_Comma:
-            return tokenof(tt_comma);
-
-        case CL_Less:
-            return tokenof(tt_less);
-
-        case CL_Greater:
-            return tokenof(tt_greater);
+    if (c == CL_Hash)
+        return _lex_color(lx);
 
-        case CL_Not:
-            return tokenof(tt_not);
+    // One table lookup on the first byte, then walk the operator trie
+    const TokenType type = lexop_match(lx->program->source->data,
+        start, lx->program->source->dataLength, &len);
 
-        case CL_Question:
-            return tokenof(tt_question);
-
-        case CL_Colon:
-            return tokenof(tt_colon);
-
-        case CL_Semicolon:
-            return tokenof(tt_semicolon);
-
-        case CL_Hash:
-            lx->position--;
-            return _lex_color(lx);
-
-        default:
-            lx->position--;
+    if (type != tt_invalid) {
+        lx->position += len;
+        return tokenof(type);
     }
 
-#undef ifMatch
 #undef tokenof
 
     _lex_error(lx, lx->position, 1,
@@ -284,41 +187,45 @@ Single:
 
 Token _lex_color(Lexer* lx) {
     const u32 start = lx->position;
-    _lex_advancea(lx, CL_Hash);
+    _lex_advance(lx, 1); // '#'
+
+    // Colors are at most 8 digits, decode them while walking instead of
+    // running the vector scanner and parsing the digits a second time
+    const char* data = lx->program->source->data;
+    const u32 dataLength = lx->program->source->dataLength;
+    u32 value = 0;
 
-    while (!_lex_isAtEnd(lx)
-        && CL_isHexDigit(lx->program->source->data[lx->position]))
+    while (lx->position < dataLength && CL_isHexDigit(data[lx->position])) {
+        value = value << 4 | (u32)_cvt_hexCharToInt(data[lx->position]);
         lx->position++;
+    }
 
     const u32 lexLength = lx->position - start;
 
-    // INTERN the string directly from source buffer!
-    const str_t lexeme = strPool_intern(
-        lx->program->stringPool,
-        lx->program->source->data + start,  // Point directly into source
-        lexLength
-    );
+    const str_t lexeme = _lex_span(lx, start, lexLength);
 
-    return tok_new(tt_hexColor, lexeme, start);
+    return tok_newValue(tt_hexColor, lexeme, start,
+        (TokenValue){ .u = cvt_hexDigitsToColor(value, lexLength - 1) });
 }
 
 Token _lex_identifier(Lexer* lx) {
     const u32 start = lx->position;
 
-    while (!_lex_isAtEnd(lx)
-        && CL_isIdentifierPart(lx->program->source->data[lx->position]))
-        lx->position++;
+    lx->position = scan_identifier(
+        lx->program->source->data, lx->position, lx->program->source->dataLength);
 
     const u32 lexLength = lx->position - start;
 
     // INTERN the identifier directly from source
-    const str_t lexeme = strPool_intern(
-        lx->program->stringPool,
+    StringPool* pool = lx->program->stringPool;
+    const SymbolId symbol = strPool_internId(
+        pool,
         lx->program->source->data + start,  // Direct pointer into source
         lexLength
     );
 
-    return tok_new(tt_identifier, lexeme, start);
+    return tok_newValue(tt_identifier, strPool_get(pool, symbol), start,
+        (TokenValue){ .u = symbol });
 }
 
 Token _lex_number(Lexer* lx) {
@@ -362,6 +269,7 @@ Token _lex_hexNumber(Lexer* lx, const u32 start) {
     }
 
     bool separated = false;
+    u32 value = 0;
 
     while (!_lex_isAtEnd(lx)) {
         const char c = LEXER_CH(lx);
@@ -379,6 +287,7 @@ Token _lex_hexNumber(Lexer* lx, const u32 start) {
 
         if (CL_isHexDigit(c)) {
             separated = false;
+            value = value << 4 | (u32)_cvt_hexCharToInt(c);
             lx->position++;
             continue;
         }
@@ -393,11 +302,7 @@ Token _lex_hexNumber(Lexer* lx, const u32 start) {
 
     const u32 lexLength = lx->position - start;
 
-    const str_t lexeme = strPool_intern(
-        lx->program->stringPool,
-        lx->program->source->data + start,
-        lexLength
-    );
+    const str_t lexeme = _lex_span(lx, start, lexLength);
 
     // Must have at least one hex digit after 0x
     if (lexLength <= 2 ||
@@ -406,7 +311,8 @@ Token _lex_hexNumber(Lexer* lx, const u32 start) {
         return INVALID_TOKEN;
       }
 
-    return tok_new(tt_hex, lexeme, start);
+    // Same 32-bit wrap as cvt_hexToInt
+    return tok_newValue(tt_hex, lexeme, start, (TokenValue){ .i = (i32)value });
 }
 
 Token _lex_binaryNumber(Lexer* lx, const u32 start) {
@@ -421,6 +327,7 @@ Token _lex_binaryNumber(Lexer* lx, const u32 start) {
     }
 
     bool separated = false;
+    u32 value = 0;
 
     while (!_lex_isAtEnd(lx)) {
         const char c = LEXER_CH(lx);
@@ -439,6 +346,7 @@ Token _lex_binaryNumber(Lexer* lx, const u32 start) {
 
         if (CL_isBinDigit(c)) {
             separated = false;
+            value = value << 1 | (u32)(c - '0');
             lx->position++;
             continue;
         }
@@ -452,11 +360,7 @@ Token _lex_binaryNumber(Lexer* lx, const u32 start) {
 
     const u32 lexLength = lx->position - start;
 
-    const str_t lexeme = strPool_intern(
-        lx->program->stringPool,
-        lx->program->source->data + start,
-        lexLength
-    );
+    const str_t lexeme = _lex_span(lx, start, lexLength);
 
     // Must have at least one binary digit after 0b
     if (lexLength <= 2 ||
@@ -466,7 +370,8 @@ Token _lex_binaryNumber(Lexer* lx, const u32 start) {
         return INVALID_TOKEN;
       }
 
-    return tok_new(tt_bin, lexeme, start);
+    // Same 32-bit wrap as cvt_binToInt
+    return tok_newValue(tt_bin, lexeme, start, (TokenValue){ .i = (i32)value });
 }
 
 Token _lex_octalNumber(Lexer* lx, const u32 start) {
@@ -481,6 +386,7 @@ Token _lex_octalNumber(Lexer* lx, const u32 start) {
     }
 
     bool separated = false;
+    u32 value = 0;
 
     while (!_lex_isAtEnd(lx)) {
         const char c = LEXER_CH(lx);
@@ -499,6 +405,7 @@ Token _lex_octalNumber(Lexer* lx, const u32 start) {
 
         if (CL_isOctDigit(c)) {
             separated = false;
+            value = value << 3 | (u32)(c - '0');
             lx->position++;
             continue;
         }
@@ -513,11 +420,7 @@ Token _lex_octalNumber(Lexer* lx, const u32 start) {
 
     const u32 lexLength = lx->position - start;
 
-    const str_t lexeme = strPool_intern(
-        lx->program->stringPool,
-        lx->program->source->data + start,
-        lexLength
-    );
+    const str_t lexeme = _lex_span(lx, start, lexLength);
 
     // Must have at least one octal digit after 0o
     if (lexLength <= 2 ||
@@ -527,7 +430,8 @@ Token _lex_octalNumber(Lexer* lx, const u32 start) {
         return INVALID_TOKEN;
       }
 
-    return tok_new(tt_oct, lexeme, start);
+    // Same 32-bit wrap as cvt_octToInt
+    return tok_newValue(tt_oct, lexeme, start, (TokenValue){ .i = (i32)value });
 }
 
 Token _lex_maskNumber(Lexer* lx, const u32 start) {
@@ -574,11 +478,7 @@ Token _lex_maskNumber(Lexer* lx, const u32 start) {
 
     const u32 lexLength = lx->position - start;
 
-    const str_t lexeme = strPool_intern(
-        lx->program->stringPool,
-        lx->program->source->data + start,
-        lexLength
-    );
+    const str_t lexeme = _lex_span(lx, start, lexLength);
 
     // Must have at least one mask digit after 0m
     if (lexLength <= 2 ||
@@ -588,7 +488,11 @@ Token _lex_maskNumber(Lexer* lx, const u32 start) {
         return INVALID_TOKEN;
       }
 
-    return tok_new(tt_mask, lexeme, start);
+    // Mask digits expand through a small state machine (repeats, counts),
+    // decode the validated span with it rather than duplicating the rules
+    const i32 value = (i32)cvt_maskToInt(lexeme.data, lexeme.length);
+
+    return tok_newValue(tt_mask, lexeme, start, (TokenValue){ .i = value });
 }
 
 Token _lex_decimalNumber(Lexer* lx, const u32 start) {
@@ -597,6 +501,18 @@ Token _lex_decimalNumber(Lexer* lx, const u32 start) {
     bool separated = false;
     TokenType type = tt_int32;
 
+    // Decoded alongside validation:
+    // int32 saturates like cvt_decimalToInt, floats keep up to 19
+    // significant digits and a power of ten for cvt_decimalPartsToFloat
+    u32 intValue = 0;
+    bool saturated = false;
+    u64 mantissa = 0;
+    u32 significant = 0;
+    bool truncated = false;
+    i32 exp10 = 0;
+    i32 exponent = 0;
+    bool expNegative = false;
+
     // Check if starts with dot
     if (_lex_current(lx) == '.') {
       hasDot = true;
@@ -647,15 +563,43 @@ Token _lex_decimalNumber(Lexer* lx, const u32 start) {
 
         // Optional exponent sign
         if (!_lex_isAtEnd(lx)
-            && (LEXER_CH(lx) == '+' || LEXER_CH(lx) == '-'))
+            && (LEXER_CH(lx) == '+' || LEXER_CH(lx) == '-')) {
+          expNegative = LEXER_CH(lx) == '-';
           lx->position++;
+        }
 
         continue;
       }
 
       // if it is a digit, continue parsing
       if (CL_isDigit(c)) {
+        const u32 digit = (u32)(c - '0');
         lx->position++;
+
+        if (hasExp) {
+          // Anything this large is already inf or 0
+          if (exponent < 100000) exponent = exponent * 10 + (i32)digit;
+          continue;
+        }
+
+        if (!saturated) {
+          if ((i32)intValue > INT32_MAX / 10) {
+            intValue = INT32_MAX;
+            saturated = true;
+          } else {
+            intValue = intValue * 10 + digit;
+          }
+        }
+
+        if (significant < 19) {
+          mantissa = mantissa * 10 + digit;
+          if (mantissa) significant++;
+          if (hasDot) exp10--;
+        } else {
+          if (!hasDot) exp10++;
+          truncated |= digit != 0;
+        }
+
         continue;
       }
 
@@ -669,11 +613,7 @@ Token _lex_decimalNumber(Lexer* lx, const u32 start) {
 
     const u32 lexLength = lx->position - start;
 
-    const str_t lexeme = strPool_intern(
-        lx->program->stringPool,
-        lx->program->source->data + start,
-        lexLength
-    );
+    const str_t lexeme = _lex_span(lx, start, lexLength);
 
     // Validate the decimal number
     if (lexLength == 0) {
@@ -702,61 +642,18 @@ Token _lex_decimalNumber(Lexer* lx, const u32 start) {
       return INVALID_TOKEN;
     }
 
-    return tok_new(type, lexeme,start);
-}
-
-static inline
-usize _lex_countTokensApprox(const char* source, const usize length) {
-    usize count = 0;
-    bool in_token = false;
-    bool in_comment = false;
-    bool in_comment_block = false;
-
-    for (usize i = 0; i < length; i++) {
-        const char c = source[i];
-
-#define _match1(ch) (c == ch)
-#define _match2(str) (c == str[0] && i + 1 < length && source[i+1] == str[1])
-
-        if (in_comment) {
-            if (_match1('\n')) in_comment = false;
-            continue;
-        }
-
-        if (in_comment_block) {
-            if (_match2("*/")) in_comment_block = false;
-            continue;
-        }
+    TokenValue value;
 
-        // Comment detection
-        if (_match2("//")) {
-            in_comment = true;
-            i+=2; // Skip '//'
-            continue;
-        }
-
-        // Comment block detection
-        if (_match2("/*")) {
-            in_comment_block = true;
-            i+=2; // Skip '/*'
-            continue;
-        }
-
-        // Count transitions from whitespace to non-whitespace
-        if (!CL_isWhitespace(c)) {
-            if (!in_token) {
-                count++;  // Start of a new token
-                in_token = true;
-            } else {
-                in_token = false;
-            }
-        }
-
-#undef _match1
-#undef _match2
+    if (type == tt_int32) {
+      value.i = (i32)intValue;
+    } else {
+      exp10 += expNegative ? -exponent : exponent;
 
+      // Past 19 significant digits the rounding may need the full text
+      value.f = truncated
+          ? cvt_expToFloat(lexeme.data, lexeme.length)
+          : cvt_decimalPartsToFloat(mantissa, exp10);
     }
 
-    // Add a small buffer (10-20%) for safety
-    return (usize)(count * 1.2 + 1);  // +20% +1(eof)
-}
\ No newline at end of file
+    return tok_newValue(type, lexeme, start, value);
+}
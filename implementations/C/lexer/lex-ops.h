@@ -0,0 +1,102 @@
+/*
+ * @file lex-ops.h
+ *
+ * Operator set from const-lexer.h (CL_OPERATORS) compiled into a
+ * first-byte dispatch table.
+ *
+ * Both tables are expanded from the list at compile time, there is no
+ * second copy of the operators to keep in sync. Lexing an operator costs
+ * one lookup on the first byte, giving the (at most four) operators that
+ * start with it, then one masked compare of the next three bytes per
+ * candidate. The longest match wins, so prefixes that are not operators
+ * by themselves (`=`, `~=`, `!~`) fall back to the shorter operator,
+ * exactly like the old 3-char / 2-char / 1-char match order.
+ *
+ * '#' is not in the list, it starts a color literal.
+ */
+
+#pragma once
+
+#include "token.h"
+#include "../constants/const-lexer.h"
+
+// One LEX_OPS entry per CL_OPERATORS entry
+enum {
+#define _LOP_INDEX(_, type, a, b, c) LOP_##type,
+    CL_OPERATORS(_LOP_INDEX, )
+#undef _LOP_INDEX
+    LOP_COUNT
+};
+
+_Static_assert(LOP_COUNT <= 64, "LEX_OP_FIRST holds one bit per operator");
+
+typedef struct LexOp {
+    u32 key;        // operator bytes, first byte in the low 8 bits
+    u8 length;
+    u8 type;        // TokenType
+} LexOp;
+
+#define _LOP_ENTRY(_, type, a, b, c) [LOP_##type] = { \
+    (u32)(u8)(a) | (u32)(u8)(b) << 8 | (u32)(u8)(c) << 16, \
+    1 + ((b) != 0) + ((c) != 0), (type) },
+
+static const
+LexOp LEX_OPS[LOP_COUNT] = {
+    CL_OPERATORS(_LOP_ENTRY, )
+};
+
+#undef _LOP_ENTRY
+
+// Every byte value 0..255, each passed to F
+#define _LOP_B4(F, n) F(n) F((n) + 1) F((n) + 2) F((n) + 3)
+#define _LOP_B16(F, n) _LOP_B4(F, n) _LOP_B4(F, (n) + 4) _LOP_B4(F, (n) + 8) _LOP_B4(F, (n) + 12)
+#define _LOP_B64(F, n) _LOP_B16(F, n) _LOP_B16(F, (n) + 16) _LOP_B16(F, (n) + 32) _LOP_B16(F, (n) + 48)
+#define _LOP_B256(F) _LOP_B64(F, 0) _LOP_B64(F, 64) _LOP_B64(F, 128) _LOP_B64(F, 192)
+
+#define _LOP_STARTS(byte, type, a, b, c) | ((u64)((a) == (byte)) << LOP_##type)
+#define _LOP_FIRST(byte) (0 CL_OPERATORS(_LOP_STARTS, byte)),
+
+// First byte -> bit set of the LEX_OPS entries starting with it, 0 when
+// the byte cannot start an operator
+static const
+u64 LEX_OP_FIRST[256] = {
+    _LOP_B256(_LOP_FIRST)
+};
+
+#undef _LOP_FIRST
+#undef _LOP_STARTS
+#undef _LOP_B256
+#undef _LOP_B64
+#undef _LOP_B16
+#undef _LOP_B4
+
+/**
+ * Longest operator match starting at `data[pos]`.
+ * Returns the token type (tt_invalid when nothing matches)
+ * and writes the operator length to `len`.
+ */
+static inline
+TokenType lexop_match(const char* data, const u32 pos, const u32 dataLength, u32* len) {
+    u64 candidates = LEX_OP_FIRST[(u8)data[pos]];
+    TokenType accept = tt_invalid;
+    *len = 0;
+
+    if (!candidates) return accept;
+
+    // Up to three bytes, '\0' past the end
+    u32 window = (u8)data[pos];
+    if (pos + 1 < dataLength) window |= (u32)(u8)data[pos + 1] << 8;
+    if (pos + 2 < dataLength) window |= (u32)(u8)data[pos + 2] << 16;
+
+    for (; candidates; candidates &= candidates - 1) {
+        const LexOp* op = &LEX_OPS[__builtin_ctzll(candidates)];
+        const u32 mask = 0xFFFFFFu >> (24 - 8 * op->length);
+
+        if ((window & mask) == op->key && op->length > *len) {
+            accept = (TokenType)op->type;
+            *len = op->length;
+        }
+    }
+
+    return accept;
+}
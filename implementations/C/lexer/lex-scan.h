@@ -0,0 +1,240 @@
+/*
+ * @file lex-scan.h
+ *
+ * Vectorized character-class scanners used by the lexer hot loops.
+ *
+ * Every scanner takes the source buffer, a start position and the buffer
+ * length, and returns the position of the first byte that does NOT belong
+ * to the scanned run (or `len` when the run reaches the end of input).
+ * Blocks are never loaded past `len`, the tail is finished by the scalar
+ * fallback, so no sentinel padding is required.
+ *
+ * Width is picked at compile time:
+ *   AVX2  -> 32 bytes per block (build with -mavx2 or -march=native)
+ *   SSE2  -> 16 bytes per block (x86 baseline)
+ *   other -> scalar only
+ *
+ * Define TSTM_NO_SIMD to force the scalar path.
+ */
+
+#pragma once
+
+#include "../utils/short-types.h"
+#include "../constants/const-lexer.h"
+
+#if !defined(TSTM_NO_SIMD) && ARCH_hasAVX2
+#   include <immintrin.h>
+#   define SCAN_WIDTH 32
+#elif !defined(TSTM_NO_SIMD) && ARCH_hasSSE2 && defined(__SSE2__)
+#   include <emmintrin.h>
+#   define SCAN_WIDTH 16
+#else
+#   define SCAN_WIDTH 0
+#endif
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// SCALAR FALLBACK
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static inline
+u32 _scan_whitespaceScalar(const char* data, u32 pos, const u32 len) {
+    while (pos < len && CL_isWhitespace(data[pos])) pos++;
+    return pos;
+}
+
+static inline
+u32 _scan_identifierScalar(const char* data, u32 pos, const u32 len) {
+    while (pos < len && CL_isIdentifierPart(data[pos])) pos++;
+    return pos;
+}
+
+static inline
+u32 _scan_hexDigitsScalar(const char* data, u32 pos, const u32 len) {
+    while (pos < len && CL_isHexDigit(data[pos])) pos++;
+    return pos;
+}
+
+static inline
+u32 _scan_lineEndScalar(const char* data, u32 pos, const u32 len) {
+    while (pos < len && data[pos] != '\n') pos++;
+    return pos;
+}
+
+static inline
+u32 _scan_blockEndScalar(const char* data, u32 pos, const u32 len) {
+    while (pos + 1 < len && !(data[pos] == '*' && data[pos + 1] == '/')) pos++;
+    return pos + 1 < len ? pos : len;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// VECTOR PRIMITIVES
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#if SCAN_WIDTH == 32
+
+typedef __m256i scan_vec;
+typedef u32 scan_mask;
+
+#define _scan_load(p)    _mm256_loadu_si256((const __m256i*)(p))
+#define _scan_set1(c)    _mm256_set1_epi8((char)(c))
+#define _scan_eq(a, b)   _mm256_cmpeq_epi8((a), (b))
+#define _scan_or(a, b)   _mm256_or_si256((a), (b))
+#define _scan_and(a, b)  _mm256_and_si256((a), (b))
+#define _scan_sub(a, b)  _mm256_sub_epi8((a), (b))
+#define _scan_min(a, b)  _mm256_min_epu8((a), (b))
+#define _scan_bits(v)    ((scan_mask)_mm256_movemask_epi8(v))
+#define _scan_andnot(a, b) _mm256_andnot_si256((a), (b))   // ~a & b
+#define _scan_zero()     _mm256_setzero_si256()
+
+// Sum of the unsigned bytes of `v`
+static inline
+u32 _scan_sum(const scan_vec v) {
+    const __m256i s = _mm256_sad_epu8(v, _mm256_setzero_si256());
+    const __m128i h = _mm_add_epi64(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+    return (u32)(_mm_cvtsi128_si32(h) + _mm_cvtsi128_si32(_mm_srli_si128(h, 8)));
+}
+
+#elif SCAN_WIDTH == 16
+
+typedef __m128i scan_vec;
+typedef u32 scan_mask;
+
+#define _scan_load(p)    _mm_loadu_si128((const __m128i*)(p))
+#define _scan_set1(c)    _mm_set1_epi8((char)(c))
+#define _scan_eq(a, b)   _mm_cmpeq_epi8((a), (b))
+#define _scan_or(a, b)   _mm_or_si128((a), (b))
+#define _scan_and(a, b)  _mm_and_si128((a), (b))
+#define _scan_sub(a, b)  _mm_sub_epi8((a), (b))
+#define _scan_min(a, b)  _mm_min_epu8((a), (b))
+#define _scan_bits(v)    ((scan_mask)_mm_movemask_epi8(v) & 0xFFFFu)
+#define _scan_andnot(a, b) _mm_andnot_si128((a), (b))      // ~a & b
+#define _scan_zero()     _mm_setzero_si128()
+
+// Sum of the unsigned bytes of `v`
+static inline
+u32 _scan_sum(const scan_vec v) {
+    const __m128i s = _mm_sad_epu8(v, _mm_setzero_si128());
+    return (u32)(_mm_cvtsi128_si32(s) + _mm_cvtsi128_si32(_mm_srli_si128(s, 8)));
+}
+
+#endif
+
+#if SCAN_WIDTH
+
+#define _SCAN_FULL ((scan_mask)(SCAN_WIDTH == 32 ? 0xFFFFFFFFu : 0xFFFFu))
+
+// Unsigned byte range check: lo <= v <= hi
+static inline
+scan_vec _scan_inRange(const scan_vec v, const char lo, const char hi) {
+    const scan_vec t = _scan_sub(v, _scan_set1(lo));
+    return _scan_eq(_scan_min(t, _scan_set1(hi - lo)), t);
+}
+
+// ' ', '\t', '\n', '\v', '\f', '\r'
+static inline
+scan_vec _scan_classWhitespace(const scan_vec v) {
+    return _scan_or(_scan_eq(v, _scan_set1(' ')), _scan_inRange(v, '\t', '\r'));
+}
+
+// [a-zA-Z0-9_]
+static inline
+scan_vec _scan_classIdentifier(const scan_vec v) {
+    const scan_vec lower = _scan_or(v, _scan_set1(0x20));
+    return _scan_or(
+        _scan_or(_scan_inRange(lower, 'a', 'z'), _scan_inRange(v, '0', '9')),
+        _scan_eq(v, _scan_set1('_')));
+}
+
+// [0-9a-fA-F]
+static inline
+scan_vec _scan_classHexDigit(const scan_vec v) {
+    const scan_vec lower = _scan_or(v, _scan_set1(0x20));
+    return _scan_or(_scan_inRange(lower, 'a', 'f'), _scan_inRange(v, '0', '9'));
+}
+
+// Advance `pos` over whole blocks whose bytes all match `classify`,
+// return from the enclosing function as soon as one byte does not.
+#define _SCAN_RUN(data, pos, len, classify) do {                              \
+    while ((pos) + SCAN_WIDTH <= (len)) {                                     \
+        const scan_mask miss =                                                \
+            ~_scan_bits(classify(_scan_load((data) + (pos)))) & _SCAN_FULL;   \
+        if (miss) return (pos) + (u32)__builtin_ctz(miss);                    \
+        (pos) += SCAN_WIDTH;                                                  \
+    }                                                                         \
+} while (0)
+
+#endif
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// SCANNERS
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// End of a whitespace run starting at `pos`
+static inline
+u32 scan_whitespace(const char* data, u32 pos, const u32 len) {
+    // Most gaps are a single space, do not pay for a vector load
+    if (pos < len && !CL_isWhitespace(data[pos])) return pos;
+
+#if SCAN_WIDTH
+    _SCAN_RUN(data, pos, len, _scan_classWhitespace);
+#endif
+
+    return _scan_whitespaceScalar(data, pos, len);
+}
+
+// End of an identifier run ([a-zA-Z0-9_]*) starting at `pos`
+static inline
+u32 scan_identifier(const char* data, u32 pos, const u32 len) {
+#if SCAN_WIDTH
+    _SCAN_RUN(data, pos, len, _scan_classIdentifier);
+#endif
+
+    return _scan_identifierScalar(data, pos, len);
+}
+
+// End of a hex digit run ([0-9a-fA-F]*) starting at `pos`
+static inline
+u32 scan_hexDigits(const char* data, u32 pos, const u32 len) {
+#if SCAN_WIDTH
+    _SCAN_RUN(data, pos, len, _scan_classHexDigit);
+#endif
+
+    return _scan_hexDigitsScalar(data, pos, len);
+}
+
+// Position of the next '\n' at or after `pos`, or `len`
+static inline
+u32 scan_lineEnd(const char* data, u32 pos, const u32 len) {
+#if SCAN_WIDTH
+    const scan_vec nl = _scan_set1('\n');
+
+    while (pos + SCAN_WIDTH <= len) {
+        const scan_mask hit = _scan_bits(_scan_eq(_scan_load(data + pos), nl));
+        if (hit) return pos + (u32)__builtin_ctz(hit);
+        pos += SCAN_WIDTH;
+    }
+#endif
+
+    return _scan_lineEndScalar(data, pos, len);
+}
+
+// Position of the next "*/" at or after `pos`, or `len` when unterminated
+static inline
+u32 scan_blockEnd(const char* data, u32 pos, const u32 len) {
+#if SCAN_WIDTH
+    const scan_vec star = _scan_set1('*');
+    const scan_vec slash = _scan_set1('/');
+
+    // Second load is shifted by one byte, so it must also stay in bounds
+    while (pos + SCAN_WIDTH + 1 <= len) {
+        const scan_vec first = _scan_eq(_scan_load(data + pos), star);
+        const scan_vec second = _scan_eq(_scan_load(data + pos + 1), slash);
+
+        const scan_mask hit = _scan_bits(_scan_and(first, second));
+        if (hit) return pos + (u32)__builtin_ctz(hit);
+        pos += SCAN_WIDTH;
+    }
+#endif
+
+    return _scan_blockEndScalar(data, pos, len);
+}
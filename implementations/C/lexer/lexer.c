@@ -3,6 +3,7 @@
 #include "token.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 bool Lexer_isValid(const Lexer* lx) {
     if (!lx) {
@@ -29,25 +30,185 @@ bool Lexer_isValid(const Lexer* lx) {
     return true;
 }
 
-TokenList Lexer_lex(Lexer* lx) {
-    const usize gassed_capacity = _lex_countTokensApprox(lx->program->source->data, lx->program->source->dataLength);
-    TokenList tokens = toklist_new(gassed_capacity, malloc, free);
-    
-    while (!_lex_isAtEnd(lx)) {
-      const Token token = _lex_nextTok(lx);
-      if (token.type == INVALID_TOKEN.type) break;
-      
-      toklist_push(&tokens, token);
+// Lex one token straight from source, stop for good on end or first error
+static inline
+Token _lex_pull(Lexer* lx) {
+    if (!lx->finished) {
+        const Token token = _lex_nextTok(lx);
+        if (token.type != INVALID_TOKEN.type) return token;
+
+        lx->finished = true;
     }
 
-    toklist_push(&tokens, tok_new(tt_eof, str_null, lx->position));
+    return tok_new(tt_eof, str_null, lx->position);
+}
+
+TokenStore Lexer_lex(Lexer* lx) {
+    const Source* src = lx->program->source;
+    const u32 planned = lx->program->plan
+        ? lx->program->plan->tokens : plan_estimate(src->data, src->dataLength).tokens;
+
+    // Room in the segment table for the plan and 1/8 headroom, more
+    // tokens only add segments
+    TokenStore tokens = tokstore_new(planned + planned / 8 + 1, src->data,
+        lx->program->stringPool, lx->program->allocator);
+    tokstore_reserveLongs(&tokens, src->dataLength / TOKSTORE_LONG);
+
+    Token token;
+    do {
+        token = Lexer_next(lx);
+        if (!tokstore_push(&tokens, token)) {
+            fprintf(stderr, "TokenStore Error: Memory allocation failed during push.\n");
+            break;
+        }
+    } while (token.type != tt_eof);
+
     lx->position = lx->program->source->dataLength;
 
     return tokens;
 }
 
+// Tokens are never split by a newline, so a '\n' in the gap before a
+// token makes it the first of its line
+static inline
+bool _lex_lineBreakIn(const char* data, const u32 from, const u32 to) {
+    return to > from && memchr(data + from, '\n', to - from) != NULL;
+}
+
+// Last declaration start (`name:` first on its line) at or before `offset`,
+// 0 for the start of the file. Only bytes before `offset` are read, those
+// are the same before and after an edit there.
+static TokenId _lex_declBefore(const TokenStore* ts, const char* data, const u32 offset) {
+    TokenId id = tokstore_find(ts, offset + 1);
+
+    while (id > 1) {
+        id--;
+        if (tokstore_type(ts, id) != tt_identifier || tokstore_type(ts, id + 1) != tt_colon)
+            continue;
+
+        const u32 prevEnd = tokstore_start(ts, id - 1) + tokstore_length(ts, id - 1);
+        if (_lex_lineBreakIn(data, prevEnd, tokstore_start(ts, id))) return id;
+    }
+
+    return 0;
+}
+
+TokenSplice Lexer_relex(Lexer* lx, TokenStore* tokens, const SourceEdit edit) {
+    const Source* src = lx->program->source;
+    const i32 delta = (i32)edit.newLength - (i32)edit.oldLength;
+    const u32 newEditEnd = edit.start + edit.newLength;
+
+    const TokenId first = _lex_declBefore(tokens, src->data, edit.start);
+    const u32 from = first == 0 ? 0 : tokstore_start(tokens, first);
+
+    if (src->lines != NULL) lines_truncate(src->lines, from);
+    tokens->source = src->data;
+
+    lx->position = from;
+    lx->aheadStart = 0;
+    lx->aheadLength = 0;
+    lx->finished = false;
+
+    // New tokens up to where the streams line up, spliced in at the end
+    const Allocator heap = mem_heap;
+    Token* fresh = NULL;
+    u32 count = 0, capacity = 0;
+
+    TokenId old = first;                // First old token not passed yet
+    TokenId resync = tokens->length;    // None: re-lexed up to eof
+    u32 gapStart = from;
+
+    for (;;) {
+        const Token token = Lexer_next(lx);
+
+        // A declaration past the edit that starts where an old one did,
+        // everything from there on lexes the same as before
+        if (token.type == tt_identifier && token.start >= newEditEnd
+            && _lex_lineBreakIn(src->data, gapStart, token.start)
+            && Lexer_peek(lx, 0).type == tt_colon) {
+            const u32 oldStart = (u32)((i32)token.start - delta);
+
+            while (old < tokens->length && tokstore_start(tokens, old) < oldStart) old++;
+            if (old < tokens->length && tokstore_start(tokens, old) == oldStart
+                && tokstore_type(tokens, old) == tt_identifier) {
+                resync = old;
+                break;
+            }
+        }
+
+        if (count == capacity) {
+            const u32 grown = capacity ? capacity * 2 : 64;
+            Token* tokensGrown = memResize(&heap, fresh, capacity * sizeof(Token), grown * sizeof(Token));
+            if (!tokensGrown) {
+                fprintf(stderr, "Lexer Error: Memory allocation failed during re-lex.\n");
+                break;
+            }
+
+            fresh = tokensGrown;
+            capacity = grown;
+        }
+
+        fresh[count++] = token;
+        if (token.type == tt_eof) break;
+        gapStart = token.start + token.lexeme.length;
+    }
+
+    const u32 oldEnd = resync < tokens->length
+        ? tokstore_start(tokens, resync) : src->dataLength - (u32)delta;
+
+    const TokenSplice splice = {
+        .first = first,
+        .removed = resync - first,
+        .inserted = count,
+        .from = from,
+        .oldEnd = oldEnd,
+        .newEnd = oldEnd + (u32)delta,
+        .delta = delta,
+    };
+
+    if (!tokstore_splice(tokens, first, splice.removed, fresh, count))
+        fprintf(stderr, "TokenStore Error: Memory allocation failed during splice.\n");
+    tokstore_shift(tokens, first + count, delta);
+
+    memFree(&heap, fresh, capacity * sizeof(Token));
+
+    // Same state as after Lexer_lex
+    lx->position = src->dataLength;
+    lx->aheadStart = 0;
+    lx->aheadLength = 0;
+    lx->finished = true;
+
+    return splice;
+}
+
+Token Lexer_next(Lexer* lx) {
+    if (lx->aheadLength == 0)
+        return _lex_pull(lx);
+
+    const Token token = lx->ahead[lx->aheadStart];
+    lx->aheadStart = (lx->aheadStart + 1) & (LEXER_LOOKAHEAD - 1);
+    lx->aheadLength--;
+
+    return token;
+}
+
+Token Lexer_peek(Lexer* lx, const u32 offset) {
+    if (offset >= LEXER_LOOKAHEAD) return INVALID_TOKEN;
+
+    while (lx->aheadLength <= offset) {
+        const u32 slot = (lx->aheadStart + lx->aheadLength) & (LEXER_LOOKAHEAD - 1);
+        lx->ahead[slot] = _lex_pull(lx);
+        lx->aheadLength++;
+    }
+
+    return lx->ahead[(lx->aheadStart + offset) & (LEXER_LOOKAHEAD - 1)];
+}
+
 Lexer* Lexer_reset(Lexer* lx) {
     lx->position = 0;
+    lx->aheadStart = 0;
+    lx->aheadLength = 0;
+    lx->finished = false;
     return lx;
 }
 
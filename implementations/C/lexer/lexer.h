@@ -5,18 +5,66 @@
 #include "../program/program.h"
 #include "token.h"
 
+// Pull mode lookahead window (must be a power of two)
+#define LEXER_LOOKAHEAD 4
+
 typedef struct Lexer {
     Program* program;
     u32 position;
+
+    // Pull mode state, zero initialized with the rest of the struct
+    Token ahead[LEXER_LOOKAHEAD];   // Ring buffer of already lexed tokens
+    u8 aheadStart;
+    u8 aheadLength;
+    bool finished;                  // No more tokens, only eof from now on
 } Lexer;
 
+// An edit of the source: `oldLength` bytes at `start` were replaced by
+// `newLength` bytes. The program source already holds the edited text.
+typedef struct SourceEdit {
+    u32 start;
+    u32 oldLength;
+    u32 newLength;
+} SourceEdit;
+
+// What Lexer_relex changed: tokens [first, first + removed) became
+// [first, first + inserted), covering old bytes [from, oldEnd) and new
+// bytes [from, newEnd). Every later token moved by `delta` bytes.
+typedef struct TokenSplice {
+    TokenId first;
+    u32 removed;
+    u32 inserted;
+    u32 from;
+    u32 oldEnd;
+    u32 newEnd;
+    i32 delta;
+} TokenSplice;
+
 #define LEXER_AT(lx, i) (lx->program->source->data[i])
 #define LEXER_LEN(lx) (lx->program->source->dataLength)
 #define LEXER_CH(lx) LEXER_AT(lx, lx->position)
 
 bool Lexer_isValid(const Lexer* lx);
 
-TokenList Lexer_lex(Lexer* lx);
+// Lex the whole source into a TokenStore, eof token included
+TokenStore Lexer_lex(Lexer* lx);
+
+/**
+ * Brings `tokens`, lexed from the source before `edit`, up to date with the
+ * edited source. Lexing restarts at the declaration that holds the edit and
+ * stops at the first declaration after it where the old and new token
+ * streams line up again, the tokens after that are only shifted.
+ * Lexer errors of the re-lexed range are reported again, clear the reporter
+ * first to keep only the current ones.
+ */
+TokenSplice Lexer_relex(Lexer* lx, TokenStore* tokens, SourceEdit edit);
+
+// Lex and consume the next token on demand (tt_eof once input is exhausted)
+Token Lexer_next(Lexer* lx);
+
+// Look at the token `offset` positions ahead without consuming it,
+// offset must be below LEXER_LOOKAHEAD (INVALID_TOKEN otherwise)
+Token Lexer_peek(Lexer* lx, u32 offset);
 
 Lexer* Lexer_reset(Lexer* lx);
 
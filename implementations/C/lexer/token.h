@@ -4,6 +4,7 @@
 #include "../utils/convert.h"
 #include "../utils/strings.h"
 #include "../utils/memory.h"
+#include "../program/string-pool.h"
 #include <stdio.h>
 
 // =================================================
@@ -55,10 +56,22 @@ char* TokenType_names[] = {
 // TOKEN
 // =================================================
 
+// Literal value decoded by the lexer while it validated the digits
+typedef union TokenValue {
+  i32 i;        // int32, hex, bin, oct, mask
+  f32 f;        // float32, exp
+  u32 u;        // hexColor (ARGB), identifier (SymbolId)
+} TokenValue;
+
+// Source span of a token: `start` offset + `lexeme.length`.
+// Identifier lexemes are interned in the StringPool and carry their
+// SymbolId in `value.u`, every other lexeme is a plain view into the
+// source buffer.
 typedef struct Token {
   str_t lexeme;
   u32 start;
   TokenType type;
+  TokenValue value;
 } Token;
 
 static Token INVALID_TOKEN = (Token){
@@ -71,6 +84,11 @@ Token tok_new(const TokenType type, const str_t lexeme, const u32 start) {
     return (Token){ .lexeme = lexeme, .start = start, .type = type };
 }
 
+static inline
+Token tok_newValue(const TokenType type, const str_t lexeme, const u32 start, const TokenValue value) {
+    return (Token){ .lexeme = lexeme, .start = start, .type = type, .value = value };
+}
+
 static inline
 u32 tok_len(const Token token) {
     return token.lexeme.length;
@@ -86,29 +104,20 @@ u32 tok_end(const Token token) {
     return token.start + token.lexeme.length;
 }
 
+// Literal values are decoded once at lex time, no re-parse here
 static inline
 i32 tok_asInt(const Token token) {
-    bool _;
-
     switch (token.type) {
       case tt_int32:
-        return cvt_decimalToInt(token.lexeme.data, token.lexeme.length);
-
-      case tt_hexColor:
-        return (i32)cvt_hexStrToColor(token.lexeme.data, token.lexeme.length, &_);
-        
       case tt_hex:
-        return cvt_hexToInt(token.lexeme.data, token.lexeme.length);
-        
       case tt_oct:
-        return cvt_octToInt(token.lexeme.data, token.lexeme.length);
-
       case tt_mask:
-        return (i32)cvt_maskToInt(token.lexeme.data, token.lexeme.length);
-
       case tt_bin:
-        return cvt_binToInt(token.lexeme.data, token.lexeme.length);
-      
+        return token.value.i;
+
+      case tt_hexColor:
+        return (i32)token.value.u;
+
       default:
         return 0;
     }
@@ -118,156 +127,571 @@ static inline
 float tok_asFloat(const Token token) {
     switch (token.type) {
       case tt_float32:
-        return cvt_floatToFloat(token.lexeme.data, token.lexeme.length);
-
       case tt_exp:
-        return cvt_expToFloat(token.lexeme.data, token.lexeme.length);
+        return token.value.f;
 
       default:
         return 0.0f;
     }
 }
 
+// Interned name of an identifier, SYMBOL_NONE for any other token
 static inline
-string_t tok_toString(const Token token) {
-    char buf[128];
+SymbolId tok_symbol(const Token token) {
+    return token.type == tt_identifier ? token.value.u : SYMBOL_NONE;
+}
 
-    const i32 len = snprintf(buf, sizeof(buf),
-        "%s('%.*s')", TokenType_names[token.type], (int)token.lexeme.length, token.lexeme.data);
+// Same identifier: one integer compare, no string compare
+static inline
+bool tok_sameSymbol(const Token a, const Token b) {
+    return a.type == tt_identifier && b.type == tt_identifier && a.value.u == b.value.u;
+}
+
+// Formats a token into `length + 1` bytes from `allocator`, NUL terminated
+static inline
+string_t _tok_format(const char* format, const Token token, const Allocator* allocator) {
+    const char* name = TokenType_names[token.type];
+    const int lexemeLength = (int)token.lexeme.length;
 
-    char* str = memClone(buf, len);
+    const i32 len = snprintf(NULL, 0, format, name, lexemeLength, token.lexeme.data);
+    char* str = len >= 0 ? memAlloc(allocator, (usize)len + 1) : NULL;
+    if (!str) return string_null;
 
+    snprintf(str, (usize)len + 1, format, name, lexemeLength, token.lexeme.data);
     return (string_t){ .data = str, .length = (u32)len };
 }
 
+#define _TOK_FORMAT "%s('%.*s')"
+#define _TOK_FORMAT_COLORED "\x1B[34m%s\x1B[36m(\x1B[32m'%.*s'\x1B[36m)\x1B[0m"
+
 static inline
-string_t tok_toStringColord(const Token token) {
-    char buf[128];
+string_t tok_toStringWith(const Token token, const Allocator* allocator) {
+    return _tok_format(_TOK_FORMAT, token, allocator);
+}
 
-    const i32 len = snprintf(buf, sizeof(buf),
-        "\x1B[34m%s\x1B[36m(\x1B[32m'%.*s'\x1B[36m)\x1B[0m",
-        TokenType_names[token.type], (int)token.lexeme.length, token.lexeme.data);
+static inline
+string_t tok_toStringColordWith(const Token token, const Allocator* allocator) {
+    return _tok_format(_TOK_FORMAT_COLORED, token, allocator);
+}
 
-    char* str = memClone(buf, len);
+static inline
+string_t tok_toString(const Token token) {
+    const Allocator heap = mem_heap;
+    return tok_toStringWith(token, &heap);
+}
 
-    return (string_t){ .data = str, .length = (u32)len };
+static inline
+string_t tok_toStringColord(const Token token) {
+    const Allocator heap = mem_heap;
+    return tok_toStringColordWith(token, &heap);
 }
 
 // =================================================
-// TOKENS LIST
+// TOKEN STORE
 // =================================================
 
-typedef struct TokenList {
-    void* (*alloc)(usize);
-    void (*free)(void*);
-    Token* tokens;
-    usize length;
-    usize capacity;
-} TokenList;
-
-static inline
-TokenList toklist_new(const usize capacity,
-    void* (*allocFn)(usize),
-    void (*freeFn)(void*)) {
-    TokenList tl = {
-        .length = 0,
-        .capacity = capacity,
-        .tokens = NULL,
-        .alloc = allocFn,
-        .free = freeFn,
+// Index of a token in a TokenStore, in source order
+typedef u32 TokenId;
+
+#define TOKSTORE_SEGMENT_BITS 12
+#define TOKSTORE_SEGMENT (1u << TOKSTORE_SEGMENT_BITS)   // Tokens per segment at most
+
+// Every segment but the last holds at least this many tokens, so the ids
+// of one lookup entry span a handful of segments at most
+#define TOKSTORE_SEGMENT_MIN (TOKSTORE_SEGMENT / 4)
+
+// Lengths from here on are kept aside in `longs`
+#define TOKSTORE_LONG 0xFFFFu
+
+// One block of up to TOKSTORE_SEGMENT tokens, a column per field. 11 bytes
+// a token against sizeof(Token) in an array of Token. Starts are relative
+// to the segment's entry in TokenStore.bases.
+typedef struct TokenSegment {
+    u32 count;
+    u32 start[TOKSTORE_SEGMENT];
+    TokenValue value[TOKSTORE_SEGMENT];
+    u16 length[TOKSTORE_SEGMENT];
+    u8 type[TOKSTORE_SEGMENT];
+} TokenSegment;
+
+// Lexeme of TOKSTORE_LONG bytes or more
+typedef struct TokenLongLength {
+    TokenId id;
+    u32 length;
+} TokenLongLength;
+
+/**
+ * Tokens of one source, in segments that never move once allocated:
+ * growing appends a segment, only the small per-segment tables are ever
+ * reallocated. Lexemes are not stored, they are views into `source`
+ * (identifiers into `pool`, like the lexer hands them out).
+ *
+ * Segments are full after a lex, edits leave the ones they touched partly
+ * filled. `firsts` holds the first id of every segment and `lookup` the
+ * segment of every TOKSTORE_SEGMENT-th id, finding a token is a table read
+ * and a step or two at most. An edit rewrites the segments it falls in and
+ * moves the later ones by their entries in `firsts` and `bases` alone.
+ */
+typedef struct TokenStore {
+    Allocator allocator;
+    const char* source;
+    const StringPool* pool;
+
+    TokenSegment** segments;
+    u32* firsts;                // segmentCount + 1 entries, UINT32_MAX last
+    u32* bases;                 // Source offset the starts of a segment add to
+    u32* lookup;                // Segment of id i << TOKSTORE_SEGMENT_BITS, per i
+    u32 segmentCount;
+    u32 segmentCapacity;
+    u32 length;
+
+    TokenLongLength* longs;     // Sorted by id
+    u32 longCount;
+    u32 longCapacity;
+} TokenStore;
+
+// Bytes a store of `count` tokens allocates, segment tables included
+static inline
+usize tokstore_bytesFor(const usize count) {
+    const usize segments = (count + TOKSTORE_SEGMENT - 1) >> TOKSTORE_SEGMENT_BITS;
+    return segments * (sizeof(TokenSegment) + sizeof(TokenSegment*) + 3 * sizeof(u32)) + sizeof(u32);
+}
+
+// Grows the segment tables to hold `count` segments, false if out of memory
+static inline
+bool _tokstore_reserveTables(TokenStore* ts, const u32 count) {
+    if (count <= ts->segmentCapacity) return true;
+
+    u32 capacity = ts->segmentCapacity ? ts->segmentCapacity * 2 : 4;
+    while (capacity < count) capacity *= 2;
+
+    TokenSegment** segments = memResize(&ts->allocator, ts->segments,
+        ts->segmentCapacity * sizeof(TokenSegment*), capacity * sizeof(TokenSegment*));
+    if (!segments) return false;
+    ts->segments = segments;
+
+    u32* firsts = memResize(&ts->allocator, ts->firsts,
+        (ts->segmentCapacity + 1) * sizeof(u32), (capacity + 1) * sizeof(u32));
+    if (!firsts) return false;
+    ts->firsts = firsts;
+
+    u32* bases = memResize(&ts->allocator, ts->bases,
+        ts->segmentCapacity * sizeof(u32), capacity * sizeof(u32));
+    if (!bases) return false;
+    ts->bases = bases;
+
+    u32* lookup = memResize(&ts->allocator, ts->lookup,
+        ts->segmentCapacity * sizeof(u32), capacity * sizeof(u32));
+    if (!lookup) return false;
+    ts->lookup = lookup;
+
+    ts->segmentCapacity = capacity;
+    return true;
+}
+
+// Store with room in its segment tables for `capacity` tokens, no segment
+// is allocated before the first push
+static inline
+TokenStore tokstore_new(const usize capacity, const char* source, const StringPool* pool,
+    const Allocator allocator) {
+    TokenStore ts = {
+        .allocator = allocator,
+        .source = source,
+        .pool = pool,
     };
 
-    tl.tokens = allocFn(capacity * sizeof(Token));
-    return tl;
+    const usize segments = (capacity + TOKSTORE_SEGMENT - 1) >> TOKSTORE_SEGMENT_BITS;
+    if (_tokstore_reserveTables(&ts, segments ? (u32)segments : 1)) ts.firsts[0] = UINT32_MAX;
+
+    return ts;
 }
 
 static inline
-bool toklist_init(TokenList* tl) {
-    tl->tokens = tl->alloc(tl->capacity * sizeof(Token));
-    if (tl->tokens == NULL) return false;
+void tokstore_release(const TokenStore* ts) {
+    for (u32 i = ts->segmentCount; i > 0; i--)
+        memFree(&ts->allocator, ts->segments[i - 1], sizeof(TokenSegment));
+
+    memFree(&ts->allocator, ts->longs, ts->longCapacity * sizeof(TokenLongLength));
+    memFree(&ts->allocator, ts->lookup, ts->segmentCapacity * sizeof(u32));
+    memFree(&ts->allocator, ts->bases, ts->segmentCapacity * sizeof(u32));
+    memFree(&ts->allocator, ts->firsts, (ts->segmentCapacity + 1) * sizeof(u32));
+    memFree(&ts->allocator, ts->segments, ts->segmentCapacity * sizeof(TokenSegment*));
+}
+
+// Index of the segment holding `id`, which must be below `length`
+static inline
+u32 _tokstore_index(const TokenStore* ts, const TokenId id) {
+    u32 index = ts->lookup[id >> TOKSTORE_SEGMENT_BITS];
+    while (id >= ts->firsts[index + 1]) index++;
+    return index;
+}
 
-    tl->length = 0;
+// Appends an empty segment whose first token is the next id, false if
+// out of memory
+static inline
+bool _tokstore_grow(TokenStore* ts, const u32 base) {
+    if (!_tokstore_reserveTables(ts, ts->segmentCount + 1)) return false;
+
+    TokenSegment* segment = memAlloc(&ts->allocator, sizeof(TokenSegment));
+    if (!segment) return false;
+
+    segment->count = 0;
+
+    ts->segments[ts->segmentCount] = segment;
+    ts->bases[ts->segmentCount] = base;
+    ts->firsts[ts->segmentCount] = ts->length;
+    ts->firsts[++ts->segmentCount] = UINT32_MAX;
     return true;
 }
 
+// Long length table size that holds `count`, doubling from `capacity`
 static inline
-void toklist_release(const TokenList* tl) {
-    tl->free(tl->tokens);
+u32 _tokstore_longCapacity(const u32 capacity, const u32 count) {
+    u32 grown = capacity ? capacity * 2 : 8;
+    while (grown < count) grown *= 2;
+    return grown;
 }
 
+// Bytes tokstore_reserveLongs allocates for `count` long lengths up front
 static inline
-bool _toklist_setCapacity(TokenList* tl, const usize capacity) {
-    Token* tokens = tl->alloc(capacity * sizeof(Token));
-    if (!tokens) {
-        fprintf(stderr, "TokenList Error: Memory allocation failed during reallocation.\n");
-        return true;  // Return true on failure for easier checking
+usize tokstore_longBytesFor(const u32 count) {
+    return count ? _tokstore_longCapacity(0, count) * sizeof(TokenLongLength) : 0;
+}
+
+// Room for `count` long lengths. A source of n bytes holds at most
+// n / TOKSTORE_LONG of them, reserving that once avoids regrowth
+static inline
+bool tokstore_reserveLongs(TokenStore* ts, const u32 count) {
+    if (count <= ts->longCapacity) return true;
+
+    const u32 capacity = _tokstore_longCapacity(ts->longCapacity, count);
+
+    TokenLongLength* longs = memResize(&ts->allocator, ts->longs,
+        ts->longCapacity * sizeof(TokenLongLength), capacity * sizeof(TokenLongLength));
+    if (!longs) return false;
+
+    ts->longs = longs;
+    ts->longCapacity = capacity;
+    return true;
+}
+
+// Writes the columns of `slot`, its long length (if any) is the caller's
+static inline
+void _tokstore_write(TokenSegment* segment, const u32 base, const u32 slot, const Token tok) {
+    const u32 length = tok.lexeme.length;
+
+    segment->start[slot] = tok.start - base;
+    segment->value[slot] = tok.value;
+    segment->length[slot] = (u16)(length < TOKSTORE_LONG ? length : TOKSTORE_LONG);
+    segment->type[slot] = (u8)tok.type;
+}
+
+// Appends `tok` as the next id, false if out of memory
+static inline
+bool tokstore_push(TokenStore* ts, const Token tok) {
+    const TokenId id = ts->length;
+    if ((ts->segmentCount == 0 || ts->segments[ts->segmentCount - 1]->count == TOKSTORE_SEGMENT)
+        && !_tokstore_grow(ts, tok.start))
+        return false;
+
+    if (tok.lexeme.length >= TOKSTORE_LONG) {
+        if (!tokstore_reserveLongs(ts, ts->longCount + 1)) return false;
+        ts->longs[ts->longCount++] = (TokenLongLength) { .id = id, .length = tok.lexeme.length };
     }
 
-    const usize cpylen = tl->length > capacity ? capacity : tl->length;
-    memCopy(tokens, tl->tokens, cpylen * sizeof(Token));
-    tl->free(tl->tokens);
+    const u32 index = ts->segmentCount - 1;
+    TokenSegment* segment = ts->segments[index];
+    if ((id & (TOKSTORE_SEGMENT - 1)) == 0) ts->lookup[id >> TOKSTORE_SEGMENT_BITS] = index;
 
-    tl->tokens = tokens;
-    tl->capacity = capacity;
-    tl->length = cpylen;  // Ensure length doesn't exceed new capacity
-    return false;  // Return false on success
+    _tokstore_write(segment, ts->bases[index], segment->count++, tok);
+    ts->length++;
+    return true;
 }
 
+// Type of token `id`, tt_invalid past the end
 static inline
-bool _toklist_tryGrow(TokenList* tl) {
-    if ((float)tl->length <= (float)tl->capacity * 0.90f) return false;
+TokenType tokstore_type(const TokenStore* ts, const TokenId id) {
+    if (id >= ts->length) return tt_invalid;
 
-    const usize new_capacity = (usize)((float)tl->capacity * 1.75f);
-    return _toklist_setCapacity(tl, new_capacity);  // returns true on failure
+    const u32 index = _tokstore_index(ts, id);
+    return (TokenType)ts->segments[index]->type[id - ts->firsts[index]];
 }
 
 static inline
-bool _toklist_tryShrink(TokenList* tl) {
-    if ((float)tl->length >= (float)tl->capacity * 0.25f) return false;
+u32 tokstore_start(const TokenStore* ts, const TokenId id) {
+    const u32 index = _tokstore_index(ts, id);
+    return ts->bases[index] + ts->segments[index]->start[id - ts->firsts[index]];
+}
 
-    const usize new_capacity = (usize)((float)tl->capacity * 0.50f);
-    return _toklist_setCapacity(tl, new_capacity);  // returns true on failure
+static inline
+u32 tokstore_length(const TokenStore* ts, const TokenId id) {
+    const u32 index = _tokstore_index(ts, id);
+    const u32 length = ts->segments[index]->length[id - ts->firsts[index]];
+    if (length != TOKSTORE_LONG) return length;
+
+    // Binary search, `longs` is appended in id order
+    u32 lo = 0, hi = ts->longCount;
+    while (lo < hi) {
+        const u32 mid = (lo + hi) >> 1;
+        if (ts->longs[mid].id < id) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return ts->longs[lo].length;
 }
 
 static inline
-Token* toklist_at(const TokenList* tl, const usize index) {
-    if (tl->tokens == NULL || index >= tl->length) return NULL;
-    return &tl->tokens[index];  // Return pointer to element
+TokenValue tokstore_value(const TokenStore* ts, const TokenId id) {
+    const u32 index = _tokstore_index(ts, id);
+    return ts->segments[index]->value[id - ts->firsts[index]];
 }
 
+// Interned name of identifier `id`, SYMBOL_NONE for any other token
 static inline
-bool toklist_set(const TokenList* tl, const usize index, const Token tok) {
-    if (tl->tokens == NULL || index >= tl->length) return false;
+SymbolId tokstore_symbol(const TokenStore* ts, const TokenId id) {
+    return tokstore_type(ts, id) == tt_identifier ? tokstore_value(ts, id).u : SYMBOL_NONE;
+}
+
+// Whole token `id` as the lexer produced it, INVALID_TOKEN past the end
+static inline
+Token tokstore_at(const TokenStore* ts, const TokenId id) {
+    if (id >= ts->length) return INVALID_TOKEN;
+
+    const u32 index = _tokstore_index(ts, id);
+    const TokenSegment* segment = ts->segments[index];
+    const u32 slot = id - ts->firsts[index];
+
+    Token tok = {
+        .start = ts->bases[index] + segment->start[slot],
+        .type = (TokenType)segment->type[slot],
+        .value = segment->value[slot],
+    };
+
+    if (tok.type == tt_identifier) tok.lexeme = strPool_get(ts->pool, tok.value.u);
+    else if (tok.type == tt_eof) tok.lexeme = str_null;
+    else tok.lexeme = str_new(ts->source + tok.start, tokstore_length(ts, id));
+
+    return tok;
+}
 
-    tl->tokens[index] = tok;
+// First id whose token starts at or after `offset`, `length` if none
+static inline
+TokenId tokstore_find(const TokenStore* ts, const u32 offset) {
+    TokenId lo = 0, hi = ts->length;
+    while (lo < hi) {
+        const TokenId mid = lo + ((hi - lo) >> 1);
+        if (tokstore_start(ts, mid) < offset) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+// Long lengths of a splice: drops the removed ids, renumbers the later
+// ones and adds the new ones. False, with nothing changed, if out of memory
+static inline
+bool _tokstore_spliceLongs(TokenStore* ts, const TokenId first, const u32 removed,
+    const Token* tokens, const u32 inserted) {
+    u32 longs = 0;
+    for (u32 i = 0; i < inserted; i++) longs += tokens[i].lexeme.length >= TOKSTORE_LONG;
+
+    u32 lo = 0;
+    while (lo < ts->longCount && ts->longs[lo].id < first) lo++;
+    u32 hi = lo;
+    while (hi < ts->longCount && ts->longs[hi].id < first + removed) hi++;
+
+    if (longs == 0 && hi == ts->longCount) {
+        ts->longCount = lo;
+        return true;
+    }
+
+    if (!tokstore_reserveLongs(ts, ts->longCount - (hi - lo) + longs)) return false;
+
+    const u32 moved = ts->longCount - hi;
+    memMove(&ts->longs[lo + longs], &ts->longs[hi], moved * sizeof(TokenLongLength));
+    for (u32 i = 0; i < moved; i++) ts->longs[lo + longs + i].id += inserted - removed;
+
+    for (u32 i = 0, k = lo; i < inserted; i++)
+        if (tokens[i].lexeme.length >= TOKSTORE_LONG)
+            ts->longs[k++] = (TokenLongLength) { .id = first + i, .length = tokens[i].lexeme.length };
+
+    ts->longCount = lo + longs + moved;
     return true;
 }
 
+// Recomputes `lookup` from the entry holding id `from` on, `index` being
+// a segment at or after the one holding it
 static inline
-void toklist_clear(TokenList* tl) {
-    if (tl->tokens) {
-        tl->free(tl->tokens);
-        tl->tokens = NULL;
-        tl->length = 0;
-        tl->capacity = 0;
+void _tokstore_relookup(const TokenStore* ts, const TokenId from, u32 index) {
+    u32 chunk = from >> TOKSTORE_SEGMENT_BITS;
+    while (index > 0 && ts->firsts[index] > chunk << TOKSTORE_SEGMENT_BITS) index--;
+
+    for (; ((usize)chunk << TOKSTORE_SEGMENT_BITS) < ts->length; chunk++) {
+        while (ts->firsts[index + 1] <= chunk << TOKSTORE_SEGMENT_BITS) index++;
+        ts->lookup[chunk] = index;
     }
 }
 
+// A token as tokstore_splice carries it between segments, start absolute
+typedef struct _TokenRow {
+    u32 start;
+    TokenValue value;
+    u16 length;
+    u8 type;
+} _TokenRow;
+
+// Appends the rows of `count` tokens from `slot` of segment `index`
+static inline
+_TokenRow* _tokstore_rows(_TokenRow* rows, const TokenStore* ts, const u32 index,
+    const u32 slot, const u32 count) {
+    const TokenSegment* segment = ts->segments[index];
+    const u32 base = ts->bases[index];
+
+    for (u32 i = slot; i < slot + count; i++)
+        *rows++ = (_TokenRow) { base + segment->start[i], segment->value[i], segment->length[i], segment->type[i] };
+
+    return rows;
+}
+
+/**
+ * Replaces the `removed` tokens from id `first` with `inserted` tokens.
+ * Later tokens keep their order, their ids move by inserted - removed.
+ *
+ * Only the segments holding the splice are rewritten. When the result fits
+ * the segment it falls in, its tail moves inside that segment. Otherwise the
+ * tokens of the segments it spans, before and after it, and the new ones
+ * are spread evenly over as many segments as they need, taking in the next
+ * segment while they would fall below TOKSTORE_SEGMENT_MIN. Tokens of later
+ * segments are not touched, only the table entries of those segments move.
+ */
 static inline
-bool toklist_push(TokenList* tl, const Token tok) {
-    if (tl->tokens == NULL) return false;
-    if (_toklist_tryGrow(tl)) return false;  // true on failure
+bool tokstore_splice(TokenStore* ts, const TokenId first, const u32 removed,
+    const Token* tokens, const u32 inserted) {
+    // At the end nothing is rewritten
+    if (first == ts->length && removed == 0) {
+        for (u32 i = 0; i < inserted; i++)
+            if (!tokstore_push(ts, tokens[i])) return false;
+        return true;
+    }
+
+    const TokenId last = first + removed;   // First token kept after the splice
+    const u32 lo = _tokstore_index(ts, first);
+    u32 hi = last < ts->length ? _tokstore_index(ts, last) : ts->segmentCount - 1;
+
+    const TokenId firstLo = ts->firsts[lo];
+    const u32 before = first - firstLo;
+    u32 after = ts->firsts[hi] + ts->segments[hi]->count - last;
+
+    if (lo == hi && before + inserted + after <= TOKSTORE_SEGMENT
+        && (before + inserted + after >= TOKSTORE_SEGMENT_MIN || hi + 1 == ts->segmentCount)) {
+        if (!_tokstore_spliceLongs(ts, first, removed, tokens, inserted)) return false;
+
+        TokenSegment* segment = ts->segments[lo];
+        const u32 from = before + removed, to = before + inserted;
+
+        memMove(&segment->start[to], &segment->start[from], after * sizeof(u32));
+        memMove(&segment->value[to], &segment->value[from], after * sizeof(TokenValue));
+        memMove(&segment->length[to], &segment->length[from], after * sizeof(u16));
+        memMove(&segment->type[to], &segment->type[from], after);
+
+        for (u32 i = 0; i < inserted; i++) _tokstore_write(segment, ts->bases[lo], before + i, tokens[i]);
+        segment->count = to + after;
+    } else {
+        while (before + inserted + after < TOKSTORE_SEGMENT_MIN && hi + 1 < ts->segmentCount)
+            after += ts->segments[++hi]->count;
+
+        const u32 total = before + inserted + after;
+        const u32 old = hi - lo + 1;
+        const u32 made = (total + TOKSTORE_SEGMENT - 1) >> TOKSTORE_SEGMENT_BITS;
+        const u32 count = ts->segmentCount - old + made;
+
+        // Everything that can fail comes first, the store is left as it was
+        const Allocator heap = mem_heap;
+        TokenSegment** placed = memAlloc(&heap, (made + 1) * sizeof(TokenSegment*));
+        _TokenRow* rows = memAlloc(&heap, (total + 1) * sizeof(_TokenRow));
+        u32 allocated = 0;
+
+        bool ok = placed && rows && _tokstore_reserveTables(ts, count);
+        for (u32 i = 0; ok && i < made; i++) {
+            placed[i] = i < old ? ts->segments[lo + i] : memAlloc(&ts->allocator, sizeof(TokenSegment));
+            ok = placed[i] != NULL;
+            allocated += ok && i >= old;
+        }
+        ok = ok && _tokstore_spliceLongs(ts, first, removed, tokens, inserted);
+
+        if (!ok) {
+            for (u32 i = 0; i < allocated; i++) memFree(&ts->allocator, placed[old + i], sizeof(TokenSegment));
+            memFree(&heap, rows, (total + 1) * sizeof(_TokenRow));
+            memFree(&heap, placed, (made + 1) * sizeof(TokenSegment*));
+            return false;
+        }
+
+        // Every token of the rewritten segments in order, the new ones in between
+        _TokenRow* row = _tokstore_rows(rows, ts, lo, 0, before);
+        for (u32 i = 0; i < inserted; i++) {
+            const u32 length = tokens[i].lexeme.length;
+            *row++ = (_TokenRow) { tokens[i].start, tokens[i].value,
+                (u16)(length < TOKSTORE_LONG ? length : TOKSTORE_LONG), (u8)tokens[i].type };
+        }
+        for (u32 i = lo; i <= hi; i++) {
+            const u32 from = ts->firsts[i] > last ? ts->firsts[i] : last;
+            const u32 end = ts->firsts[i] + ts->segments[i]->count;
+            if (end > from) row = _tokstore_rows(row, ts, i, from - ts->firsts[i], end - from);
+        }
+
+        for (u32 i = made; i < old; i++) memFree(&ts->allocator, ts->segments[lo + i], sizeof(TokenSegment));
+
+        // The segments past the splice keep their tokens, their entries move
+        const u32 tail = ts->segmentCount - hi - 1;
+        memMove(&ts->segments[lo + made], &ts->segments[hi + 1], tail * sizeof(TokenSegment*));
+        memMove(&ts->firsts[lo + made], &ts->firsts[hi + 1], (tail + 1) * sizeof(u32));
+        memMove(&ts->bases[lo + made], &ts->bases[hi + 1], tail * sizeof(u32));
+        ts->segmentCount = count;
+
+        for (u32 i = 0, taken = 0; i < made; i++) {
+            TokenSegment* segment = placed[i];
+            const u32 fill = total / made + (i < total % made);
+            const u32 base = rows[taken].start;
+
+            for (u32 k = 0; k < fill; k++) {
+                const _TokenRow r = rows[taken + k];
+                segment->start[k] = r.start - base;
+                segment->value[k] = r.value;
+                segment->length[k] = r.length;
+                segment->type[k] = r.type;
+            }
+            segment->count = fill;
+
+            ts->segments[lo + i] = segment;
+            ts->bases[lo + i] = base;
+            ts->firsts[lo + i] = firstLo + taken;
+            taken += fill;
+        }
+
+        memFree(&heap, rows, (total + 1) * sizeof(_TokenRow));
+        memFree(&heap, placed, (made + 1) * sizeof(TokenSegment*));
+
+        hi = lo + made - 1;
+    }
+
+    // Ids of the later segments move, the UINT32_MAX past the last stays
+    for (u32 i = hi + 1; i < ts->segmentCount; i++) ts->firsts[i] += inserted - removed;
+
+    ts->length = ts->length - removed + inserted;
+    if (ts->length) _tokstore_relookup(ts, firstLo, lo < ts->segmentCount ? lo : ts->segmentCount - 1);
 
-    tl->tokens[tl->length++] = tok;
     return true;
 }
 
+// Moves the start of every token from id `first` on by `delta` bytes: the
+// tokens left in its segment one by one, every later segment by its base
 static inline
-Token toklist_pop(TokenList* tl) {
-    if (tl->tokens == NULL || tl->length == 0) return INVALID_TOKEN;
+void tokstore_shift(const TokenStore* ts, const TokenId first, const i32 delta) {
+    if (delta == 0 || first >= ts->length) return;
 
-    tl->length--;  // decrement before accessing
-    const Token tok = tl->tokens[tl->length];
-    _toklist_tryShrink(tl);
-    return tok;
-}
\ No newline at end of file
+    const u32 index = _tokstore_index(ts, first);
+    TokenSegment* segment = ts->segments[index];
+
+    for (u32 i = first - ts->firsts[index]; i < segment->count; i++) segment->start[i] += (u32)delta;
+    for (u32 i = index + 1; i < ts->segmentCount; i++) ts->bases[i] += (u32)delta;
+}
@@ -1,39 +1,58 @@
 #include "ast.h"
+#include "nodes-get.h"
+#include "../program/string-pool.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 static inline
 void _ast_tryGrowNodes(AstArena* a) {
     if (a->nodeLength >= a->nodeCapacity) {
+        a->nodes = memResize(&a->allocator, a->nodes,
+            sizeof(AstNode) * a->nodeCapacity, sizeof(AstNode) * a->nodeCapacity * 2);
+        a->positions = memResize(&a->allocator, a->positions,
+            sizeof(u32) * a->nodeCapacity, sizeof(u32) * a->nodeCapacity * 2);
         a->nodeCapacity *= 2;
-        a->nodes = realloc(a->nodes, a->nodeCapacity);
     }
 }
 
 static inline
 void _ast_tryGrowChildren(AstArena* a) {
     if (a->childLength >= a->childCapacity) {
+        a->children = memResize(&a->allocator, a->children,
+            sizeof(u32) * a->childCapacity, sizeof(u32) * a->childCapacity * 2);
         a->childCapacity *= 2;
-        a->children = realloc(a->children, sizeof(u32) * a->childCapacity);
     }
 }
 
 AstArena ast_new(const u32 nodeCapacity, const u32 childCapacity) {
+    return ast_newWith(nodeCapacity, childCapacity, mem_heap);
+}
+
+AstArena ast_newWith(const u32 nodeCapacity, const u32 childCapacity, const Allocator allocator) {
     AstArena a = {
+        .allocator = allocator,
         .nodeCapacity = nodeCapacity,
         .childCapacity = childCapacity,
         .nodes = NULL,
+        .positions = NULL,
         .children = NULL,
+        .root = NODE_NONE,
     };
 
-    a.nodes = malloc(sizeof(AstNode) * nodeCapacity);
-    a.children = malloc(sizeof(u32) * childCapacity);
+    a.nodes = memAlloc(&a.allocator, sizeof(AstNode) * nodeCapacity);
+    a.positions = memAlloc(&a.allocator, sizeof(u32) * nodeCapacity);
+    a.children = memAlloc(&a.allocator, sizeof(u32) * childCapacity);
     return a;
 }
 
 void ast_release(const AstArena* ast) {
-    free(ast->nodes);
-    free(ast->children);
+    memFree(&ast->allocator, ast->nodes, sizeof(AstNode) * ast->nodeCapacity);
+    memFree(&ast->allocator, ast->positions, sizeof(u32) * ast->nodeCapacity);
+    memFree(&ast->allocator, ast->shareTable, sizeof(AstShareSlot) * ast->shareCapacity);
+    memFree(&ast->allocator, ast->shareBound, sizeof(u32) * ast->shareBoundCapacity);
+    memFree(&ast->allocator, ast->shifts, sizeof(u32) * ast->rootCapacity);
+    memFree(&ast->allocator, ast->children, sizeof(u32) * ast->childCapacity);
 }
 
 NodeId ast_addNode(AstArena* a, const NodeKind kind, const u32 startPos) {
@@ -42,12 +61,12 @@ NodeId ast_addNode(AstArena* a, const NodeKind kind, const u32 startPos) {
     const u32 idx = a->nodeLength++;
     AstNode *n = &a->nodes[idx];
 
-    n->kind = kind;
+    n->kind = (u8)kind;
     n->flags = 0;
-    n->firstChild = a->childLength;  // Will be updated
-    n->childLength = 0;
+    n->info = 0;
     n->data = 0;
-    n->sourcePos = startPos;
+    n->firstChild = 0;  // Set with the first child
+    a->positions[idx] = startPos;
 
     return idx;
 }
@@ -56,12 +75,313 @@ void ast_addChild(AstArena *a, const NodeId parentId, const NodeId childId) {
     _ast_tryGrowChildren(a);
 
     AstNode *parent = &a->nodes[parentId];
-    if (parent->childLength == 0) {
+    if (parent->info == 0) {
         parent->firstChild = a->childLength;
     }
 
     a->children[a->childLength++] = childId;
-    parent->childLength++;
+    parent->info++;
+}
+
+// Appends `count` child slots left unset, returns the id of the first
+ChildId ast_reserveChildren(AstArena* a, const u32 count) {
+    while (a->childLength + count > a->childCapacity) {
+        const u32 capacity = a->childCapacity ? a->childCapacity * 2 : 16;
+        a->children = memResize(&a->allocator, a->children,
+            sizeof(u32) * a->childCapacity, sizeof(u32) * capacity);
+        a->childCapacity = capacity;
+    }
+
+    const ChildId first = a->childLength;
+    a->childLength += count;
+    return first;
+}
+
+// Appends `count` children back to back, returns the id of the first
+ChildId ast_addChildren(AstArena* a, const NodeId* ids, const u32 count) {
+    const ChildId first = ast_reserveChildren(a, count);
+    memCopy(&a->children[first], ids, count * sizeof(NodeId));
+    return first;
+}
+
+// Copies every node, position and child slot of `from` to `a` at
+// `nodeBase` and `childBase`, ids rebased to match (inline operands are
+// relative and stay). Room must be there already, lengths are left to the
+// caller: disjoint ranges can be filled from many threads.
+void ast_copyRebased(const AstArena* a, const AstArena* from, const NodeId nodeBase, const ChildId childBase) {
+    AstNode* nodes = &a->nodes[nodeBase];
+    for (u32 i = 0; i < from->nodeLength; i++) {
+        nodes[i] = from->nodes[i];
+        if (node_hasSlots(nodes[i].kind)) nodes[i].firstChild += childBase;
+    }
+
+    memCopy(&a->positions[nodeBase], from->positions, from->nodeLength * sizeof(u32));
+
+    NodeId* children = &a->children[childBase];
+    for (u32 i = 0; i < from->childLength; i++)
+        children[i] = from->children[i] + nodeBase;
+}
+
+// A node whose children are being emitted
+typedef struct AstEmitFrame {
+    NodeId id;
+    u32 next;               // Child to emit next
+} AstEmitFrame;
+
+typedef struct AstEmitter {
+    AstArena* to;
+    const AstArena* from;
+    NodeId* emitted;        // New ids of the nodes whose parent is not made yet
+    u32 emittedLength;
+    u32 shift;              // Of the root declaration being emitted
+    AstEmitFrame* frames;   // The walk's stack, one frame per level
+} AstEmitter;
+
+// Node `id` once its `count` children are emitted. Slots are added when
+// their node is, as the parser does.
+static void _ast_emitNode(AstEmitter* e, const NodeId id, const u32 count) {
+    const NodeId at = ast_addNode(e->to, e->from->nodes[id].kind, e->from->positions[id] + e->shift);
+    AstNode* node = &e->to->nodes[at];
+    *node = e->from->nodes[id];
+
+    e->emittedLength -= count;
+    const NodeId* children = &e->emitted[e->emittedLength];
+
+    if (node_hasSlots(node->kind)) {
+        node->firstChild = ast_addChildren(e->to, children, count);
+    } else if (node->kind == NODE_BINARY) {
+        node->operands[0] = at - children[0];
+        node->operands[1] = at - children[1];
+    } else if (count) {
+        node->operands[1] = at - children[0];
+    }
+
+    e->emitted[e->emittedLength++] = at;
+}
+
+// Children in order, then the node. A shared node is copied for every
+// parent. The walk keeps its own stack: the parser makes left-leaning
+// chains like `1 + 1 + ... + 1` without recursing, as deep as they are long.
+static void _ast_emit(AstEmitter* e, const NodeId decl) {
+    u32 depth = 0;
+    e->frames[depth++] = (AstEmitFrame){ .id = decl };
+
+    while (depth > 0) {
+        AstEmitFrame* frame = &e->frames[depth - 1];
+        const u32 count = ast_getChildCount(e->from, frame->id);
+
+        if (frame->next < count) {
+            const NodeId child = ast_getChildOf(e->from, frame->id, frame->next++);
+            e->frames[depth++] = (AstEmitFrame){ .id = child };
+            continue;
+        }
+
+        depth--;
+        _ast_emitNode(e, frame->id, count);
+    }
+}
+
+/**
+ * Copy of `a` with the nodes before the root being its declarations in
+ * order, each one in post-order, and nothing else: what Parser_parse
+ * makes, and not Parser_reparse or sharing. Nodes no declaration reaches
+ * are dropped, shared ones are copied back into a tree, and the position
+ * shifts of Parser_reparse are applied.
+ *
+ * Such an arena can be evaluated front to back with a value stack, every
+ * node popping ast_getChildCount values and pushing one; the root
+ * declarations' values are left on the stack in order.
+ */
+AstArena ast_linearize(const AstArena* a) {
+    // The tree has every node that was made: the ones kept and the ones
+    // given an existing id
+    const u32 nodes = a->nodeLength + a->shareHits + 1;
+    AstArena to = ast_newWith(nodes, a->childLength + 1, a->allocator);
+    if (a->root == NODE_NONE) return to;
+
+    const Allocator heap = mem_heap;
+    AstEmitter e = {
+        .to = &to,
+        .from = a,
+        .emitted = memAlloc(&heap, nodes * sizeof(NodeId)),
+        .frames = memAlloc(&heap, nodes * sizeof(AstEmitFrame)),
+    };
+    const AstNode* root = &a->nodes[a->root];
+
+    // Leaves the declaration ids in order
+    for (u32 i = 0; i < root->data; i++) {
+        e.shift = a->shifts ? a->shifts[i] : 0;
+        _ast_emit(&e, a->children[root->firstChild + i]);
+    }
+
+    const ChildId decls = ast_addChildren(&to, e.emitted, e.emittedLength);
+    const NodeId id = ast_addNode(&to, NODE_ROOT, a->positions[a->root]);
+    to.nodes[id].data = root->data;
+    to.nodes[id].firstChild = decls;
+    to.root = id;
+    to.postOrder = true;
+
+    memFree(&heap, e.frames, nodes * sizeof(AstEmitFrame));
+    memFree(&heap, e.emitted, nodes * sizeof(NodeId));
+    return to;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// SHARING
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Nodes that only depend on their operands. Declarations bind a name, the
+// root is one of a kind, and a call off the pure list (or anything above
+// one) may give another value each time.
+static inline
+bool _ast_isPure(const AstNode* n) {
+    return n->kind != NODE_ROOT && n->kind != NODE_DECL && n->kind != NODE_ASSIGN
+        && !(n->flags & NODE_FLAG_IMPURE);
+}
+
+// For `$name` and identifiers: one past the newest declaration of the
+// name, nodes older than that read another binding. 0 for other kinds.
+static inline
+NodeId _ast_boundOf(const AstArena* a, const AstNode* n) {
+    if (n->kind != NODE_ACCESS && n->kind != NODE_IDENT) return 0;
+    return n->data < a->shareBoundCapacity ? a->shareBound[n->data] : 0;
+}
+
+// The pool's wyhash over kind, flags, info, data and absolute child ids
+// (slots hashed first): the same for equal subtrees wherever they are.
+// Reads of a name hash its binding too, older ones are not probed past.
+static u32 _ast_hashNode(const AstArena* a, const NodeId id) {
+    const AstNode* n = &a->nodes[id];
+    u32 key[3] = { n->kind | (u32)n->flags << 8 | (u32)n->info << 16, 0, 0 };
+
+    if (node_hasSlots(n->kind)) {
+        key[1] = n->data;
+        key[2] = strPool_hash((const char*)&a->children[n->firstChild], n->info * (u32)sizeof(NodeId));
+    } else if (n->kind == NODE_BINARY) {
+        key[1] = id - n->operands[0];
+        key[2] = id - n->operands[1];
+    } else if (n->kind == NODE_UNARY) {
+        key[2] = id - n->operands[1];
+    } else {
+        key[1] = n->data;
+        key[2] = _ast_boundOf(a, n);
+    }
+
+    return strPool_hash((const char*)key, sizeof(key));
+}
+
+static bool _ast_sameNode(const AstArena* a, const NodeId x, const NodeId y) {
+    const AstNode* n = &a->nodes[x];
+    const AstNode* m = &a->nodes[y];
+
+    if (n->kind != m->kind || n->flags != m->flags || n->info != m->info) return false;
+
+    if (node_hasSlots(n->kind))
+        return n->data == m->data && memcmp(&a->children[n->firstChild],
+            &a->children[m->firstChild], n->info * sizeof(NodeId)) == 0;
+    if (n->kind == NODE_BINARY)
+        return x - n->operands[0] == y - m->operands[0] && x - n->operands[1] == y - m->operands[1];
+    if (n->kind == NODE_UNARY)
+        return x - n->operands[1] == y - m->operands[1];
+    return n->data == m->data;
+}
+
+/**
+ * Turns on hash-consing for the nodes made from now on: structurally equal
+ * pure subtrees (literals, identifiers, `$` access, operators, ternaries,
+ * calls to the pure builtins) get one NodeId and the arena becomes a DAG.
+ * Declarations, the root and anything holding an impure call are never
+ * shared. Names can be declared again, inline ones too, so `$name` and
+ * identifiers are only shared between nodes no declaration of the name
+ * was made in between (ast_shareBind).
+ *
+ * Operands still come before their parent, so a forward scan that keeps a
+ * value per node evaluates every shared subtree once. A shared node keeps
+ * the source position of its first occurrence, and the arena is no longer
+ * in post-order once anything was shared (ast_linearize makes a tree of it
+ * again). The table has `capacity` slots (any count, the hash is scaled to
+ * it) and never grows: once it is 7/8 full new nodes are kept, not shared.
+ * Declarations of names below `names` are noted without growing.
+ */
+bool ast_enableSharing(AstArena* a, const u32 capacity, const u32 names) {
+    a->shareTable = memAlloc(&a->allocator, capacity * sizeof(AstShareSlot));
+    a->shareBound = memAlloc(&a->allocator, names * sizeof(u32));
+    if (!a->shareTable || !a->shareBound) {
+        memFree(&a->allocator, a->shareBound, names * sizeof(u32));
+        memFree(&a->allocator, a->shareTable, capacity * sizeof(AstShareSlot));
+        a->shareTable = NULL;
+        a->shareBound = NULL;
+        return false;
+    }
+
+    memSet(a->shareTable, 0xFF, capacity * sizeof(AstShareSlot));
+    memSet(a->shareBound, 0, names * sizeof(u32));
+    a->shareBoundCapacity = names;
+    a->shareCapacity = capacity;
+    a->shareLength = 0;
+    a->shareHits = 0;
+    return true;
+}
+
+// `id` must be the newest node, its slots the newest slots
+NodeId ast_shareNode(AstArena* a, const NodeId id) {
+    const AstNode* n = &a->nodes[id];
+    if (!_ast_isPure(n)) return id;
+
+    const u32 hash = _ast_hashNode(a, id);
+    u32 slot = (u32)((u64)hash * a->shareCapacity >> 32);
+
+    // A name read before its newest declaration may have had another value.
+    // Nodes above one hold a new id then, so they cannot match older ones.
+    const NodeId bound = _ast_boundOf(a, n);
+
+    // Entries past `id` were dropped with a broken declaration, older ones
+    // may have been made again since: only the node they hold now counts
+    for (const AstShareSlot* s; (s = &a->shareTable[slot])->id != NODE_NONE; ) {
+        if (s->hash == hash && s->id < id && s->id >= bound && _ast_sameNode(a, s->id, id)) {
+            if (node_hasSlots(n->kind)) a->childLength = n->firstChild;
+            a->nodeLength--;
+            a->shareHits++;
+            return s->id;
+        }
+
+        if (++slot == a->shareCapacity) slot = 0;
+    }
+
+    // Probes get long past 7/8, and one free slot always ends them
+    if (a->shareLength >= a->shareCapacity - a->shareCapacity / 8) return id;
+
+    a->shareTable[slot] = (AstShareSlot){ .hash = hash, .id = id };
+    a->shareLength++;
+    return id;
+}
+
+/**
+ * Notes that declaration `decl` binds `name`: `$name` and identifiers made
+ * from now on are not shared with older ones. When the bound table cannot
+ * grow, the share table is emptied instead, nothing older is found then.
+ */
+void ast_shareBind(AstArena* a, const u32 name, const NodeId decl) {
+    if (name == SYMBOL_NONE) return;
+
+    if (name >= a->shareBoundCapacity) {
+        u32 capacity = a->shareBoundCapacity ? a->shareBoundCapacity : 64;
+        while (capacity <= name) capacity *= 2;
+
+        u32* bound = memResize(&a->allocator, a->shareBound,
+            a->shareBoundCapacity * sizeof(u32), capacity * sizeof(u32));
+        if (!bound) {
+            memSet(a->shareTable, 0xFF, a->shareCapacity * sizeof(AstShareSlot));
+            a->shareLength = 0;
+            return;
+        }
+
+        memSet(bound + a->shareBoundCapacity, 0, (capacity - a->shareBoundCapacity) * sizeof(u32));
+        a->shareBound = bound;
+        a->shareBoundCapacity = capacity;
+    }
+
+    a->shareBound[name] = decl + 1;
 }
 
 AstNode* ast_getNode(const AstArena *a, const NodeId id) {
@@ -7,40 +7,47 @@
 #pragma once
 
 #include "../utils/short-types.h"
+#include "../utils/memory.h"
 
 // TODO: define ast nodes flags
 #define NODE_FLAG_CONST     (1u << 0)
 #define NODE_FLAG_NULL      (1u << 1)
+#define NODE_FLAG_IMPURE    (1u << 2)   // Is or holds a call off the pure list, never shared
 
 typedef enum NodeKind NodeKind;
 typedef enum OpCode OpCode;
 typedef struct AstNode AstNode;
 typedef struct AstArena AstArena;
+typedef struct AstShareSlot AstShareSlot;
 
 typedef u32 NodeId;
 typedef u32 ChildId;
 
-// Node types
+// No node: failed parse, child index out of range
+#define NODE_NONE UINT32_MAX
+
+// Node types, `data` and children per kind
 enum NodeKind {
-    NODE_ROOT,          // Program root
-    NODE_DECL,          // Variable declaration
+    NODE_ROOT,          // Program root: data = declaration count, children in slots
+    NODE_DECL,          // Declaration, inline ones too: data = name SymbolId (SYMBOL_NONE if unnamed), operand = value
 
-    NODE_IDENT,         // Identifier
-    NODE_LIT_INT,       // Integers
-    NODE_LIT_FLOAT,     // Floats
+    NODE_IDENT,         // Identifier literal: data = SymbolId
+    NODE_LIT_INT,       // Integers and hex colors: data = value
+    NODE_LIT_FLOAT,     // Floats: data = f32 bits
     NODE_LIT_BOOL,      // Booleans
 
-    NODE_UNARY,         // -x, !x
-    NODE_BINARY,        // + - * / % /% ** & && | || ^ ^^ etc
-    NODE_TERNARY,       // ... ? ... : ...
-    NODE_CALL,          // Function call
-    NODE_ACCESS,        // Variable access
+    NODE_UNARY,         // -x, !x, +x, ~x: info = OpCode, operand
+    NODE_BINARY,        // + - * / % /% ** & && | || ^ ^^ ?? !! etc: info = OpCode, operands = left, right
+    NODE_TERNARY,       // ... ? ... : ...: condition, then, else in slots
+    NODE_CALL,          // Function call: data = callee SymbolId, arguments in slots
+    NODE_ACCESS,        // Variable access ($name): data = SymbolId
     NODE_ASSIGN,        // Assignment
 };
 
 enum OpCode {
     // Unary
     OP_NEG, OP_NOT,
+    OP_POS, OP_BNOT,
 
     // Binary
     OP_ADD, OP_SUB,
@@ -55,24 +62,56 @@ enum OpCode {
     OP_LAND, OP_LOR,
     OP_SHL, OP_SHR,
     OP_ROL, OP_ROR,
+    OP_MOD, OP_IDIV,
+    OP_POW,
+    OP_COALESCE, OP_GUARD,
 };
 
+// 12 bytes. Unary, binary and declaration nodes hold their operands as
+// the distance back to them (operands are made first), the last or only
+// one in operands[1]. Roots, ternaries and calls list theirs in `children`.
 struct AstNode {
-    u16 kind;           // 2 bytes
-    u16 flags;          // 2 bytes (constant, used, etc.)
-    ChildId firstChild; // Index into children array
-    u8 childLength;     // Size of node children
-    u32 data;           // Integer literal or string index
-    u32 sourcePos;      // For error reporting
+    u8 kind;                    // NodeKind
+    u8 flags;                   // Constant, used, etc.
+    u16 info;                   // OpCode, or child count in slots (not the root)
+    union {
+        struct {
+            u32 data;           // Integer literal or SymbolId (identifiers)
+            ChildId firstChild; // Index into children array
+        };
+        u32 operands[2];        // Node id minus operand id
+    };
 };
 
 struct AstArena {
+    Allocator allocator;    // Where nodes, positions and children live
     AstNode* nodes;         // Flat array of nodes
+    u32* positions;         // Source offset per node, for errors and re-parse
     NodeId* children;       // Child id's
     u32 nodeCapacity;
     u32 nodeLength;
     u32 childCapacity;
     u32 childLength;
+    NodeId root;            // NODE_ROOT of the program, NODE_NONE until parsed
+    bool postOrder;         // Nodes before the root are the declarations in order, see ast_linearize
+
+    // Hash-consing, NULL table when off (ast_enableSharing)
+    AstShareSlot* shareTable; // Node ids by structure, open addressing
+    u32 shareCapacity;      // Sized once from the plan, never grows
+    u32 shareLength;
+    u32 shareHits;          // Nodes that were made and given an existing id instead
+    u32* shareBound;        // Per name SymbolId: one past its newest declaration, 0 if none
+    u32 shareBoundCapacity;
+
+    // Re-parse (Parser_reparse), NULL table until the first one
+    u32* shifts;            // Per root declaration: bytes to add to the positions of its nodes
+    u32 rootCapacity;       // Slots from the root's firstChild, and shifts, it can grow into
+};
+
+// A share table entry: the hash is compared before the node is
+struct AstShareSlot {
+    u32 hash;
+    NodeId id;              // NODE_NONE when free
 };
 
 #define AstNode_NULL (AstNode){ .flags = NODE_FLAG_NULL }
@@ -82,11 +121,36 @@ bool node_isNull(const AstNode* node) {
     return node->flags == NODE_FLAG_NULL;
 }
 
+// Most arguments a call holds, its child count is `info`
+#define AST_MAX_ARGS 0xFFFFu
+
+// Children in `children` from firstChild, the other kinds keep them inline
+static inline
+bool node_hasSlots(const u8 kind) {
+    return kind == NODE_ROOT || kind == NODE_TERNARY || kind == NODE_CALL;
+}
+
 AstArena ast_new(u32 nodeCapacity, u32 childCapacity);
+AstArena ast_newWith(u32 nodeCapacity, u32 childCapacity, Allocator allocator);
 void ast_release(const AstArena* ast);
 
 u32 ast_addNode(AstArena* a, NodeKind kind, u32 startPos);
 void ast_addChild(AstArena *a, NodeId parentId, NodeId childId);
+ChildId ast_reserveChildren(AstArena* a, u32 count);
+ChildId ast_addChildren(AstArena* a, const NodeId* ids, u32 count);
+void ast_copyRebased(const AstArena* a, const AstArena* from, NodeId nodeBase, ChildId childBase);
+AstArena ast_linearize(const AstArena* a);
+
+bool ast_enableSharing(AstArena* a, u32 capacity, u32 names);
+NodeId ast_shareNode(AstArena* a, NodeId id);
+void ast_shareBind(AstArena* a, u32 name, NodeId decl);
+
+// `id`, or an older node with the same structure when sharing is on (the
+// newest node `id` is then dropped). See ast_enableSharing.
+static inline
+NodeId ast_share(AstArena* a, const NodeId id) {
+    return a->shareTable ? ast_shareNode(a, id) : id;
+}
 
 AstNode* ast_getNode(const AstArena *a, NodeId id);
 NodeId ast_getChild(const AstArena *a, ChildId id);
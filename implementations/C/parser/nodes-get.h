@@ -2,28 +2,48 @@
 
 #include "ast.h"
 
-// Get nodes children
-typedef struct {
-    u32* indices;
-    u32 count;
-} AstChildren;
-
+// Get number of children
 static inline
-AstChildren ast_getChildren(const AstArena* arena, const u32 nodeIndex) {
+u32 ast_getChildCount(const AstArena* arena, const u32 nodeIndex) {
     const AstNode* node = &arena->nodes[nodeIndex];
-    const AstChildren children = {
-        .indices = &arena->children[node->firstChild],
-        .count = node->childLength
-    };
-    return children;
+    switch (node->kind) {
+        case NODE_ROOT: return node->data;
+        case NODE_DECL:
+        case NODE_UNARY: return 1;
+        case NODE_BINARY: return 2;
+        default: return node_hasSlots(node->kind) ? node->info : 0;
+    }
 }
 
 // Get child at index
 static inline
-ChildId ast_getChildOf(const AstArena* arena, const u32 nodeIndex, const u32 childIndex) {
+NodeId ast_getChildOf(const AstArena* arena, const u32 nodeIndex, const u32 childIndex) {
     const AstNode* node = &arena->nodes[nodeIndex];
-    if (childIndex >= node->childLength) return (u32)-1;
-    return arena->children[node->firstChild + childIndex];
+    if (childIndex >= ast_getChildCount(arena, nodeIndex)) return NODE_NONE;
+
+    if (node_hasSlots(node->kind)) return arena->children[node->firstChild + childIndex];
+    if (node->kind == NODE_BINARY) return nodeIndex - node->operands[childIndex];
+    return nodeIndex - node->operands[1];
+}
+
+// Get the operator of a unary or binary node
+static inline
+OpCode ast_getOp(const AstArena* arena, const u32 nodeIndex) {
+    return (OpCode)arena->nodes[nodeIndex].info;
+}
+
+// Get where the node starts in the source, as it was parsed. Parser_reparse
+// moves the declarations after an edit as a whole, see ast_getPosIn
+static inline
+u32 ast_getPos(const AstArena* arena, const u32 nodeIndex) {
+    return arena->positions[nodeIndex];
+}
+
+// Get where a node of the root's declaration `decl` (its index among the
+// root's children) starts in the source, re-parses included
+static inline
+u32 ast_getPosIn(const AstArena* arena, const u32 decl, const u32 nodeIndex) {
+    return arena->positions[nodeIndex] + (arena->shifts ? arena->shifts[decl] : 0);
 }
 
 // Get node kind
@@ -2,14 +2,27 @@
 
 #include "ast.h"
 
+// Every node but the root and declarations goes through ast_share: with
+// sharing on, an equal older node may be returned instead. Operators,
+// ternaries and calls take NODE_FLAG_IMPURE over from their operands, and
+// declarations tell the share table their name was bound again.
+
+// NODE_FLAG_IMPURE when node `id` has it
+static inline
+u8 _ast_impure(const AstArena* arena, const NodeId id) {
+    return arena->nodes[id].flags & NODE_FLAG_IMPURE;
+}
+
+// Declarations are stored back to back from `firstChild`, `data` holds
+// their count (info is only 16 bits wide)
 static inline
 NodeId ast_makeRoot(AstArena* arena, const u32* decls, const u32 count, const u32 startPos) {
     const NodeId id = ast_addNode(arena, NODE_ROOT, startPos);
-    arena->nodes[id].data = count;  // Store declaration count
+    const ChildId first = ast_addChildren(arena, decls, count);
 
-    for (u32 i = 0; i < count; i++) {
-        ast_addChild(arena, id, decls[i]);
-    }
+    arena->nodes[id].data = count;  // Store declaration count
+    arena->nodes[id].firstChild = first;
+    arena->root = id;
 
     return id;
 }
@@ -17,18 +30,31 @@ NodeId ast_makeRoot(AstArena* arena, const u32* decls, const u32 count, const u3
 static inline
 NodeId ast_makeDecl(AstArena* arena, const u32 identName, const u32 value, const u32 startPos) {
     const NodeId id = ast_addNode(arena, NODE_DECL, startPos);
+    arena->nodes[id].data = identName;  // Store name SymbolId
+    arena->nodes[id].operands[1] = id - value;
+    if (arena->shareTable) ast_shareBind(arena, identName, id);
+    return id;
+}
 
-    ast_addChild(arena, id, identName);
-    ast_addChild(arena, id, value);
+static inline
+NodeId ast_makeIdent(AstArena* arena, const u32 symbol, const u32 startPos) {
+    const NodeId id = ast_addNode(arena, NODE_IDENT, startPos);
+    arena->nodes[id].data = symbol;  // Store SymbolId
+    return ast_share(arena, id);
+}
 
-    return id;
+static inline
+NodeId ast_makeAccess(AstArena* arena, const u32 symbol, const u32 startPos) {
+    const NodeId id = ast_addNode(arena, NODE_ACCESS, startPos);
+    arena->nodes[id].data = symbol;  // Store SymbolId
+    return ast_share(arena, id);
 }
 
 static inline
 NodeId ast_makeInt(AstArena* arena, const i32 value, const u32 startPos) {
     const NodeId id = ast_addNode(arena, NODE_LIT_INT, startPos);
     arena->nodes[id].data = (u32)value;  // Store integer value directly
-    return id;
+    return ast_share(arena, id);
 }
 
 static inline
@@ -37,25 +63,56 @@ NodeId ast_makeFloat(AstArena* arena, const f32 value, const u32 startPos) {
     // Store float bits in data
     const union { f32 f; u32 u; } converter = { .f = value };
     arena->nodes[id].data = converter.u;
-    return id;
+    return ast_share(arena, id);
 }
 
 static inline
 NodeId ast_makeUnary(AstArena* arena, const OpCode op, const u32 operand, const u32 startPos) {
     const NodeId id = ast_addNode(arena, NODE_UNARY, startPos);
-    arena->nodes[id].data = op;  // Store operator
-
-    ast_addChild(arena, id, operand);
-    return id;
+    arena->nodes[id].info = (u16)op;  // Store operator
+    arena->nodes[id].flags = _ast_impure(arena, operand);
+    arena->nodes[id].operands[1] = id - operand;
+    return ast_share(arena, id);
 }
 
 static inline
 NodeId ast_makeBinary(AstArena* arena, const OpCode op,
         const u32 left, const u32 right, const u32 startPos) {
     const NodeId id = ast_addNode(arena, NODE_BINARY, startPos);
-    arena->nodes[id].data = op;  // Store operator
+    arena->nodes[id].info = (u16)op;  // Store operator
+    arena->nodes[id].flags = _ast_impure(arena, left) | _ast_impure(arena, right);
+    arena->nodes[id].operands[0] = id - left;
+    arena->nodes[id].operands[1] = id - right;
+    return ast_share(arena, id);
+}
 
-    ast_addChild(arena, id, left);
-    ast_addChild(arena, id, right);
-    return id;
+static inline
+NodeId ast_makeTernary(AstArena* arena, const u32 condition,
+        const u32 thenValue, const u32 elseValue, const u32 startPos) {
+    const NodeId id = ast_addNode(arena, NODE_TERNARY, startPos);
+    const NodeId values[3] = { condition, thenValue, elseValue };
+
+    arena->nodes[id].firstChild = ast_addChildren(arena, values, 3);
+    arena->nodes[id].info = 3;
+    arena->nodes[id].flags = _ast_impure(arena, condition)
+        | _ast_impure(arena, thenValue) | _ast_impure(arena, elseValue);
+    return ast_share(arena, id);
+}
+
+// Arguments are copied back to back, at most AST_MAX_ARGS of them.
+// `pure` when the callee gives the same value for the same arguments.
+static inline
+NodeId ast_makeCall(AstArena* arena, const u32 callee, const u32* args, const u32 count,
+        const bool pure, const u32 startPos) {
+    const NodeId id = ast_addNode(arena, NODE_CALL, startPos);
+    const ChildId first = ast_addChildren(arena, args, count);
+    u8 flags = pure ? 0 : NODE_FLAG_IMPURE;
+
+    for (u32 i = 0; i < count; i++) flags |= _ast_impure(arena, args[i]);
+
+    arena->nodes[id].data = callee;  // Store callee SymbolId
+    arena->nodes[id].firstChild = first;
+    arena->nodes[id].info = (u16)count;
+    arena->nodes[id].flags = flags;
+    return ast_share(arena, id);
 }
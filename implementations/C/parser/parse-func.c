@@ -1,20 +1,71 @@
 #pragma once
 
 #include "parser.h"
+#include "nodes-make.h"
 #include <strings.h>
 
+// The eof token closes every stream
 bool _prs_isAtEnd(const Parser* ps) {
-    return ps->position >= ps->tokens.length;
+    if (ps->lexer)
+        return Lexer_peek(ps->lexer, 0).type == tt_eof;
+
+    return ps->position >= ps->tokens.length || tokstore_type(&ps->tokens, ps->position) == tt_eof;
 }
 
 Token _prs_current(const Parser* ps) {
-    return _prs_isAtEnd(ps)
-        ? INVALID_TOKEN : ps->tokens.tokens[ps->position];
+    if (ps->lexer)
+        return Lexer_peek(ps->lexer, 0);
+
+    return tokstore_at(&ps->tokens, ps->position);
 }
 
 Token _prs_peek(const Parser* ps, const u32 offset) {
-    return ps->position + offset >= ps->tokens.length
-        ? INVALID_TOKEN : ps->tokens.tokens[ps->position + offset];
+    if (ps->lexer)
+        return Lexer_peek(ps->lexer, offset);
+
+    return tokstore_at(&ps->tokens, ps->position + offset);
+}
+
+// Type of the current token, read from its column without building a Token
+static inline
+TokenType _prs_currentType(const Parser* ps) {
+    if (ps->lexer)
+        return Lexer_peek(ps->lexer, 0).type;
+
+    return tokstore_type(&ps->tokens, ps->position);
+}
+
+static inline
+TokenType _prs_peekType(const Parser* ps, const u32 offset) {
+    if (ps->lexer)
+        return Lexer_peek(ps->lexer, offset).type;
+
+    return tokstore_type(&ps->tokens, ps->position + offset);
+}
+
+static inline
+u32 _prs_currentStart(const Parser* ps) {
+    if (ps->lexer)
+        return Lexer_peek(ps->lexer, 0).start;
+
+    return tokstore_start(&ps->tokens, ps->position);
+}
+
+static inline
+TokenValue _prs_currentValue(const Parser* ps) {
+    if (ps->lexer)
+        return Lexer_peek(ps->lexer, 0).value;
+
+    return tokstore_value(&ps->tokens, ps->position);
+}
+
+// Consume one token from whichever source the parser reads
+static inline
+void _prs_step(Parser* ps) {
+    if (ps->lexer)
+        Lexer_next(ps->lexer);
+
+    ps->position++;
 }
 
 bool _prs_error(const Parser* ps, const u32 start, const u32 len, const char* msg, ...) {
@@ -29,11 +80,30 @@ bool _prs_error(const Parser* ps, const u32 start, const u32 len, const char* ms
     return reporter_push(ps->program->reporter, err, *ps->program->source);
 }
 
+// One nesting level deeper. Past PARSER_MAX_DEPTH it is reported at the
+// current token and false, every level then unwinds with NODE_NONE.
+static inline
+bool _prs_enter(Parser* ps) {
+    if (ps->depth < PARSER_MAX_DEPTH) {
+        ps->depth++;
+        return true;
+    }
+
+    const Token current = _prs_current(ps);
+    _prs_error(ps, current.start, current.lexeme.length, "Expression nested too deeply");
+    return false;
+}
+
+static inline
+void _prs_leave(Parser* ps) {
+    ps->depth--;
+}
+
 bool _prs_match(Parser* ps, const TokenType type) {
-    if (_prs_current(ps).type != type)
+    if (_prs_currentType(ps) != type)
         return false;
 
-    ps->position++;
+    _prs_step(ps);
     return true;
 }
 
@@ -47,46 +117,371 @@ bool _prs_expect(Parser* ps, const TokenType type, const char* msg, ...) {
 }
 
 bool _prs_is(const Parser* ps, const TokenType type) {
-    return _prs_current(ps).type != type;
+    return _prs_currentType(ps) == type;
 }
 
 Token _prs_advance(Parser* ps) {
     const Token current = _prs_current(ps);
     if (!_prs_isAtEnd(ps))
-        ps->position++;
+        _prs_step(ps);
 
     return current;
 }
 
 Token _prs_skip(Parser* ps, const u32 count) {
     const Token current = _prs_current(ps);
-    if (!_prs_isAtEnd(ps))
-        ps->position += count;
+    for (u32 i = 0; i < count && !_prs_isAtEnd(ps); i++)
+        _prs_step(ps);
 
     return current;
 }
 
-AstNode _prs_expression(Parser* ps);
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// NODE STACK
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Room for `count` more ids on the stack
+static inline
+bool _prs_reserve(Parser* ps, const u32 count) {
+    if (ps->stackLength + count <= ps->stackCapacity) return true;
+
+    const Allocator heap = mem_heap;
+    u32 capacity = ps->stackCapacity ? ps->stackCapacity * 2 : 64;
+    while (capacity < ps->stackLength + count) capacity *= 2;
+
+    NodeId* stack = memResize(&heap, ps->stack, ps->stackCapacity * sizeof(NodeId), capacity * sizeof(NodeId));
+    if (!stack) {
+        fprintf(stderr, "Parser Error: Memory allocation failed during growing.\n");
+        return false;
+    }
+
+    ps->stack = stack;
+    ps->stackCapacity = capacity;
+    return true;
+}
+
+static inline
+bool _prs_push(Parser* ps, const NodeId id) {
+    if (!_prs_reserve(ps, 1)) return false;
+
+    ps->stack[ps->stackLength++] = id;
+    return true;
+}
+
+static inline
+void _prs_releaseStack(Parser* ps) {
+    const Allocator heap = mem_heap;
+    memFree(&heap, ps->stack, ps->stackCapacity * sizeof(NodeId));
+
+    ps->stack = NULL;
+    ps->stackLength = 0;
+    ps->stackCapacity = 0;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// EXPRESSIONS
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Binding power of infix operators, lowest first. Same chain as the
+// recursive descent of the Dart parser:
+// ternary > merge > or > xor > and > equality > comparison > bit or
+// > bit xor > bit and > shift > additive > term > power > unary
+enum {
+    PREC_NONE,
+    PREC_TERNARY,       // ?:  (right)
+    PREC_MERGE,         // ?? !!
+    PREC_OR,            // ||
+    PREC_XOR,           // ^^
+    PREC_AND,           // &&
+    PREC_EQUALITY,      // == != ~== !~= === !==
+    PREC_COMPARISON,    // < > <= >=
+    PREC_BIT_OR,        // |
+    PREC_BIT_XOR,       // ^
+    PREC_BIT_AND,       // &
+    PREC_SHIFT,         // << >> <<< >>>
+    PREC_ADDITIVE,      // + -
+    PREC_TERM,          // * / % /%
+    PREC_POWER,         // **  (right)
+};
 
-AstNode _prs_parseDecl(Parser* ps) {
-    const u32 start = ps->position;
+static const u8 _prs_precedence[tt_eof + 1] = {
+    [tt_question] = PREC_TERNARY,
+    [tt_coalesce] = PREC_MERGE, [tt_guard] = PREC_MERGE,
+    [tt_logicalOr] = PREC_OR,
+    [tt_logicalXor] = PREC_XOR,
+    [tt_logicalAnd] = PREC_AND,
+    [tt_equalEqual] = PREC_EQUALITY, [tt_notEqual] = PREC_EQUALITY,
+    [tt_approxEqual] = PREC_EQUALITY, [tt_notApproxEqual] = PREC_EQUALITY,
+    [tt_strictEqual] = PREC_EQUALITY, [tt_strictNotEqual] = PREC_EQUALITY,
+    [tt_less] = PREC_COMPARISON, [tt_greater] = PREC_COMPARISON,
+    [tt_lessEqual] = PREC_COMPARISON, [tt_greaterEqual] = PREC_COMPARISON,
+    [tt_bitOr] = PREC_BIT_OR,
+    [tt_bitXor] = PREC_BIT_XOR,
+    [tt_bitAnd] = PREC_BIT_AND,
+    [tt_shiftLeft] = PREC_SHIFT, [tt_shiftRight] = PREC_SHIFT,
+    [tt_rotLeft] = PREC_SHIFT, [tt_rotRight] = PREC_SHIFT,
+    [tt_plus] = PREC_ADDITIVE, [tt_minus] = PREC_ADDITIVE,
+    [tt_star] = PREC_TERM, [tt_slash] = PREC_TERM,
+    [tt_percent] = PREC_TERM, [tt_intDiv] = PREC_TERM,
+    [tt_power] = PREC_POWER,
+};
 
-    str_t name = str_null;
-    if (_prs_is(ps, tt_identifier))
-        name = _prs_advance(ps).lexeme;
+static const u8 _prs_binaryOp[tt_eof + 1] = {
+    [tt_coalesce] = OP_COALESCE, [tt_guard] = OP_GUARD,
+    [tt_logicalOr] = OP_LOR, [tt_logicalXor] = OP_LXOR, [tt_logicalAnd] = OP_LAND,
+    [tt_equalEqual] = OP_EQ, [tt_notEqual] = OP_NEQ,
+    [tt_approxEqual] = OP_AEQ, [tt_notApproxEqual] = OP_NAEQ,
+    [tt_strictEqual] = OP_SEQ, [tt_strictNotEqual] = OP_NSEQ,
+    [tt_less] = OP_LT, [tt_greater] = OP_GT,
+    [tt_lessEqual] = OP_LE, [tt_greaterEqual] = OP_GE,
+    [tt_bitOr] = OP_OR, [tt_bitXor] = OP_XOR, [tt_bitAnd] = OP_AND,
+    [tt_shiftLeft] = OP_SHL, [tt_shiftRight] = OP_SHR,
+    [tt_rotLeft] = OP_ROL, [tt_rotRight] = OP_ROR,
+    [tt_plus] = OP_ADD, [tt_minus] = OP_SUB,
+    [tt_star] = OP_MUL, [tt_slash] = OP_DIV,
+    [tt_percent] = OP_MOD, [tt_intDiv] = OP_IDIV,
+    [tt_power] = OP_POW,
+};
+
+NodeId _prs_expression(Parser* ps);
+static NodeId _prs_binary(Parser* ps, u32 minPrec);
+
+NodeId _prs_parseDecl(Parser* ps) {
+    const u32 start = _prs_currentStart(ps);
+
+    SymbolId name = SYMBOL_NONE;
+    if (_prs_is(ps, tt_identifier)) {
+        name = _prs_currentValue(ps).u;
+        _prs_step(ps);
+    }
 
     if (_prs_expect(ps, tt_colon, "Expected ':'"))
-        return AstNode_NULL;
+        return NODE_NONE;
+
+    const NodeId value = _prs_expression(ps);
+
+    if (value == NODE_NONE)
+        return NODE_NONE;
+
+    return ast_makeDecl(ps->program->ast, name, value, start);
+}
+
+// Builtins that give the same value for the same arguments: the math and
+// color functions and `int`, without random, seed, randomColor, seedColor
+// and the print family. Sorted bytewise for the binary search.
+static const char* const _PRS_PURE_CALLS[] = {
+    "abs", "acos", "asin", "atan", "atan2", "avg", "blend", "brightness", "calm", "ceil",
+    "clamp", "complement", "contrast", "cos", "cymk", "cymka", "darken", "degree",
+    "difference", "distance", "exp", "expand", "floor", "glow", "grayscale", "hex", "hsl",
+    "hslo", "hsv", "hsvo", "hue", "int", "invert", "isCalm", "isDark", "isGray", "isLight",
+    "isNeon", "isNeutral", "isPastel", "isShout", "isSimilar", "isVibrant", "lerp",
+    "lighten", "log", "max", "med", "min", "mix", "neon", "opacity", "pastel", "pow",
+    "pressa", "radian", "rgb", "rgba", "rgbo", "round", "saturation", "shade", "shift",
+    "shiftHue", "shiftTemperature", "shout", "sign", "sin", "snap", "snapOffset", "sqrt",
+    "sum", "tan", "temperature", "tint", "tone", "unit", "vibrance",
+};
+
+// Whether `callee` is on _PRS_PURE_CALLS, anything else may be impure
+static bool _prs_isPureCall(const Parser* ps, const SymbolId callee) {
+    const str_t name = strPool_get(ps->program->stringPool, callee);
+    u32 lo = 0, hi = sizeof(_PRS_PURE_CALLS) / sizeof(_PRS_PURE_CALLS[0]);
+
+    while (lo < hi) {
+        const u32 mid = (lo + hi) / 2;
+        const char* pure = _PRS_PURE_CALLS[mid];
+        int order = strncmp(pure, name.data, name.length);
+
+        // Equal up to the name's length: a match or a longer entry
+        if (order == 0) {
+            if (pure[name.length] == '\0') return true;
+            order = 1;
+        }
+
+        if (order < 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return false;
+}
+
+// `name(args)`, the name and '(' are consumed. Arguments wait on the
+// stack until the call node copies them.
+static NodeId _prs_call(Parser* ps, const SymbolId callee, const u32 start) {
+    const u32 base = ps->stackLength;
+    NodeId id = NODE_NONE;
+
+    if (!_prs_match(ps, tt_rParen)) {
+        do {
+            if (_prs_is(ps, tt_rParen)) break;
+
+            const NodeId arg = _prs_expression(ps);
+            if (arg == NODE_NONE || !_prs_push(ps, arg)) goto done;
+
+        } while (_prs_match(ps, tt_comma));
+
+        if (_prs_expect(ps, tt_rParen, "Expected ')' after function arguments"))
+            goto done;
+    }
 
-    AstNode expr = _prs_expression(ps);
+    const u32 count = ps->stackLength - base;
+    if (count > AST_MAX_ARGS) {
+        _prs_error(ps, start, _prs_currentStart(ps) - start, "Too many function arguments");
+        goto done;
+    }
 
-    if (node_isNull(&expr))
-        return AstNode_NULL;
+    id = ast_makeCall(ps->program->ast, callee, &ps->stack[base], count,
+        _prs_isPureCall(ps, callee), start);
 
-    // TODO: return decl node
-    return AstNode_NULL;
+done:
+    ps->stackLength = base;
+    return id;
 }
 
-AstNode _prs_expression(Parser* ps) {
-    return (AstNode){ 0 };
-}
\ No newline at end of file
+static NodeId _prs_primary(Parser* ps) {
+    AstArena* ast = ps->program->ast;
+    const TokenType type = _prs_currentType(ps);
+    const u32 start = _prs_currentStart(ps);
+
+    switch (type) {
+      case tt_int32:
+      case tt_hexColor:
+      case tt_hex:
+      case tt_oct:
+      case tt_bin:
+      case tt_mask: {
+        const i32 value = _prs_currentValue(ps).i;
+        _prs_step(ps);
+        return ast_makeInt(ast, value, start);
+      }
+
+      case tt_float32:
+      case tt_exp: {
+        const f32 value = _prs_currentValue(ps).f;
+        _prs_step(ps);
+        return ast_makeFloat(ast, value, start);
+      }
+
+      case tt_dollar: {
+        _prs_step(ps);
+
+        const SymbolId name = _prs_currentValue(ps).u;
+        if (_prs_expect(ps, tt_identifier, "Expected identifier after $"))
+            return NODE_NONE;
+
+        return ast_makeAccess(ast, name, start);
+      }
+
+      case tt_identifier: {
+        const SymbolId name = _prs_currentValue(ps).u;
+        _prs_step(ps);
+
+        if (!_prs_match(ps, tt_lParen))
+            return ast_makeIdent(ast, name, start);
+
+        return _prs_call(ps, name, start);
+      }
+
+      case tt_lParen: {
+        _prs_step(ps);
+        const NodeId expr = _prs_expression(ps);
+        if (expr == NODE_NONE || _prs_expect(ps, tt_rParen, "Expected ')'"))
+            return NODE_NONE;
+
+        return expr;
+      }
+
+      default: {
+        const Token current = _prs_current(ps);
+        _prs_error(ps, current.start, current.lexeme.length,
+            type == tt_eof ? "Expected an expression" : "Unexpected token");
+        return NODE_NONE;
+      }
+    }
+}
+
+// Prefix operators bind tighter than every infix one, `-a ** b` is `(-a) ** b`
+static NodeId _prs_unary(Parser* ps) {
+    OpCode op;
+    switch (_prs_currentType(ps)) {
+      case tt_not: op = OP_NOT; break;
+      case tt_minus: op = OP_NEG; break;
+      case tt_plus: op = OP_POS; break;
+      case tt_bitNot: op = OP_BNOT; break;
+      default: return _prs_primary(ps);
+    }
+
+    const u32 start = _prs_currentStart(ps);
+    _prs_step(ps);
+
+    if (!_prs_enter(ps)) return NODE_NONE;
+    const NodeId operand = _prs_unary(ps);
+    _prs_leave(ps);
+    if (operand == NODE_NONE) return NODE_NONE;
+
+    return ast_makeUnary(ps->program->ast, op, operand, start);
+}
+
+// `condition ? then : else`, the '?' is consumed. Both branches are
+// ternaries again, not full expressions (no inline declarations).
+static NodeId _prs_ternary(Parser* ps, const NodeId condition, const u32 start) {
+    const NodeId thenValue = _prs_binary(ps, PREC_TERNARY);
+    if (thenValue == NODE_NONE) return NODE_NONE;
+
+    if (_prs_expect(ps, tt_colon, "Expected ':' in ternary expression"))
+        return NODE_NONE;
+
+    const NodeId elseValue = _prs_binary(ps, PREC_TERNARY);
+    if (elseValue == NODE_NONE) return NODE_NONE;
+
+    return ast_makeTernary(ps->program->ast, condition, thenValue, elseValue, start);
+}
+
+// Pratt loop: a unary operand, then every infix operator that binds at
+// least as tight as `minPrec`, left associative except `**` and `?:`.
+// Operator nodes start where their left operand does, '(' included.
+static NodeId _prs_binary(Parser* ps, const u32 minPrec) {
+    AstArena* ast = ps->program->ast;
+    const u32 start = _prs_currentStart(ps);
+    NodeId left = _prs_unary(ps);
+
+    while (left != NODE_NONE) {
+        const TokenType type = _prs_currentType(ps);
+        const u32 prec = _prs_precedence[type];
+        if (prec == PREC_NONE || prec < minPrec) break;
+
+        _prs_step(ps);
+
+        // `**` and `?:` chains nest to the right
+        if (!_prs_enter(ps)) return NODE_NONE;
+
+        if (type == tt_question) {
+            left = _prs_ternary(ps, left, start);
+            _prs_leave(ps);
+            continue;
+        }
+
+        const NodeId right = _prs_binary(ps, type == tt_power ? prec : prec + 1);
+        _prs_leave(ps);
+        if (right == NODE_NONE) return NODE_NONE;
+
+        left = ast_makeBinary(ast, (OpCode)_prs_binaryOp[type], left, right, start);
+    }
+
+    return left;
+}
+
+// An inline declaration `name: value` or a ternary, trailing ';' skipped.
+// Parentheses, call arguments and declaration values all come through
+// here, one nesting level each.
+NodeId _prs_expression(Parser* ps) {
+    if (!_prs_enter(ps)) return NODE_NONE;
+
+    const NodeId expr = _prs_is(ps, tt_identifier) && _prs_peekType(ps, 1) == tt_colon
+        ? _prs_parseDecl(ps)
+        : _prs_binary(ps, PREC_TERNARY);
+
+    _prs_leave(ps);
+
+    while (_prs_match(ps, tt_semicolon)) {}
+    return expr;
+}
@@ -1,5 +1,10 @@
 #include "parser.h"
 #include "parse-func.c"
+#include "nodes-get.h"
+#include "../program/capacity-plan.h"
+#include "../utils/threads.h"
+
+#include <string.h>
 
 bool Parser_isValid(const Parser* ps) {
     if (!ps) {
@@ -26,21 +31,367 @@ bool Parser_isValid(const Parser* ps) {
     return true;
 }
 
+// One declaration onto the stack. A broken one leaves no nodes or slots
+// behind, so the arena stays in post-order.
+static bool _prs_parseDeclOrDrop(Parser* ps, AstArena* ast) {
+    const u32 nodes = ast->nodeLength;
+    const u32 children = ast->childLength;
+
+    const NodeId decl = _prs_parseDecl(ps);
+    if (decl != NODE_NONE && _prs_push(ps, decl)) return true;
+
+    ast->nodeLength = nodes;
+    ast->childLength = children;
+    return false;
+}
+
 AstArena Parser_parse(Parser* ps) {
-    // TODO: guess needed capacitys using tokens length
-    AstArena ast = ast_new(100, 100);
-    ps->program->ast = &ast; // need to change program struct to accept embedded not pointers
+    const Source* src = ps->program->source;
+    const CapacityPlan plan = ps->program->plan
+        ? *ps->program->plan : plan_estimate(src->data, src->dataLength);
+
+    // At most one node and one parent slot per token, the arena never
+    // regrows while nodes are made
+    AstArena ast = ast_newWith(plan.nodes, plan.children, ps->program->allocator);
+    ps->program->ast = &ast;
+    ps->stackLength = 0;
+    // Own symbols count from 1, at most one per identifier token
+    if (ps->share) ast_enableSharing(&ast, plan.shareSlots, plan.identifiers + 1);
 
-    // TODO: Complete this...
+    // A broken declaration ends the program, what it made is dropped
+    while (!_prs_isAtEnd(ps) && _prs_parseDeclOrDrop(ps, &ast)) {}
 
+    ast_makeRoot(&ast, ps->stack, ps->stackLength, 0);
+    ast.postOrder = ast.shareHits == 0;
+    _prs_releaseStack(ps);
+
+    // The arena is returned by value, `ast` ends here
+    ps->program->ast = NULL;
     return ast;
 }
 
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// PARALLEL PARSE
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// One part of the token store, parsed on its own thread. Source, tokens
+// and pool are shared read only, the arena and the errors are its own.
+typedef struct ParseChunk {
+    Program program;
+    ErrorReporter reporter;
+    AstArena ast;
+    Parser parser;          // Declarations end up on its stack
+    TokenId first;          // Parses the declarations starting in [first, end)
+    TokenId end;
+    bool broken;            // Stopped at a broken declaration
+
+    // Merge: where its nodes, child slots and declarations go
+    const AstArena* target;
+    NodeId* decls;
+    NodeId nodeBase;
+    ChildId childBase;
+    u32 declBase;
+} ParseChunk;
+
+static void _prs_chunkInit(ParseChunk* c, const Parser* ps, const TokenId first, const TokenId end) {
+    const Allocator heap = mem_heap;
+    const u32 tokens = end > first ? end - first : 0;
+
+    c->program = *ps->program;
+    c->program.plan = NULL;
+    c->program.allocator = heap;
+
+    c->reporter = reporter_newWith(4, ps->program->reporter->printer, 0, heap);
+    c->ast = ast_newWith(tokens + 1, tokens + 1, heap);
+    c->program.reporter = &c->reporter;
+    c->program.ast = &c->ast;
+
+    c->parser = (Parser){ .program = &c->program, .tokens = ps->tokens, .position = first };
+    c->first = first;
+    c->end = end;
+    c->broken = false;
+}
+
+static void _prs_chunkRelease(ParseChunk* c) {
+    ast_release(&c->ast);
+    reporter_clear(&c->reporter);
+    _prs_releaseStack(&c->parser);
+}
+
+// Same loop as Parser_parse, until a declaration starts at or past `end`
+static void _prs_parseChunk(void* arg) {
+    ParseChunk* c = arg;
+    Parser* ps = &c->parser;
+
+    while (ps->position < c->end && !_prs_isAtEnd(ps)) {
+        if (!_prs_parseDeclOrDrop(ps, &c->ast)) {
+            c->broken = true;
+            break;
+        }
+    }
+}
+
+static void _prs_mergeChunk(void* arg) {
+    const ParseChunk* c = arg;
+
+    ast_copyRebased(c->target, &c->ast, c->nodeBase, c->childBase);
+    for (u32 i = 0; i < c->parser.stackLength; i++)
+        c->decls[c->declBase + i] = c->parser.stack[i] + c->nodeBase;
+}
+
+// fn on every chunk, the first on the calling thread. A thread that does
+// not start leaves its chunk to the calling thread too.
+static void _prs_runChunks(ParseChunk* chunks, Thread* threads, const u32 count, const ThreadFn fn) {
+    u32 started = 1;
+
+    for (; started < count; started++)
+        if (!thread_start(&threads[started], fn, &chunks[started])) break;
+
+    for (u32 k = 0; k < count; k++)
+        if (k == 0 || k >= started) fn(&chunks[k]);
+
+    for (u32 k = 1; k < started; k++) thread_join(&threads[k]);
+}
+
+// First token from `id` on that starts a line with `name:`. Most such
+// lines are declarations; the merge checks the ones that are not.
+static TokenId _prs_splitFrom(const TokenStore* ts, const char* data, TokenId id) {
+    if (id == 0) id = 1;
+
+    for (; id + 1 < ts->length; id++) {
+        if (tokstore_type(ts, id) != tt_identifier || tokstore_type(ts, id + 1) != tt_colon)
+            continue;
+
+        const u32 prevEnd = tokstore_start(ts, id - 1) + tokstore_length(ts, id - 1);
+        const u32 start = tokstore_start(ts, id);
+        if (start > prevEnd && memchr(data + prevEnd, '\n', start - prevEnd) != NULL) return id;
+    }
+
+    return ts->length;
+}
+
+AstArena Parser_parseParallel(Parser* ps, u32 threads) {
+    const TokenId start = ps->position;
+    const u32 tokens = ps->tokens.length > start ? ps->tokens.length - start : 0;
+
+    if (threads == 0) threads = thread_hardwareCount();
+    if (threads > tokens / PARSER_PARALLEL_TOKENS) threads = tokens / PARSER_PARALLEL_TOKENS;
+    if (ps->lexer || ps->share || threads <= 1) return Parser_parse(ps);
+
+    const Allocator heap = mem_heap;
+    ParseChunk* chunks = memAlloc(&heap, threads * sizeof(ParseChunk));
+    Thread* handles = memAlloc(&heap, threads * sizeof(Thread));
+    if (!chunks || !handles) {
+        memFree(&heap, chunks, threads * sizeof(ParseChunk));
+        memFree(&heap, handles, threads * sizeof(Thread));
+        return Parser_parse(ps);
+    }
+
+    // Even token counts, moved forward to the next likely declaration
+    TokenId first = start;
+    for (u32 k = 0; k < threads; k++) {
+        TokenId end = ps->tokens.length;
+        if (k + 1 < threads) {
+            end = _prs_splitFrom(&ps->tokens, ps->program->source->data,
+                start + (TokenId)((u64)tokens * (k + 1) / threads));
+            if (end < first) end = first;
+        }
+
+        _prs_chunkInit(&chunks[k], ps, first, end);
+        first = end;
+    }
+
+    _prs_runChunks(chunks, handles, threads, _prs_parseChunk);
+
+    // In source order: a chunk is right when the one before stopped exactly
+    // where it starts, otherwise it is parsed again from there. The first
+    // broken declaration ends the program, later chunks are dropped.
+    TokenId position = start;
+    u32 used = threads;
+
+    for (u32 k = 0; k < threads; k++) {
+        ParseChunk* c = &chunks[k];
+
+        if (c->first != position) {
+            const TokenId end = c->end;
+            _prs_chunkRelease(c);
+            _prs_chunkInit(c, ps, position, end);
+            _prs_parseChunk(c);
+        }
+
+        position = c->parser.position;
+        if (c->broken || _prs_isAtEnd(&c->parser)) {
+            used = k + 1;
+            break;
+        }
+    }
+
+    for (u32 k = used; k < threads; k++) _prs_chunkRelease(&chunks[k]);
+
+    // One arena with room for every chunk and the root
+    u32 nodes = 0, children = 0, decls = 0;
+    for (u32 k = 0; k < used; k++) {
+        chunks[k].nodeBase = nodes;
+        chunks[k].childBase = children;
+        chunks[k].declBase = decls;
+
+        nodes += chunks[k].ast.nodeLength;
+        children += chunks[k].ast.childLength;
+        decls += chunks[k].parser.stackLength;
+    }
+
+    AstArena ast = ast_newWith(nodes + 1, children + decls + 1, ps->program->allocator);
+    NodeId* roots = memAlloc(&heap, (decls + 1) * sizeof(NodeId));
+
+    if (ast.nodes && ast.positions && ast.children && roots) {
+        for (u32 k = 0; k < used; k++) {
+            chunks[k].target = &ast;
+            chunks[k].decls = roots;
+        }
+
+        _prs_runChunks(chunks, handles, used, _prs_mergeChunk);
+        ast.nodeLength = nodes;
+        ast.childLength = children;
+        ast_makeRoot(&ast, roots, decls, 0);
+        ast.postOrder = true;
+    }
+
+    // Only the last chunk can hold an error, the one that ended the program
+    for (u32 k = 0; k < used; k++) {
+        const ErrorReporter* re = &chunks[k].reporter;
+        for (u32 e = 0; e < re->errors.length; e++)
+            reporter_push(ps->program->reporter, re->errors.errs[e], *ps->program->source);
+
+        _prs_chunkRelease(&chunks[k]);
+    }
+
+    ps->position = position;
+
+    memFree(&heap, roots, (decls + 1) * sizeof(NodeId));
+    memFree(&heap, chunks, threads * sizeof(ParseChunk));
+    memFree(&heap, handles, threads * sizeof(Thread));
+    return ast;
+}
+
+// First of the `count` declarations from child `first` that starts at or
+// after `offset`
+static u32 _prs_declAt(const AstArena* ast, const ChildId first, const u32 count, const u32 offset) {
+    u32 lo = 0, hi = count;
+    while (lo < hi) {
+        const u32 mid = lo + ((hi - lo) >> 1);
+        if (ast_getPosIn(ast, mid, ast->children[first + mid]) < offset) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+// Room for `count` declarations in the root's slots and the shift table.
+// Slots that do not fit move to the end of the children, with room to grow
+// so the next re-parses fill them in place.
+static bool _prs_reserveRoot(AstArena* ast, const u32 count) {
+    AstNode* root = &ast->nodes[ast->root];
+    const u32 length = root->data;
+    const u32 capacity = ast->rootCapacity > length ? ast->rootCapacity : length;
+    if (ast->shifts && count <= capacity) return true;
+
+    const u32 grown = count > capacity || capacity == 0 ? count + count / 4 + 16 : capacity;
+    u32* shifts = memResize(&ast->allocator, ast->shifts,
+        ast->rootCapacity * sizeof(u32), grown * sizeof(u32));
+    if (!shifts) return false;
+
+    // Before the first re-parse every declaration is where it was parsed
+    if (!ast->shifts) memset(shifts, 0, length * sizeof(u32));
+    ast->shifts = shifts;
+    ast->rootCapacity = grown;
+
+    if (grown != capacity) {
+        const ChildId first = ast_reserveChildren(ast, grown);
+        memCopy(&ast->children[first], &ast->children[root->firstChild], length * sizeof(NodeId));
+        root->firstChild = first;
+    }
+
+    return true;
+}
+
+bool Parser_reparse(Parser* ps, AstArena* ast, const TokenSplice* splice) {
+    if (ps->lexer || ast->root == NODE_NONE || ast->shareTable) return false;
+    if (!_prs_reserveRoot(ast, ast->nodes[ast->root].data)) return false;
+
+    const ChildId first = ast->nodes[ast->root].firstChild;
+    const u32 count = ast->nodes[ast->root].data;
+
+    // Start at the last declaration before `from`: it may hold the first
+    // changed token, or stop on it (parsing reads one token past the end)
+    u32 lo = _prs_declAt(ast, first, count, splice->from);
+    if (lo > 0) lo--;
+    u32 next = _prs_declAt(ast, first, count, splice->oldEnd);
+
+    // Declarations after the edit move with their tokens, their nodes keep
+    // the positions they were parsed at
+    for (u32 i = next; i < count; i++) ast->shifts[i] += (u32)splice->delta;
+
+    // Offsets before `from` did not move, the first declaration may start past it
+    u32 start = splice->from;
+    if (lo < count && ast_getPosIn(ast, lo, ast->children[first + lo]) < start)
+        start = ast_getPosIn(ast, lo, ast->children[first + lo]);
+    ps->position = tokstore_find(&ps->tokens, start);
+    ps->program->ast = ast;
+
+    // Only the new declarations go on the stack
+    ps->stackLength = 0;
+    const TokenId spliceEnd = splice->first + splice->inserted;
+    bool inStep = false;
+
+    while (!_prs_isAtEnd(ps)) {
+        // Back in step once the parser stands where an old declaration starts
+        if (ps->position >= spliceEnd) {
+            const u32 at = tokstore_start(&ps->tokens, ps->position);
+            while (next < count && ast_getPosIn(ast, next, ast->children[first + next]) < at) next++;
+
+            if (next < count && ast_getPosIn(ast, next, ast->children[first + next]) == at) {
+                inStep = true;
+                break;
+            }
+        }
+
+        // A broken declaration ends the program, as in Parser_parse
+        const NodeId decl = _prs_parseDecl(ps);
+        if (decl == NODE_NONE || !_prs_push(ps, decl)) break;
+    }
+
+    // The root's slots are rewritten in place: the ones before the edit
+    // stay, the ones after it move to follow the new declarations
+    const u32 made = ps->stackLength;
+    const u32 tail = inStep ? count - next : 0;
+    const u32 length = lo + made + tail;
+
+    if (!_prs_reserveRoot(ast, length)) {
+        _prs_releaseStack(ps);
+        return false;
+    }
+
+    AstNode* root = &ast->nodes[ast->root];
+    NodeId* decls = &ast->children[root->firstChild];
+
+    memMove(&decls[lo + made], &decls[next], tail * sizeof(NodeId));
+    memMove(&ast->shifts[lo + made], &ast->shifts[next], tail * sizeof(u32));
+    memCopy(&decls[lo], ps->stack, made * sizeof(NodeId));
+    memset(&ast->shifts[lo], 0, made * sizeof(u32));
+
+    root->data = length;
+    ast->postOrder = false;
+
+    _prs_releaseStack(ps);
+    return true;
+}
+
 Parser* Parser_reset(Parser* ps)  {
     ps->position = 0;
+    if (ps->lexer) Lexer_reset(ps->lexer);
     return ps;
 }
 
 bool Parser_isFinished(const Parser* ps) {
-    return ps->position == ps->tokens.length;
+    return _prs_isAtEnd(ps);
 }
\ No newline at end of file
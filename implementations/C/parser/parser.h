@@ -2,19 +2,71 @@
 
 #include "../utils/short-types.h"
 #include "../lexer/token.h"
+#include "../lexer/lexer.h"
 #include "../program/program.h"
 #include "ast.h"
 
+// Deepest nesting of parentheses, calls, prefix operators, inline
+// declarations and right operands the parser recurses into. Past it the
+// expression is reported, the parser would run out of stack first (parts
+// of Parser_parseParallel run on threads with the platform's default).
+#define PARSER_MAX_DEPTH 256
+
+// Tokens come either from a lexed `tokens` store, indexed by TokenId, or,
+// when `lexer` is set, are pulled from it on demand (no TokenStore is ever
+// built and peak memory does not depend on the token count).
 typedef struct Parser {
     Program* program;
-    TokenList tokens;
-    u32 position;
+    TokenStore tokens;
+    Lexer* lexer;       // Pull mode token source, NULL to use `tokens`
+    TokenId position;   // Id of the current token, or tokens consumed in pull mode
+
+    // Declarations and call arguments waiting for their parent node,
+    // one buffer per parse instead of a list per node
+    NodeId* stack;
+    u32 stackLength;
+    u32 stackCapacity;
+
+    u32 depth;          // Nesting of the expression being parsed, PARSER_MAX_DEPTH at most
+    bool share;         // Hash-cons equal subtrees into one node (ast_enableSharing)
 } Parser;
 
 bool Parser_isValid(const Parser* ps);
 
+/**
+ * Parses every declaration into an AstArena sized from the capacity plan,
+ * stops at the first broken one and drops what it made. Nodes are written
+ * straight into the arena, operands before their operator, and the root
+ * comes last (`ast.root`): the arena is in post-order (`ast.postOrder`),
+ * unless `ps->share` made equal subtrees one node.
+ */
 AstArena Parser_parse(Parser* ps);
 
+// Fewest tokens worth a thread of their own in Parser_parseParallel
+#define PARSER_PARALLEL_TOKENS (1u << 12)
+
+/**
+ * Parser_parse on up to `threads` threads (0: one per logical processor).
+ * The tokens are split where a line starts with `name:`, every part is
+ * parsed into an AstArena of its own, and the parts are merged in source
+ * order with rebased ids. The arena and the errors are the same as
+ * Parser_parse gives; a split that was not a declaration start is parsed
+ * again from the real one. Pull mode and sharing parse on the calling
+ * thread.
+ */
+AstArena Parser_parseParallel(Parser* ps, u32 threads);
+
+/**
+ * Re-parses the declarations `splice` touched, once Lexer_relex brought
+ * `ps->tokens` up to date. Declarations before the edit are kept as they
+ * are, the ones after it keep their nodes and move by their entry in
+ * `ast->shifts` (ast_getPosIn). The root's slots are rewritten in place,
+ * replaced subtrees stay in the arena unreferenced, and it is no longer in
+ * post-order (ast_linearize). False when `ast` holds no parsed program, or
+ * shares nodes (or tokens are pulled), parse it whole then.
+ */
+bool Parser_reparse(Parser* ps, AstArena* ast, const TokenSplice* splice);
+
 Parser* Parser_reset(Parser* ps);
 
 bool Parser_isFinished(const Parser* ps);
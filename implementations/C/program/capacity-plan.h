@@ -0,0 +1,180 @@
+/*
+ * @file capacity-plan.h
+ *
+ * One pass over the source, before lexing, that sizes every arena of a
+ * compile: the token list, the string pool, the AST and the line table.
+ *
+ * The scan classifies bytes a vector block at a time (lex-scan.h
+ * primitives) and only counts, it never builds tokens:
+ *   - identifier-class runs ([a-zA-Z0-9_]+) and the bytes in them,
+ *   - runs that look like names (not starting with a digit, not after '#'),
+ *   - whitespace and newlines,
+ * skipping comments the way the lexer does. Every other byte is assumed to
+ * be a one byte token, so the estimates are upper bounds for typical theme
+ * sources and a compile sized from them never regrows.
+ */
+
+#pragma once
+
+#include "../utils/short-types.h"
+#include "../lexer/lex-scan.h"
+#include "string-pool.h"
+
+typedef struct CapacityPlan {
+    u32 tokens;         // Tokens, eof included
+    u32 identifiers;    // Identifier tokens, bounds the distinct names
+    u32 poolBytes;      // StringPool data bytes, headers included
+    u32 poolSlots;      // StringPool hash capacity (power of two)
+    u32 nodes;          // AstArena nodes, root included
+    u32 children;       // AstArena child slots
+    u32 shareSlots;     // AstArena share table slots, with sharing on
+    u32 lines;          // LineTable entries
+} CapacityPlan;
+
+// Raw counts gathered by the scan
+typedef struct PlanCounts {
+    u32 bytes;          // Bytes outside comments
+    u32 runs;           // Identifier-class runs
+    u32 words;          // Runs that lex as identifiers
+    u32 wordBytes;      // Bytes of identifier-class runs
+    u32 blanks;         // Whitespace bytes
+    u32 newlines;       // '\n' anywhere, comments included
+} PlanCounts;
+
+// Skips the comment starting at `pos`, returns the position after it
+static inline
+u32 _plan_skipComment(const char* data, const u32 pos, const u32 len, PlanCounts* c) {
+    // Line comment: its '\n' is counted with the whitespace after it
+    if (data[pos + 1] == '/') return scan_lineEnd(data, pos + 2, len);
+
+    const u32 end = scan_blockEnd(data, pos + 2, len);
+    for (u32 i = pos + 2; i < end; i++)
+        c->newlines += data[i] == '\n';
+
+    return end < len ? end + 2 : len;
+}
+
+// Counts [pos, end) byte by byte, stops early past a comment
+static inline
+u32 _plan_scalar(const char* data, u32 pos, const u32 end, const u32 len, PlanCounts* c) {
+    for (; pos < end; pos++) {
+        const char ch = data[pos];
+
+        if (ch == '/' && pos + 1 < len && (data[pos + 1] == '/' || data[pos + 1] == '*'))
+            return _plan_skipComment(data, pos, len, c);
+
+        c->bytes++;
+
+        if (CL_isIdentifierPart(ch)) {
+            const char before = pos ? data[pos - 1] : ' ';
+            c->wordBytes++;
+
+            if (!CL_isIdentifierPart(before)) {
+                c->runs++;
+                c->words += !CL_isDigit(ch) && before != CL_Hash;
+            }
+        } else if (CL_isWhitespace(ch)) {
+            c->blanks++;
+            c->newlines += ch == '\n';
+        }
+    }
+
+    return pos;
+}
+
+#if SCAN_WIDTH
+
+// Counts whole blocks while no comment starts in them. Byte counters are
+// summed every 255 blocks, before any lane can wrap.
+static inline
+u32 _plan_vector(const char* data, u32 pos, const u32 len, PlanCounts* c) {
+    // Every block also reads one byte before and one byte after itself
+    while (pos && pos + SCAN_WIDTH + 1 <= len) {
+        scan_vec runs = _scan_zero(), words = _scan_zero(), wordBytes = _scan_zero();
+        scan_vec blanks = _scan_zero(), newlines = _scan_zero();
+
+        for (u32 blocks = 0; blocks < 255 && pos + SCAN_WIDTH + 1 <= len; blocks++) {
+            const scan_vec v = _scan_load(data + pos);
+            const scan_vec prev = _scan_load(data + pos - 1);
+            const scan_vec next = _scan_load(data + pos + 1);
+
+            const scan_vec comment = _scan_and(_scan_eq(v, _scan_set1('/')),
+                _scan_or(_scan_eq(next, _scan_set1('/')), _scan_eq(next, _scan_set1('*'))));
+
+            const scan_mask hit = _scan_bits(comment);
+            if (hit) {
+                pos = _plan_scalar(data, pos, pos + (u32)__builtin_ctz(hit) + 1, len, c);
+                continue;
+            }
+
+            const scan_vec ident = _scan_classIdentifier(v);
+            const scan_vec start = _scan_andnot(_scan_classIdentifier(prev), ident);
+            const scan_vec literal = _scan_or(_scan_inRange(v, '0', '9'), _scan_eq(prev, _scan_set1(CL_Hash)));
+
+            runs = _scan_sub(runs, start);
+            words = _scan_sub(words, _scan_andnot(literal, start));
+            wordBytes = _scan_sub(wordBytes, ident);
+            blanks = _scan_sub(blanks, _scan_classWhitespace(v));
+            newlines = _scan_sub(newlines, _scan_eq(v, _scan_set1('\n')));
+
+            c->bytes += SCAN_WIDTH;
+            pos += SCAN_WIDTH;
+        }
+
+        // Compare results are 0xFF, subtracting them counted +1 per byte
+        c->runs += _scan_sum(runs);
+        c->words += _scan_sum(words);
+        c->wordBytes += _scan_sum(wordBytes);
+        c->blanks += _scan_sum(blanks);
+        c->newlines += _scan_sum(newlines);
+    }
+
+    return pos;
+}
+
+#endif
+
+/**
+ * Scans `data` once and derives arena capacities from the counts.
+ * Every byte that is not whitespace, comment or part of a run is taken as
+ * a token of its own, and every token as at most one AST node with one
+ * parent slot.
+ */
+static inline
+CapacityPlan plan_estimate(const char* data, const u32 len) {
+    PlanCounts c = { 0 };
+    u32 pos = 0;
+
+#if SCAN_WIDTH
+    // The first byte has nothing before it for the vector loads
+    if (len) pos = _plan_scalar(data, 0, 1, len, &c);
+    pos = _plan_vector(data, pos, len, &c);
+#endif
+
+    while (pos < len) pos = _plan_scalar(data, pos, len, len, &c);
+
+    const u32 singles = c.bytes - c.blanks - c.wordBytes;
+
+    CapacityPlan plan = {
+        .tokens = c.runs + singles + 1,
+        .identifiers = c.words,
+        .lines = c.newlines + 1,
+    };
+
+    // Every string is a header plus its bytes, padded to 4
+    plan.poolBytes = c.wordBytes + c.words * ((u32)sizeof(StringHeader) + 3);
+    if (plan.poolBytes < 64) plan.poolBytes = 64;
+
+    // Interning grows the table once it is 7/8 full
+    plan.poolSlots = STRPOOL_GROUP;
+    while (plan.poolSlots / 8 * 7 <= plan.identifiers) plan.poolSlots *= 2;
+
+    plan.nodes = plan.tokens + 1;
+    plan.children = plan.tokens;
+
+    // Names and values come with `:`, `;`, `,` and parentheses that make no
+    // node, so about every other token is one. Room for that many at 7/8,
+    // a table that fills up stops sharing rather than growing.
+    plan.shareSlots = plan.nodes / 7 * 4 + 16;
+    return plan;
+}
@@ -0,0 +1,160 @@
+/*
+ * @file line-table.h
+ *
+ * Offsets of every line start in a source, filled by the lexer while it
+ * skips whitespace and comments (tokens never span lines, so those are the
+ * only places a '\n' can hide).
+ *
+ * `scanned` is the offset up to which every newline is recorded. Lookups
+ * past it finish the scan on demand, so a table is always usable, even when
+ * the lexer stopped early or never ran. Offset to line/column is then a
+ * binary search instead of a rescan from the start of the file.
+ */
+
+#pragma once
+
+#include "../utils/short-types.h"
+#include "../lexer/lex-scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct LineTable {
+    u32* starts;        // starts[i] = offset of line i + 1, starts[0] = 0
+    u32 length;         // Recorded lines
+    u32 capacity;
+    u32 scanned;        // Every newline before this offset is recorded
+} LineTable;
+
+static inline
+LineTable lines_new(u32 capacity) {
+    if (capacity == 0) capacity = 16;
+
+    LineTable t = {
+        .starts = malloc(capacity * sizeof(u32)),
+        .length = 1,
+        .capacity = capacity,
+        .scanned = 0,
+    };
+
+    if (t.starts == NULL) {
+        fprintf(stderr, "LineTable Error: Memory allocation failed.\n");
+        t.capacity = 0;
+        t.length = 0;
+        return t;
+    }
+
+    t.starts[0] = 0;
+    return t;
+}
+
+// Drop recorded lines, keep the memory for the next source
+static inline
+void lines_reset(LineTable* t) {
+    t->length = t->capacity ? 1 : 0;
+    t->scanned = 0;
+}
+
+static inline
+void lines_release(const LineTable* t) {
+    free(t->starts);
+}
+
+static inline
+void _lines_push(LineTable* t, const u32 start) {
+    if (t->length == t->capacity) {
+        const u32 capacity = t->capacity ? t->capacity * 2 : 16;
+        u32* starts = realloc(t->starts, capacity * sizeof(u32));
+
+        if (starts == NULL) {
+            fprintf(stderr, "LineTable Error: Memory allocation failed during reallocation.\n");
+            return;
+        }
+
+        t->starts = starts;
+        t->capacity = capacity;
+        if (t->length == 0) t->starts[t->length++] = 0;
+    }
+
+    t->starts[t->length++] = start;
+}
+
+/**
+ * Records the line starts inside [from, to).
+ * The caller guarantees [scanned, from) holds no '\n', the lexer only calls
+ * this for the whitespace and comments it skips. Ranges already covered are
+ * ignored, so re-lexing the same source does not duplicate lines.
+ */
+static inline
+void lines_record(LineTable* t, const char* data, u32 from, const u32 to) {
+    if (to <= t->scanned) return;
+    if (from < t->scanned) from = t->scanned;
+
+    while ((from = scan_lineEnd(data, from, to)) < to)
+        _lines_push(t, ++from);
+
+    t->scanned = to;
+}
+
+// Records every line start up to `to`, whatever the lexer covered so far
+static inline
+void lines_scanTo(LineTable* t, const char* data, const u32 to) {
+    lines_record(t, data, t->scanned, to);
+}
+
+// Zero based index of the line holding `offset` (offset must be scanned)
+static inline
+u32 lines_find(const LineTable* t, const u32 offset) {
+    u32 lo = 0, hi = t->length;
+
+    // Last start <= offset
+    while (hi - lo > 1) {
+        const u32 mid = lo + (hi - lo) / 2;
+        if (t->starts[mid] <= offset) lo = mid;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+// Forgets every line start after `offset`, for a source edited from there
+// on. The lexer records them again as it re-lexes, lookups past that
+// finish the scan on demand.
+static inline
+void lines_truncate(LineTable* t, const u32 offset) {
+    if (t->scanned <= offset) return;
+
+    t->length = lines_find(t, offset) + 1;
+    t->scanned = offset;
+}
+
+/**
+ * Same results as pos_getOffsetInfo: one based row and column of `offset`,
+ * plus the start and length (without '\n') of its line.
+ * Scans ahead lazily when `offset` lies past what the lexer recorded.
+ */
+static inline
+void lines_getOffsetInfo(
+    LineTable* t, const char* src, const u32 srcLen, u32 offset,
+    u32* row, u32* col, u32* lineStart, u32* lineLength
+) {
+    if (offset > srcLen) offset = srcLen;
+    if (offset > t->scanned) lines_scanTo(t, src, offset);
+
+    const u32 line = lines_find(t, offset);
+
+    // Its end is needed too, finish the line when it is the last one recorded
+    if (line + 1 == t->length && t->scanned < srcLen) {
+        const u32 end = scan_lineEnd(src, t->scanned, srcLen);
+        lines_scanTo(t, src, end < srcLen ? end + 1 : srcLen);
+    }
+
+    const u32 start = t->starts[line];
+    u32 end = line + 1 < t->length ? t->starts[line + 1] - 1 : srcLen;
+    if (end > srcLen) end = srcLen;
+
+    *row = line + 1;
+    *col = offset - start + 1;
+    *lineStart = start;
+    *lineLength = end - start;
+}
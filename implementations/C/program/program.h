@@ -5,10 +5,14 @@
 #include "string-pool.h"
 #include "source.h"
 
+typedef struct CapacityPlan CapacityPlan;
+
 typedef struct Program {
-    AstArena* ast;
+    AstArena* ast;              // Arena being parsed into, Parser_parse clears it on return
     StringPool* stringPool;
     Source* source;
     ErrorReporter* reporter;
+    const CapacityPlan* plan;   // Optional arena sizes, see capacity-plan.h
+    Allocator allocator;        // Tokens, AST and errors of the compile (zero: heap)
 } Program;
 
@@ -0,0 +1,190 @@
+#include "source.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if OS_isWINDOWS
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   ifndef MAP_ANONYMOUS
+#       define MAP_ANONYMOUS MAP_ANON
+#   endif
+#endif
+
+// Largest source the u32 offsets can address, tail included
+#define _SOURCE_MAX ((u64)UINT32_MAX - SOURCE_TAIL)
+
+static inline
+Source _source_named(const char* path) {
+    return (Source) {
+        .name = (char*)path,
+        .nameLength = (u32)strlen(path),
+        .origin = SO_Literal,
+    };
+}
+
+static inline
+Source _source_failed(const char* path, const char* reason) {
+    fprintf(stderr, "Source Error: cannot load '%s': %s.\n", path, reason);
+    return _source_named(path);
+}
+
+// Fallback for anything that cannot be mapped: read it all into a padded buffer
+static
+Source _source_readFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return _source_failed(path, "file cannot be opened");
+
+    usize capacity = 1 << 16;
+    usize length = 0;
+    char* data = malloc(capacity + SOURCE_TAIL);
+
+    while (data) {
+        length += fread(data + length, 1, capacity - length, file);
+        if (length < capacity) break;
+
+        capacity *= 2;
+        char* grown = capacity <= _SOURCE_MAX ? realloc(data, capacity + SOURCE_TAIL) : NULL;
+        if (!grown) free(data);
+        data = grown;
+    }
+
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+
+    if (!data) return _source_failed(path, "file is too large to load");
+    if (failed) {
+        free(data);
+        return _source_failed(path, "read error");
+    }
+
+    memset(data + length, 0, SOURCE_TAIL);
+
+    Source src = _source_named(path);
+    src.data = data;
+    src.dataLength = (u32)length;
+    src.origin = SO_Heap;
+    return src;
+}
+
+#if OS_isWINDOWS
+
+Source source_mapFile(const char* path) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return _source_failed(path, "file cannot be opened");
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || GetFileType(file) != FILE_TYPE_DISK) {
+        CloseHandle(file);
+        return _source_readFile(path);
+    }
+
+    if ((u64)size.QuadPart > _SOURCE_MAX) {
+        CloseHandle(file);
+        return _source_failed(path, "file is too large to load");
+    }
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    // A view ends on a page boundary, the zero tail only exists when the
+    // last page has room for it
+    const usize pageSize = info.dwPageSize;
+    const usize used = (usize)size.QuadPart % pageSize;
+    if (size.QuadPart == 0 || used == 0 || pageSize - used < SOURCE_TAIL) {
+        CloseHandle(file);
+        return _source_readFile(path);
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    char* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+    // The view keeps the mapping alive on its own
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+
+    if (!data) return _source_readFile(path);
+
+    Source src = _source_named(path);
+    src.data = data;
+    src.dataLength = (u32)size.QuadPart;
+    src.origin = SO_Mapped;
+    src.mappedSize = (usize)size.QuadPart;
+    return src;
+}
+
+void source_release(Source* src) {
+    if (src->origin == SO_Mapped) UnmapViewOfFile(src->data);
+    else if (src->origin == SO_Heap) free(src->data);
+
+    src->data = NULL;
+    src->dataLength = 0;
+    src->origin = SO_Literal;
+}
+
+#else
+
+Source source_mapFile(const char* path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return _source_failed(path, "file cannot be opened");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return _source_readFile(path);
+    }
+
+    if ((u64)st.st_size > _SOURCE_MAX) {
+        close(fd);
+        return _source_failed(path, "file is too large to load");
+    }
+
+    // Reserve the file plus a zero tail as anonymous pages, then map the file
+    // over the front. Pages wholly past the end of a file fault when touched,
+    // the anonymous ones behind it read as zeros.
+    const usize pageSize = (usize)sysconf(_SC_PAGESIZE);
+    const usize size = (usize)st.st_size;
+    const usize reserved = (size + SOURCE_TAIL + pageSize - 1) & ~(pageSize - 1);
+
+    char* base = mmap(NULL, reserved, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return _source_readFile(path);
+    }
+
+    char* data = mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        munmap(base, reserved);
+        return _source_readFile(path);
+    }
+
+    // The lexer walks the file once, front to back
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    Source src = _source_named(path);
+    src.data = data;
+    src.dataLength = (u32)size;
+    src.origin = SO_Mapped;
+    src.mappedSize = reserved;
+    return src;
+}
+
+void source_release(Source* src) {
+    if (src->origin == SO_Mapped) munmap(src->data, src->mappedSize);
+    else if (src->origin == SO_Heap) free(src->data);
+
+    src->data = NULL;
+    src->dataLength = 0;
+    src->origin = SO_Literal;
+}
+
+#endif
@@ -9,9 +9,38 @@
     .nameLength = sizeof(Name) - 1 \
 })
 
+// Zero bytes readable past the end of a loaded file, so a lexer peeking a
+// few bytes ahead of its position never leaves the buffer
+#define SOURCE_TAIL 64
+
+typedef struct LineTable LineTable;
+
+typedef enum SourceOrigin {
+    SO_Literal,     // Caller owned data, nothing to release
+    SO_Mapped,      // Read-only file mapping
+    SO_Heap,        // Read into a malloc'd buffer
+} SourceOrigin;
+
 typedef struct Source {
     char* data;
     char* name;
     u32 dataLength;
     u32 nameLength;
+    LineTable* lines;   // Optional, filled by the lexer (NULL: rescan per lookup)
+    SourceOrigin origin;
+    usize mappedSize;   // Bytes reserved for a mapped source
 } Source;
+
+/**
+ * Loads `path` for lexing without copying it: the file is mapped
+ * read-only (sequential access hint) and followed by at least SOURCE_TAIL
+ * zero bytes. Files that cannot be mapped (pipes, special files) are read
+ * into a padded heap buffer instead.
+ *
+ * `path` becomes the source name and must outlive the source.
+ * On failure a message goes to stderr and `data` is NULL.
+ */
+Source source_mapFile(const char* path);
+
+// Unmaps or frees what source_mapFile loaded, literal sources are left alone
+void source_release(Source* src);
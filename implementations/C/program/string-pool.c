@@ -1,210 +1,706 @@
 #include "string-pool.h"
 #include "../utils/memory.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Headers are u32 aligned inside a chunk
+#define _STRPOOL_ALIGN(n) (((n) + 3u) & ~3u)
+
+#if !defined(TSTM_NO_SIMD) && ARCH_hasSSE2 && defined(__SSE2__)
+#   include <emmintrin.h>
+#   define _STRPOOL_SSE2 1
+#else
+#   define _STRPOOL_SSE2 0
+#endif
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// HASH
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// wyhash (final v4) secrets
+static const u64 _strPool_secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+    0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull,
+};
+
+static inline
+u64 _strPool_read64(const char* p) {
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline
+u64 _strPool_read32(const char* p) {
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 64x64 -> 128 multiply, folded back to 64 bits
+static inline
+u64 _strPool_mix(const u64 a, const u64 b) {
+#if defined(__SIZEOF_INT128__)
+    const __uint128_t r = (__uint128_t)a * b;
+    return (u64)r ^ (u64)(r >> 64);
+#else
+    const u64 ha = a >> 32, la = (u32)a, hb = b >> 32, lb = (u32)b;
+    const u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const u64 t = rl + (rm0 << 32);
+    const u64 lo = t + (rm1 << 32);
+    const u64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+    return lo ^ hi;
+#endif
+}
+
+/**
+ * wyhash: whole words per step instead of FNV-1a's one multiply per byte.
+ * Identifiers are short, up to 16 bytes take two overlapping loads and
+ * two multiplies. Only bytes inside [data, data + len) are read.
+ */
+u32 strPool_hash(const char* data, const u32 len) {
+    const u64* s = _strPool_secret;
+    u64 seed = s[0], a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            const u32 mid = (len >> 3) << 2;
+            a = (_strPool_read32(data) << 32) | _strPool_read32(data + mid);
+            b = (_strPool_read32(data + len - 4) << 32) | _strPool_read32(data + len - 4 - mid);
+        } else if (len > 0) {
+            a = ((u64)(u8)data[0] << 16) | ((u64)(u8)data[len >> 1] << 8) | (u8)data[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        u32 i = len;
+        const char* p = data;
+
+        for (; i > 16; i -= 16, p += 16)
+            seed = _strPool_mix(_strPool_read64(p) ^ s[1], _strPool_read64(p + 8) ^ seed);
+
+        a = _strPool_read64(p + i - 16);
+        b = _strPool_read64(p + i - 8);
+    }
+
+    const u64 h = _strPool_mix(s[1] ^ len, _strPool_mix(a ^ s[1], b ^ seed));
+    return (u32)(h ^ (h >> 32));
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CONTROL BYTES
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Top 7 hash bits, the low bits pick the group
+static inline
+u8 _strPool_tag(const u32 hash) {
+    return (u8)(hash >> 25);
+}
+
+// Bit i set for every slot of the group whose control byte equals `tag`
+static inline
+u32 _strPool_match(const u8* group, const u8 tag) {
+#if _STRPOOL_SSE2
+    const __m128i g = _mm_loadu_si128((const __m128i*)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)tag)));
+#else
+    u32 bits = 0;
+    for (u32 i = 0; i < STRPOOL_GROUP; i++) bits |= (u32)(group[i] == tag) << i;
+    return bits;
+#endif
+}
+
+// Bit i set for every free slot of the group (control byte high bit)
+static inline
+u32 _strPool_matchEmpty(const u8* group) {
+#if _STRPOOL_SSE2
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    u32 bits = 0;
+    for (u32 i = 0; i < STRPOOL_GROUP; i++) bits |= (u32)(group[i] >> 7) << i;
+    return bits;
+#endif
+}
+
+// First group of the probe sequence, later ones follow triangular steps
+// (+1, +2, +3 groups ...) which visit every group of a power of two table
+static inline
+u32 _strPool_firstGroup(const StringPool* pool, const u32 hash) {
+    return hash & (pool->hashCapacity - 1) & ~(u32)(STRPOOL_GROUP - 1);
+}
+
+// Group holds entries of the current epoch, stale groups read as empty
+static inline
+bool _strPool_live(const StringPool* pool, const u32 group) {
+    return !pool->groupEpochs || pool->groupEpochs[group / STRPOOL_GROUP] == pool->epoch;
+}
+
+// Clears the group of `slot` if it is stale, before an entry goes in
+static inline
+void _strPool_claim(StringPool* pool, const u32 slot) {
+    const u32 group = slot & ~(u32)(STRPOOL_GROUP - 1);
+    if (_strPool_live(pool, group)) return;
+
+    memset(pool->ctrl + group, STRPOOL_EMPTY, STRPOOL_GROUP);
+    pool->groupEpochs[group / STRPOOL_GROUP] = pool->epoch;
+}
+
+// Free slot for `hash` in a table of live groups known not to hold the string
+static inline
+u32 _strPool_freeSlot(const u8* ctrl, const u32 capacity, const u32 hash) {
+    u32 group = hash & (capacity - 1) & ~(u32)(STRPOOL_GROUP - 1);
+
+    for (u32 step = STRPOOL_GROUP; ; step += STRPOOL_GROUP) {
+        const u32 empty = _strPool_matchEmpty(ctrl + group);
+        if (empty) return group + (u32)__builtin_ctz(empty);
+
+        group = (group + step) & (capacity - 1);
+    }
+}
 
-// FNV-1a hash (fast and good)
 static inline
-u32 _fnv1a_hash(const char* data, const u32 len) {
-    u32 hash = 2166136261u;
-    for (u32 i = 0; i < len; i++) {
-        hash ^= data[i];
-        hash *= 16777619;
+void _strPool_freeTable(const StringPool* pool) {
+    const Allocator* a = &pool->allocator;
+    const u32 capacity = pool->hashCapacity;
+
+    memFree(a, pool->groupEpochs, capacity / STRPOOL_GROUP * sizeof(u32));
+    memFree(a, pool->slots, capacity * sizeof(SymbolId));
+    memFree(a, pool->ctrl, capacity);
+}
+
+// Replaces the table arrays with empty ones of `capacity` slots, every
+// group stale. Entries are not carried over.
+static inline
+bool _strPool_newTable(StringPool* pool, const u32 capacity) {
+    const Allocator* a = &pool->allocator;
+    const u32 groups = capacity / STRPOOL_GROUP;
+
+    u8* ctrl = memAlloc(a, capacity);
+    SymbolId* slots = memAlloc(a, capacity * sizeof(SymbolId));
+    u32* epochs = memAlloc(a, groups * sizeof(u32));
+    if (!ctrl || !slots || !epochs) {
+        memFree(a, epochs, groups * sizeof(u32));
+        memFree(a, slots, capacity * sizeof(SymbolId));
+        memFree(a, ctrl, capacity);
+        return false;
     }
-    return hash;
+
+    _strPool_freeTable(pool);
+    memset(epochs, 0, groups * sizeof(u32));
+    pool->ctrl = ctrl;
+    pool->slots = slots;
+    pool->groupEpochs = epochs;
+    pool->hashCapacity = capacity;
+
+    // Epoch 0 marks every group stale, live epochs start at 1
+    pool->epoch = 1;
+    return true;
 }
 
 // Grow hash table when load factor exceeded
 static inline
-void _strPool_growHash(StringPool* pool) {
-    const u32 oldCapacity = pool->hashCapacity;
-    HashEntry* old_table = pool->hashTable;
+bool _strPool_growHash(StringPool* pool) {
+    const u32 newCapacity = pool->hashCapacity * 2;
 
-    // Double the hash table
-    pool->hashCapacity *= 2;
-    pool->hashTable = calloc(pool->hashCapacity, sizeof(HashEntry));
-    pool->hashLength = 0;
+    if (!_strPool_newTable(pool, newCapacity)) {
+        fprintf(stderr, "StringPool Error: Memory allocation failed during hash growing.\n");
+        return false;
+    }
 
-    // Rehash all existing entries
-    for (u32 i = 0; i < oldCapacity; i++) {
-        if (old_table[i].offset != 0) {
-            const u32 hash = old_table[i].hash;
-            u32 index = hash & (pool->hashCapacity - 1);
+    // Every group gets entries soon, clear them all at once
+    memset(pool->ctrl, STRPOOL_EMPTY, newCapacity);
+    for (u32 g = 0; g < newCapacity / STRPOOL_GROUP; g++) pool->groupEpochs[g] = pool->epoch;
 
-            // Linear probing to find empty slot
-            while (pool->hashTable[index].offset != 0) {
-                index = (index + 1) & (pool->hashCapacity - 1);
-            }
+    // Rehash from the headers, symbols are in insertion order
+    for (u32 i = 0; i < pool->hashLength; i++) {
+        const u32 hash = pool->symbols[i]->hash;
+        const u32 slot = _strPool_freeSlot(pool->ctrl, newCapacity, hash);
 
-            pool->hashTable[index].hash = hash;
-            pool->hashTable[index].offset = old_table[i].offset;
-            pool->hashLength++;
-        }
+        pool->ctrl[slot] = _strPool_tag(hash);
+        pool->slots[slot] = i + 1;
     }
 
-    free(old_table);
+    return true;
 }
 
-// Ensure space in string storage
+// Append a chunk of at least `needed` bytes, earlier chunks stay in place
 static inline
-void _strPool_ensureSpace(StringPool* pool, const u32 needed) {
-    if (pool->used + needed <= pool->capacity) return;
+bool _strPool_addChunk(StringPool* pool, const u32 needed) {
+    if (pool->chunkLength == pool->chunkSlots) {
+        const u32 slots = pool->chunkSlots ? pool->chunkSlots * 2 : 8;
+        StrPoolChunk* chunks = memResize(&pool->allocator, pool->chunks,
+            pool->chunkSlots * sizeof(StrPoolChunk), slots * sizeof(StrPoolChunk));
+        if (!chunks) return false;
+
+        pool->chunks = chunks;
+        pool->chunkSlots = slots;
+    }
 
-    // Grow string storage
-    u32 newCapacity = pool->capacity;
-    while (newCapacity < pool->used + needed) {
-        newCapacity *= 2;
+    // Strings longer than a chunk get one of their own
+    const u32 size = needed > STRPOOL_CHUNK_SIZE ? needed : STRPOOL_CHUNK_SIZE;
+    char* chunk = memAlloc(&pool->allocator, size);
+    if (!chunk) return false;
+
+    pool->chunks[pool->chunkLength++] = (StrPoolChunk) { .data = chunk, .size = size };
+    pool->chunkSize = size;
+    pool->chunkUsed = 0;
+    pool->capacity += size;
+    return true;
+}
+
+// Room for `needed` bytes at the end of the last chunk
+static inline
+char* _strPool_reserve(StringPool* pool, const u32 needed) {
+    if (pool->chunkUsed + needed > pool->chunkSize) {
+        if (!_strPool_addChunk(pool, needed)) {
+            fprintf(stderr, "StringPool Error: Memory allocation failed during chunk growing.\n");
+            return NULL;
+        }
     }
-    pool->data = realloc(pool->data, newCapacity);
-    pool->capacity = newCapacity;
+
+    char* at = pool->chunks[pool->chunkLength - 1].data + pool->chunkUsed;
+    pool->chunkUsed += needed;
+    pool->used += needed;
+    return at;
 }
 
-// Helper to get string data from header offset
 static inline
-char* _strPool_dataOfOffset(const StringPool* pool, const u32 offset) {
-    // offset points to StringHeader
-    // StringHeader->data is at offset + sizeof(StringHeader)
-    return pool->data + offset + sizeof(StringHeader);
+bool _strPool_growSymbols(StringPool* pool) {
+    const u32 capacity = pool->symbolCapacity ? pool->symbolCapacity * 2 : 64;
+
+    // Only the symbol table moves, the strings it points at do not
+    StringHeader** symbols = memResize(&pool->allocator, pool->symbols,
+        pool->symbolCapacity * sizeof(StringHeader*), capacity * sizeof(StringHeader*));
+    if (!symbols) {
+        fprintf(stderr, "StringPool Error: Memory allocation failed during symbols growing.\n");
+        return false;
+    }
+
+    pool->symbols = symbols;
+    pool->symbolCapacity = capacity;
+    return true;
 }
 
-// Helper to get string header from offset
+// Slot holding `src`, or the free slot where it would go (`found` tells which)
 static inline
-StringHeader* _strPool_headerOfOffset(const StringPool* pool, u32 const offset) {
-    return (StringHeader*)(pool->data + offset);
+u32 _strPool_slot(const StringPool* pool, const char* src, const u32 len, const u32 hash, bool* found) {
+    const u8 tag = _strPool_tag(hash);
+    u32 group = _strPool_firstGroup(pool, hash);
+
+    for (u32 step = STRPOOL_GROUP; ; step += STRPOOL_GROUP) {
+        // A stale group is empty, its first slot is free
+        if (!_strPool_live(pool, group)) {
+            *found = false;
+            return group;
+        }
+
+        const u8* ctrl = pool->ctrl + group;
+
+        // Tag matches are rare false positives apart from the real one
+        for (u32 hits = _strPool_match(ctrl, tag); hits; hits &= hits - 1) {
+            const u32 slot = group + (u32)__builtin_ctz(hits);
+            const StringHeader* h = _strPool_header(pool, pool->slots[slot]);
+
+            if (h->hash == hash && h->len == len && memCmp(h->data, src, len) == 0) {
+                *found = true;
+                return slot;
+            }
+        }
+
+        // A free slot ends the probe sequence, the load factor guarantees one
+        const u32 empty = _strPool_matchEmpty(ctrl);
+        if (empty) {
+            *found = false;
+            return group + (u32)__builtin_ctz(empty);
+        }
+
+        group = (group + step) & (pool->hashCapacity - 1);
+    }
 }
 
 // Create new string pool
 StringPool strPool_new(const u32 initialCapacity, const u32 initialHashCapacity) {
-    StringPool pool = {
-        .capacity = initialCapacity,
-        .used = 0,
-        .data = NULL,
-
-        .hashCapacity = initialHashCapacity,
-        .hashLength = 0,
-        .hashTable = NULL,
-    };
+    return strPool_newWith(initialCapacity, initialHashCapacity, mem_heap);
+}
+
+StringPool strPool_newWith(const u32 initialCapacity, const u32 initialHashCapacity, const Allocator allocator) {
+    StringPool pool = { .allocator = allocator };
+
+    // First chunk holds the planned size, later ones are fixed size
+    pool.chunks = memAlloc(&pool.allocator, 8 * sizeof(StrPoolChunk));
+    pool.chunkSlots = 8;
+
+    const u32 size = initialCapacity ? initialCapacity : STRPOOL_CHUNK_SIZE;
+    pool.chunks[0] = (StrPoolChunk) { .data = memAlloc(&pool.allocator, size), .size = size };
+    pool.chunkLength = 1;
+    pool.chunkSize = size;
+    pool.firstSize = size;
+    pool.capacity = size;
+
+    // Hash table, whole groups only
+    u32 capacity = STRPOOL_GROUP;
+    while (capacity < initialHashCapacity) capacity *= 2;
 
-    // String storage
-    pool.data = malloc(initialCapacity);
+    // Groups start stale, each is cleared when it first takes an entry
+    _strPool_newTable(&pool, capacity);
+    pool.minHashCapacity = capacity;
 
-    // Hash table
-    pool.hashTable = calloc(initialHashCapacity, sizeof(HashEntry));
+    // As many symbols as the table takes before it grows
+    pool.symbolCapacity = capacity / 8 * 7;
+    pool.symbols = memAlloc(&pool.allocator, pool.symbolCapacity * sizeof(StringHeader*));
 
     return pool;
 }
 
-// Main intern function
-str_t strPool_intern(StringPool* pool, const char* src, const u32 len) {
-    static const f32 POOL_MAX_LOAD = 0.75f;
-
-    // 1. Calculate hash
-    const u32 hash = _fnv1a_hash(src, len);
+// Pool layered over a read-only base
+StringPool strPool_overlay(const StringPool* base, const u32 initialCapacity, const u32 initialHashCapacity) {
+    StringPool pool = strPool_newWith(initialCapacity, initialHashCapacity, base->allocator);
+    pool.base = base;
+    pool.baseLength = strPool_count(base);
+    return pool;
+}
 
-    // 2. Find in hash table if it exists
-    u32 index = hash & (pool->hashCapacity - 1);
-    const u32 firstIndex = index;
-
-    while (pool->hashTable[index].offset != 0) {
-        const HashEntry* entry = &pool->hashTable[index];
-
-        // Check hash first (fast)
-        if (entry->hash == hash) {
-            // Verify with actual string comparison
-            const StringHeader* h = _strPool_headerOfOffset(pool, entry->offset);
-            if (h->len == len) {
-                char* str = _strPool_dataOfOffset(pool, entry->offset);
-                // Compare strings (slow but only when hash matches)
-                if (memCmp(str, src, len) == 0) {
-                    // Found it!
-                    return (str_t) { .data = str, .length = len };
-                }
-            }
-        }
+// Symbol of `src` in the pool or below it, SYMBOL_NONE if absent.
+// Only reads, so overlays on several threads may share a base
+static inline
+SymbolId _strPool_lookup(const StringPool* pool, const char* src, const u32 len, const u32 hash) {
+    if (pool->base) {
+        const SymbolId id = _strPool_lookup(pool->base, src, len, hash);
+        if (id != SYMBOL_NONE) return id;
+    }
 
-        // Linear probe
-        index = (index + 1) & (pool->hashCapacity - 1);
+    bool found;
+    const u32 slot = _strPool_slot(pool, src, len, hash, &found);
+    return found ? pool->baseLength + pool->slots[slot] : SYMBOL_NONE;
+}
 
-        // Prevent infinite loop if table is full (shouldn't happen with maxLoad)
-        if (index == firstIndex) break;
+// Intern with the hash already known
+static inline
+SymbolId _strPool_internHashed(StringPool* pool, const char* src, const u32 len, const u32 hash) {
+    // 1. Strings of the base keep their ids
+    if (pool->base) {
+        const SymbolId id = _strPool_lookup(pool->base, src, len, hash);
+        if (id != SYMBOL_NONE) return id;
     }
 
+    // 2. Find in hash table if it exists
+    bool found;
+    u32 slot = _strPool_slot(pool, src, len, hash, &found);
+    if (found) return pool->baseLength + pool->slots[slot];
+
     // 3. Not found - need to add new string
+    if (pool->image.data) {
+        fprintf(stderr, "StringPool Error: A loaded snapshot is read-only, intern into an overlay.\n");
+        return SYMBOL_NONE;
+    }
 
-    // Check if hash table needs to grow
-    if ((float)pool->hashLength / pool->hashCapacity >= POOL_MAX_LOAD) {
-        _strPool_growHash(pool);
+    // Grow at 7/8 load. Hits stay in their first group almost always, but
+    // near the limit (0.86 in bench-pool) half the groups are full and a
+    // miss visits ~2 groups on average; tag matches keep each visit cheap
+    if (pool->hashLength >= pool->hashCapacity / 8 * 7) {
+        if (!_strPool_growHash(pool)) return SYMBOL_NONE;
 
-        // Recalculate index for new table
-        index = hash & (pool->hashCapacity - 1);
-        while (pool->hashTable[index].offset != 0) {
-            index = (index + 1) & (pool->hashCapacity - 1);
-        }
+        // Recalculate slot for new table
+        slot = _strPool_freeSlot(pool->ctrl, pool->hashCapacity, hash);
     }
 
-    // 4. Ensure space in string storage
-    const u32 needed = sizeof(StringHeader) + len;
-    _strPool_ensureSpace(pool, needed);
+    if (pool->hashLength == pool->symbolCapacity && !_strPool_growSymbols(pool))
+        return SYMBOL_NONE;
+
+    // 4. Write string with header into the last chunk
+    StringHeader* header = (StringHeader*)_strPool_reserve(pool,
+        _STRPOOL_ALIGN((u32)sizeof(StringHeader) + len));
+    if (!header) return SYMBOL_NONE;
 
-    // 5. Write string with header
-    const u32 offset = pool->used;
-    StringHeader* header = _strPool_headerOfOffset(pool, offset);
     header->hash = hash;
     header->len = len;
+    memCopy(header->data, src, len);
 
-    // Write string data AFTER the header
-    char* stringDest = (char*)(header + 1);  // Advance past header
-    memCopy(stringDest, src, len);
+    // 5. Slots hold own entries from 1, ids follow the base's symbols.
+    //    SYMBOL_NONE is never handed out
+    pool->symbols[pool->hashLength] = header;
+    const u32 entry = ++pool->hashLength;
 
-    // 6. Update pool state
-    pool->used += needed;
+    _strPool_claim(pool, slot);
+    pool->ctrl[slot] = _strPool_tag(hash);
+    pool->slots[slot] = entry;
+    return pool->baseLength + entry;
+}
 
-    // 7. Add to hash table
-    pool->hashTable[index].hash = hash;
-    pool->hashTable[index].offset = offset;
-    pool->hashLength++;
+// Main intern function
+SymbolId strPool_internId(StringPool* pool, const char* src, const u32 len) {
+    return _strPool_internHashed(pool, src, len, strPool_hash(src, len));
+}
 
-    // 8. Return str_t pointing to string data (not header)
-    return (str_t) { .data = header->data, .length = len };
+str_t strPool_intern(StringPool* pool, const char* src, const u32 len) {
+    return strPool_get(pool, strPool_internId(pool, src, len));
+}
+
+// Direct symbol lookup without inserting
+SymbolId strPool_findId(const StringPool* pool, const char* src, const u32 len) {
+    return _strPool_lookup(pool, src, len, strPool_hash(src, len));
 }
 
-// Direct string lookup without inserting
 str_t strPool_find(const StringPool* pool, const char* src, const u32 len) {
-    const u32 hash = _fnv1a_hash(src, len);
-    u32 index = hash & (pool->hashCapacity - 1);
-    const u32 firstIndex = index;
+    return strPool_get(pool, strPool_findId(pool, src, len));
+}
 
-    while (pool->hashTable[index].offset != 0) {
-        const HashEntry* entry = &pool->hashTable[index];
-        if (entry->hash == hash) {
-            const StringHeader* h = _strPool_headerOfOffset(pool, entry->offset);
+u32 strPool_probeGroups(const StringPool* pool, const char* src, const u32 len) {
+    const u32 hash = strPool_hash(src, len);
+    const u8 tag = _strPool_tag(hash);
+    u32 group = _strPool_firstGroup(pool, hash);
 
-            if (h->len == len) {
-                const char* str = _strPool_dataOfOffset(pool, entry->offset);
+    for (u32 step = STRPOOL_GROUP, visited = 1; ; step += STRPOOL_GROUP, visited++) {
+        if (!_strPool_live(pool, group)) return visited;
 
-                if (memCmp(str, src, len) == 0) {
-                    return (str_t) { .data = str, .length = len };
-                }
-            }
+        const u8* ctrl = pool->ctrl + group;
+
+        for (u32 hits = _strPool_match(ctrl, tag); hits; hits &= hits - 1) {
+            const StringHeader* h = _strPool_header(pool, pool->slots[group + (u32)__builtin_ctz(hits)]);
+            if (h->hash == hash && h->len == len && memCmp(h->data, src, len) == 0) return visited;
         }
-        index = (index + 1) & (pool->hashCapacity - 1);
-        if (index == firstIndex) break;
+
+        if (_strPool_matchEmpty(ctrl)) return visited;
+        group = (group + step) & (pool->hashCapacity - 1);
+    }
+}
+
+// Fold an overlay's own symbols into its base, in insertion order
+bool strPool_merge(StringPool* base, const StringPool* overlay, SymbolId* remap) {
+    if (overlay->base != base) {
+        fprintf(stderr, "StringPool Error: Merging an overlay into a pool it is not layered over.\n");
+        return false;
+    }
+
+    // Headers carry the hash, nothing is hashed twice
+    for (u32 i = 0; i < overlay->hashLength; i++) {
+        const StringHeader* h = overlay->symbols[i];
+        remap[i] = _strPool_internHashed(base, h->data, h->len, h->hash);
+        if (remap[i] == SYMBOL_NONE) return false;
+    }
+
+    return true;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// SNAPSHOTS
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#define _STRPOOL_MAGIC "TSTMPOOL"
+#define _STRPOOL_VERSION 1
+#define _STRPOOL_ORDER 0x01020304u
+
+// First bytes of a snapshot, section positions are file offsets
+typedef struct StrPoolImage {
+    char magic[8];
+    u32 version;
+    u32 order;          // _STRPOOL_ORDER as the writer stored it
+    u32 hashCheck;      // strPool_hash of the magic, catches a changed hash
+    u32 symbols;
+    u32 hashCapacity;
+    u32 dataBytes;
+    u32 offsetsAt;
+    u32 ctrlAt;
+    u32 slotsAt;
+    u32 dataAt;
+} StrPoolImage;
+
+static inline
+bool _strPool_write(FILE* f, const void* data, const usize size) {
+    return size == 0 || fwrite(data, 1, size, f) == size;
+}
+
+bool strPool_save(const StringPool* pool, const char* path) {
+    if (pool->base) {
+        fprintf(stderr, "StringPool Error: Cannot save an overlay, merge it into its base first.\n");
+        return false;
     }
 
-    return str_null;
+    const u32 count = pool->hashLength;
+    const u32 capacity = pool->hashCapacity;
+
+    StrPoolImage head = {
+        .magic = _STRPOOL_MAGIC,
+        .version = _STRPOOL_VERSION,
+        .order = _STRPOOL_ORDER,
+        .hashCheck = strPool_hash(_STRPOOL_MAGIC, 8),
+        .symbols = count,
+        .hashCapacity = capacity,
+    };
+
+    // The table's sizes are multiples of 16, every section stays aligned
+    head.offsetsAt = (u32)sizeof(StrPoolImage);
+    head.ctrlAt = head.offsetsAt + count * (u32)sizeof(u32);
+    head.slotsAt = head.ctrlAt + capacity;
+    head.dataAt = head.slotsAt + capacity * (u32)sizeof(SymbolId);
+
+    // Records are packed the way the chunks pack them, offsets are from
+    // the start of the file. Control bytes are written after them
+    u32* offsets = malloc(count * sizeof(u32) + capacity);
+    if (!offsets) {
+        fprintf(stderr, "StringPool Error: Memory allocation failed during saving.\n");
+        return false;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        offsets[i] = head.dataAt + head.dataBytes;
+        head.dataBytes += _STRPOOL_ALIGN((u32)sizeof(StringHeader) + _strPool_header(pool, i + 1)->len);
+    }
+
+    // Stale groups are saved empty, a snapshot has no epochs
+    u8* ctrl = (u8*)(offsets + count);
+    for (u32 group = 0; group < capacity; group += STRPOOL_GROUP) {
+        if (_strPool_live(pool, group)) memcpy(ctrl + group, pool->ctrl + group, STRPOOL_GROUP);
+        else memset(ctrl + group, STRPOOL_EMPTY, STRPOOL_GROUP);
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "StringPool Error: Cannot open '%s' for writing.\n", path);
+        free(offsets);
+        return false;
+    }
+
+    bool ok = _strPool_write(f, &head, sizeof(head))
+        && _strPool_write(f, offsets, count * sizeof(u32) + capacity)
+        && _strPool_write(f, pool->slots, capacity * sizeof(SymbolId));
+
+    for (u32 i = 0; ok && i < count; i++) {
+        const StringHeader* h = _strPool_header(pool, i + 1);
+        const u32 size = (u32)sizeof(StringHeader) + h->len;
+        const char pad[4] = { 0 };
+
+        ok = _strPool_write(f, h, size) && _strPool_write(f, pad, _STRPOOL_ALIGN(size) - size);
+    }
+
+    free(offsets);
+    if (fclose(f) != 0) ok = false;
+
+    if (!ok) fprintf(stderr, "StringPool Error: Writing '%s' failed.\n", path);
+    return ok;
+}
+
+static inline
+StringPool _strPool_loadFailed(Source* image, const char* path, const char* reason) {
+    fprintf(stderr, "StringPool Error: Cannot load snapshot '%s': %s.\n", path, reason);
+    source_release(image);
+    return (StringPool) { 0 };
+}
+
+StringPool strPool_load(const char* path) {
+    Source image = source_mapFile(path);
+    if (image.data == NULL) return (StringPool) { 0 };
+
+    // Only the header is checked, the sections are trusted as written
+    StrPoolImage head;
+    if (image.dataLength < sizeof(head))
+        return _strPool_loadFailed(&image, path, "file is too short");
+
+    memcpy(&head, image.data, sizeof(head));
+
+    if (memcmp(head.magic, _STRPOOL_MAGIC, 8) != 0)
+        return _strPool_loadFailed(&image, path, "not a string pool snapshot");
+
+    if (head.version != _STRPOOL_VERSION || head.order != _STRPOOL_ORDER
+        || head.hashCheck != strPool_hash(_STRPOOL_MAGIC, 8))
+        return _strPool_loadFailed(&image, path, "written by an incompatible build");
+
+    const u32 capacity = head.hashCapacity;
+    if (capacity < STRPOOL_GROUP || (capacity & (capacity - 1)) != 0
+        || head.symbols > capacity / 8 * 7
+        || head.offsetsAt != sizeof(head)
+        || head.ctrlAt != head.offsetsAt + head.symbols * (u32)sizeof(u32)
+        || head.slotsAt != head.ctrlAt + capacity
+        || head.dataAt != head.slotsAt + capacity * (u32)sizeof(SymbolId)
+        || (u64)head.dataAt + head.dataBytes > image.dataLength)
+        return _strPool_loadFailed(&image, path, "sections do not fit the file");
+
+    // The table is never written, its pointers only drop const for the type
+    return (StringPool) {
+        .ctrl = (u8*)image.data + head.ctrlAt,
+        .slots = (SymbolId*)(image.data + head.slotsAt),
+        .hashCapacity = capacity,
+        .hashLength = head.symbols,
+        .offsets = (const u32*)(image.data + head.offsetsAt),
+        .image = image,
+    };
+}
+
+// Called by reset while the table still holds the finished compile
+static inline
+void _strPool_shrinkIfQuiet(StringPool* pool) {
+    if (pool->hashCapacity <= pool->minHashCapacity || pool->hashLength >= pool->hashCapacity / 16) {
+        pool->quietResets = 0;
+        pool->quietPeak = 0;
+        return;
+    }
+
+    if (pool->hashLength > pool->quietPeak) pool->quietPeak = pool->hashLength;
+    if (++pool->quietResets < pool->shrinkAfter) return;
+
+    // The table is emptied anyway, nothing to rehash
+    u32 capacity = pool->minHashCapacity;
+    while (capacity / 2 < pool->quietPeak) capacity *= 2;
+
+    pool->quietResets = 0;
+    pool->quietPeak = 0;
+
+    // Keeping the old table is fine if memory is short
+    if (!_strPool_newTable(pool, capacity)) return;
+
+    StringHeader** symbols = memResize(&pool->allocator, pool->symbols,
+        pool->symbolCapacity * sizeof(StringHeader*), capacity / 8 * 7 * sizeof(StringHeader*));
+    if (symbols) {
+        pool->symbols = symbols;
+        pool->symbolCapacity = capacity / 8 * 7;
+    }
 }
 
 // Reset pool for next compilation (reuse memory!)
 void strPool_reset(StringPool* pool) {
+    // A snapshot holds nothing of a compilation
+    if (pool->image.data) return;
+
+    // Keep the first chunk only, it carries the planned size
+    for (u32 i = 1; i < pool->chunkLength; i++)
+        memFree(&pool->allocator, pool->chunks[i].data, pool->chunks[i].size);
+
+    pool->chunkLength = 1;
+    pool->chunkSize = pool->firstSize;
+    pool->capacity = pool->firstSize;
+    pool->chunkUsed = 0;
     pool->used = 0;
+
+    // Table memory is kept for the next compile unless it is far too big
+    if (pool->shrinkAfter) _strPool_shrinkIfQuiet(pool);
+
     pool->hashLength = 0;
+    if (pool->base) pool->baseLength = strPool_count(pool->base);
 
-    // Clear hash table entries
-    memSet(pool->hashTable, 0, pool->hashCapacity * sizeof(HashEntry));
+    // Every group stale again. Once the counter wraps, epochs left in the
+    // table could match again: mark every group stale explicitly
+    if (++pool->epoch == 0) {
+        memset(pool->groupEpochs, 0, pool->hashCapacity / STRPOOL_GROUP * sizeof(u32));
+        pool->epoch = 1;
+    }
 }
 
 // Free everything in pool
 void strPool_release(const StringPool* pool) {
-    free(pool->data);
-    free(pool->hashTable);
-}
\ No newline at end of file
+    // Table and strings live in the mapping
+    if (pool->image.data) {
+        Source image = pool->image;
+        source_release(&image);
+        return;
+    }
+
+    const Allocator* a = &pool->allocator;
+    for (u32 i = 0; i < pool->chunkLength; i++) memFree(a, pool->chunks[i].data, pool->chunks[i].size);
+
+    memFree(a, pool->chunks, pool->chunkSlots * sizeof(StrPoolChunk));
+    memFree(a, pool->symbols, pool->symbolCapacity * sizeof(StringHeader*));
+    _strPool_freeTable(pool);
+}
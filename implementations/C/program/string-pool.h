@@ -2,6 +2,23 @@
 
 #include "../utils/short-types.h"
 #include "../utils/strings.h"
+#include "../utils/memory.h"
+#include "source.h"
+
+// Stable handle of an interned string, valid until the pool is reset
+typedef u32 SymbolId;
+
+// Never returned for an interned string
+#define SYMBOL_NONE ((SymbolId)0)
+
+// Size of every chunk appended once the first one is full
+#define STRPOOL_CHUNK_SIZE (64u * 1024u)
+
+// Hash slots probed at once, the hash capacity is a multiple of it
+#define STRPOOL_GROUP 16
+
+// Control byte of a free slot, used slots hold a 7-bit hash tag
+#define STRPOOL_EMPTY 0x80
 
 typedef struct StringPool StringPool;
 
@@ -12,35 +29,166 @@ typedef struct StringHeader {
     char data[];        // Points to memory AFTER header (C trick!)
 } StringHeader;
 
-// Hash table entry
-typedef struct HashEntry {
-    u32 hash;           // Full hash (0 means empty)
-    u32 offset;         // Offset in pool where string starts (includes header)
-} HashEntry;
+// One block of string data
+typedef struct StrPoolChunk {
+    char* data;
+    u32 size;
+} StrPoolChunk;
 
 struct StringPool {
-    // String data storage
-    char* data;
-    u32 used;
-    u32 capacity;
-
-    // Hash table for fast lookup
-    HashEntry* hashTable;
-    u32 hashCapacity;   // Always power of two
-    u32 hashLength;     // Number of used entries
-    f32 maxLoad;        // Typically 0.75
+    Allocator allocator;    // Chunks and tables, overlays inherit it
+
+    // String data storage. Chunks are appended, never moved, so every
+    // str_t handed out stays valid while the pool grows
+    StrPoolChunk* chunks;
+    u32 chunkLength;
+    u32 chunkSlots;     // Capacity of `chunks`
+    u32 chunkUsed;      // Bytes used in the last chunk
+    u32 chunkSize;      // Bytes of the last chunk
+    u32 firstSize;      // Bytes of the first chunk, kept across resets
+    u32 used;           // Bytes used in all chunks
+    u32 capacity;       // Bytes of all chunks
+
+    // Symbol table: header of symbol `id` at symbols[id - 1]
+    StringHeader** symbols;
+    u32 symbolCapacity;
+
+    // Hash table, SwissTable layout: one control byte per slot (empty or
+    // the top 7 hash bits) so a probe checks a whole group of slots with
+    // one compare, and the symbol of each used slot in a parallel array
+    u8* ctrl;
+    SymbolId* slots;
+    u32 hashCapacity;   // Power of two, at least STRPOOL_GROUP
+    u32 hashLength;     // Number of used entries, the symbols of this pool
+
+    // Reset bumps `epoch` instead of clearing the table: a group whose
+    // epoch differs reads as empty and is cleared when first written to.
+    // NULL for snapshots, whose groups are all current.
+    u32* groupEpochs;
+    u32 epoch;
+
+    // Shrink on reset: after `shrinkAfter` resets in a row that used under
+    // 1/16 of the table, it is cut to twice the peak those compiles
+    // needed, never below the size it was created with. 0 never shrinks.
+    u32 shrinkAfter;
+    u32 quietResets;
+    u32 quietPeak;
+    u32 minHashCapacity;
+
+    // Overlay: symbols 1..baseLength are read from `base`, which is only
+    // read, never written, while the overlay is in use. Own symbols follow
+    // from baseLength + 1. Plain pools have no base and baseLength 0.
+    const StringPool* base;
+    u32 baseLength;
+
+    // Snapshot: a pool from strPool_load reads strings and hash table
+    // straight from the mapped file. It has no chunks and `symbols` is
+    // NULL, own symbol i is at image.data + offsets[i]. Read-only.
+    const u32* offsets;
+    Source image;
 };
 
 StringPool strPool_new(u32 initialCapacity, u32 initialHashCapacity);
+StringPool strPool_newWith(u32 initialCapacity, u32 initialHashCapacity, Allocator allocator);
 
-// Pool intern function
+/**
+ * Pool layered over `base` for one thread of a parallel compile.
+ *
+ * Lookups fall through to the base without locking: the base must not be
+ * interned into until every overlay over it is merged or released. New
+ * strings go to the overlay with ids after the base's, local to it until
+ * strPool_merge gives them their final ids.
+ */
+StringPool strPool_overlay(const StringPool* base, u32 initialCapacity, u32 initialHashCapacity);
+
+// Pool intern function, returns the symbol of the string
+SymbolId strPool_internId(StringPool* pool, const char* src, u32 len);
+
+// Pool intern function, returns the pooled copy of the string
 str_t strPool_intern(StringPool* pool, const char* src, u32 len);
 
+// Pool symbol lookup without inserting (SYMBOL_NONE if absent)
+SymbolId strPool_findId(const StringPool* pool, const char* src, u32 len);
+
 // Pool string lookup without inserting
 str_t strPool_find(const StringPool* pool, const char* src, u32 len);
 
+/**
+ * Interns the own symbols of `overlay` into its base, in the order the
+ * overlay interned them, and writes the final id of own symbol i at
+ * remap[i] (overlay->hashLength entries). Base symbols keep their ids.
+ *
+ * Merging the overlays of a parallel compile in a fixed order (the order
+ * of the work, not of thread completion) gives the same ids as interning
+ * everything on one thread in that order, whatever the scheduling was.
+ */
+bool strPool_merge(StringPool* base, const StringPool* overlay, SymbolId* remap);
+
+/**
+ * Writes the strings and hash table of `pool` to `path` as a snapshot for
+ * strPool_load. Offsets replace pointers, so the file works wherever it is
+ * mapped. Symbol ids are kept. Overlays must be merged before saving.
+ *
+ * Snapshot layout (native byte order, every section 4-byte aligned):
+ *   StrPoolImage header | u32 offsets[symbols] | u8 ctrl[hashCapacity]
+ *   | SymbolId slots[hashCapacity] | string data (StringHeader records)
+ */
+bool strPool_save(const StringPool* pool, const char* path);
+
+/**
+ * Maps a snapshot written by strPool_save and uses it in place: nothing is
+ * rehashed or copied, the pool is ready once the file is mapped. Interning
+ * into it fails, layer a strPool_overlay over it for new strings.
+ *
+ * Files of another version, byte order or hash function are rejected.
+ * On failure a message goes to stderr and `ctrl` is NULL.
+ */
+StringPool strPool_load(const char* path);
+
 // Reset pool for next compilation (reuse memory!)
+// An overlay also picks up the symbols its base gained since
 void strPool_reset(StringPool* pool);
 
 // Free everything inside pool
 void strPool_release(const StringPool* pool);
+
+// Slot groups a lookup of `src` visits in the own table before it hits or
+// misses, bases not included (tuning aid)
+u32 strPool_probeGroups(const StringPool* pool, const char* src, u32 len);
+
+// Hash used by the pool, exposed for benchmarks
+u32 strPool_hash(const char* data, u32 len);
+
+// Number of symbols a pool resolves, its base's included
+static inline
+u32 strPool_count(const StringPool* pool) {
+    return pool->baseLength + pool->hashLength;
+}
+
+// Header of own symbol `entry` (from 1), on the heap or in a snapshot
+static inline
+const StringHeader* _strPool_header(const StringPool* pool, const u32 entry) {
+    if (pool->symbols) return pool->symbols[entry - 1];
+    return (const StringHeader*)(pool->image.data + pool->offsets[entry - 1]);
+}
+
+// Pooled string of a symbol, str_null for SYMBOL_NONE or unknown ids
+static inline
+str_t strPool_get(const StringPool* pool, SymbolId id) {
+    while (id <= pool->baseLength) {
+        if (id == SYMBOL_NONE) return str_null;
+        pool = pool->base;
+    }
+
+    id -= pool->baseLength;
+    if (id > pool->hashLength) return str_null;
+
+    const StringHeader* h = _strPool_header(pool, id);
+    return (str_t) { .data = h->data, .length = h->len };
+}
+
+// Final id of a symbol of `overlay` after strPool_merge filled `remap`
+static inline
+SymbolId strPool_remap(const StringPool* overlay, const SymbolId* remap, const SymbolId id) {
+    return id <= overlay->baseLength ? id : remap[id - overlay->baseLength - 1];
+}
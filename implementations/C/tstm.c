@@ -1,29 +1,168 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "error/errors.h"
 #include "error/reporter.h"
 #include "lexer/lexer.h"
+#include "parser/parser.h"
+#include "program/capacity-plan.h"
+#include "program/line-table.h"
 #include "utils/globals.h"
 
+static void printUsage(void) {
+    fprintf(stderr,
+        "Usage: tstm <file> [options]\n"
+        "\n"
+        "Lexes and parses a theme file and reports any errors.\n"
+        "\n"
+        "Options:\n"
+        "    --tokens    Print every token\n"
+        "    --stats     Compare the capacity plan with what the compile used\n"
+        "    --mem-stats Report allocations, live, peak and total bytes per subsystem\n"
+        "    --threads N Parse on N threads, 0 for one per processor (default 1)\n"
+        "    --share     Give equal subtrees one AST node, report how many were shared\n");
+}
+
+// Arena bytes for a compile that follows the plan: the token store at the
+// 1/8 headroom the lexer adds (four segment tables, the segments) and its
+// long length table, the AST, the share and name tables with --share and
+// the error list. Every allocation may be padded to ARENA_ALIGN, and the
+// block starts with a header
+static usize planArenaBytes(const CapacityPlan* plan, const u32 sourceBytes, const bool share) {
+    const usize tokens = (usize)plan->tokens + plan->tokens / 8 + 1;
+    const usize segments = (tokens + TOKSTORE_SEGMENT - 1) >> TOKSTORE_SEGMENT_BITS;
+    const u32 longs = sourceBytes / TOKSTORE_LONG;
+    const usize shareTable = share
+        ? (usize)plan->shareSlots * sizeof(AstShareSlot) + ((usize)plan->identifiers + 1) * sizeof(u32) : 0;
+    const usize allocations = 4 + segments + (longs != 0) + 3 + 2 * share + 1;
+
+    return tokstore_bytesFor(tokens)
+        + tokstore_longBytesFor(longs)
+        + (usize)plan->nodes * (sizeof(AstNode) + sizeof(u32))
+        + (usize)plan->children * sizeof(NodeId)
+        + shareTable
+        + 100 * sizeof(SourceError)
+        + (allocations + 2) * ARENA_ALIGN;
+}
+
+static void printStatsRow(const char* name, const u32 planned, const u32 actual) {
+    printf("%-14s %12u %12u   %s\n", name, planned, actual, actual <= planned ? "yes" : "NO");
+}
+
+static void printStats(const CapacityPlan* plan, const TokenStore* tl,
+    const StringPool* pool, const AstArena* ast, const LineTable* lines) {
+    printf("%-14s %12s %12s   %s\n", "capacity", "planned", "used", "fits");
+    printStatsRow("tokens", plan->tokens, (u32)tl->length);
+    printStatsRow("identifiers", plan->identifiers, pool->hashLength);
+    printStatsRow("pool bytes", plan->poolBytes, pool->used);
+    printStatsRow("pool slots", plan->poolSlots, pool->hashCapacity);
+    printStatsRow("ast nodes", plan->nodes, ast->nodeLength);
+    printStatsRow("ast children", plan->children, ast->childLength);
+    printStatsRow("lines", plan->lines, lines->length);
+
+    if (ast->shareTable) {
+        const u32 made = ast->nodeLength + ast->shareHits;
+        printf("\n%-14s %u of %u nodes shared (%.1f%%), %zu node bytes saved\n", "sharing",
+            ast->shareHits, made, made ? 100.0 * ast->shareHits / made : 0.0,
+            (size_t)ast->shareHits * (sizeof(AstNode) + sizeof(u32)));
+    }
+}
+
+// Counting allocator over `counter` when `enabled`, its inner allocator otherwise
+static Allocator countedAllocator(MemCounter* counter, const bool enabled) {
+    return enabled ? memCounter_allocator(counter) : counter->inner;
+}
+
+static void printMemRow(const MemCounter* c) {
+    printf("%-14s %8u %8u %8u %12zu %12zu %12zu\n",
+        c->name, c->allocs, c->resizes, c->frees, c->live, c->peak, c->total);
+}
+
+static void printMemStats(const MemCounter* counters, const u32 count,
+    const Arena* arena, const usize planned) {
+    printf("%-14s %8s %8s %8s %12s %12s %12s\n",
+        "memory", "allocs", "resizes", "frees", "live", "peak", "total");
+    for (u32 i = 0; i < count; i++) printMemRow(&counters[i]);
+
+    printf("\n%-14s %12s %12s %12s\n", "arena", "planned", "reserved", "used");
+    printf("%-14s %12zu %12zu %12zu\n", "bytes", planned, arena->reserved, arena->used);
+}
+
 int main(const int argc, char* argv[]) {
     initGlobals(argc, argv);
 
-    Source src = source_of(
-        "hello, world #ffe23a2\n"
-        " 123 0xffed 0b1101011 0o327316 0miior3 0moi63 12.34 1e5 6e-5 1e+10\n"
-        " === == ~== !~= ** * / /% % ^^ ^ & && | || - + \n",
-        "idk.tstm"
-    );
+    const char* path = NULL;
+    bool printTokens = false;
+    bool printPlan = false;
+    bool printMem = false;
+    bool share = false;
+    u32 threads = 1;
 
-    // TODO: replace all hardcoded values with guess based on source.
-    StringPool pool = strPool_new(1024, 1024);
-    ErrorReporter reporter = reporter_new(100, reporter_defaultPrinter,
-        REPORT_COLORED | REPORT_BREAK_ON_PUSH);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tokens") == 0) printTokens = true;
+        else if (strcmp(argv[i], "--stats") == 0) printPlan = true;
+        else if (strcmp(argv[i], "--mem-stats") == 0) printMem = true;
+        else if (strcmp(argv[i], "--share") == 0) share = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = (u32)strtoul(argv[++i], NULL, 10);
+        else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            fprintf(stderr, "Unknown option '%s'.\n\n", argv[i]);
+            printUsage();
+            cleanupGlobals();
+            return 2;
+        }
+        else path = argv[i];
+    }
 
+    if (path == NULL) {
+        printUsage();
+        cleanupGlobals();
+        return 2;
+    }
+
+    Source src = source_mapFile(path);
+    if (src.data == NULL) {
+        cleanupGlobals();
+        return 1;
+    }
+
+    // Size every arena up front so the compile does not regrow them
+    const CapacityPlan plan = plan_estimate(src.data, src.dataLength);
+
+    LineTable lines = lines_new(plan.lines);
+    src.lines = &lines;
+
+    // Tokens, AST and the error list share one arena sized from the plan,
+    // released at once when the compile is done
+    const usize arenaBytes = planArenaBytes(&plan, src.dataLength, share);
+    Arena arena = arena_new(arenaBytes);
+    const Allocator allocator = arena_allocator(&arena);
+
+    // With --mem-stats every subsystem counts on top of where its memory
+    // really comes from, without it they use that allocator directly
+    enum { MEM_TOKENS, MEM_AST, MEM_ERRORS, MEM_REPORT, MEM_POOL, MEM_COUNT };
+    MemCounter counters[MEM_COUNT] = {
+        [MEM_TOKENS] = memCounter_new("tokens", allocator),
+        [MEM_AST] = memCounter_new("ast", allocator),
+        [MEM_ERRORS] = memCounter_new("errors", allocator),
+        [MEM_REPORT] = memCounter_new("error report", mem_heap),
+        [MEM_POOL] = memCounter_new("string pool", mem_heap),
+    };
+
+    StringPool pool = strPool_newWith(plan.poolBytes, plan.poolSlots,
+        countedAllocator(&counters[MEM_POOL], printMem));
+
+    ErrorReporter reporter = reporter_newWith(100, reporter_defaultPrinter,
+        REPORT_COLORED | REPORT_BREAK_ON_PUSH, countedAllocator(&counters[MEM_ERRORS], printMem));
+
+    // The token list and the AST keep the allocator they were created with,
+    // so the program allocator is switched between the two passes
     Program program = {
         .stringPool = &pool,
         .source = &src,
         .reporter = &reporter,
+        .plan = &plan,
+        .allocator = countedAllocator(&counters[MEM_TOKENS], printMem),
     };
 
     Lexer lexer = {
@@ -31,18 +170,43 @@ int main(const int argc, char* argv[]) {
         .position = 0,
     };
 
-    const TokenList tl = Lexer_lex(&lexer);
+    const TokenStore tl = Lexer_lex(&lexer);
+
+    if (printTokens) {
+        // Each string is dropped again right after printing
+        const ArenaMark mark = arena_mark(&arena);
 
-    for (int i = 0; i < tl.length; i++) {
-        const string_t str = tok_toStringColord(tl.tokens[i]);
-        printf("%.*s\n", (int) str.length, str.data);
+        for (TokenId i = 0; i < tl.length; i++) {
+            const string_t str = tok_toStringColordWith(tokstore_at(&tl, i), &allocator);
+            printf("%.*s\n", (int) str.length, str.data);
+            arena_rewind(&arena, mark);
+        }
     }
 
-    reporter_throwIfAny(&reporter, src);
+    program.allocator = countedAllocator(&counters[MEM_AST], printMem);
+
+    Parser parser = {
+        .program = &program,
+        .tokens = tl,
+        .share = share,
+    };
+
+    // Parts parsed on other threads use the heap, only the merged tree is
+    // in the arena
+    const AstArena ast = threads == 1 ? Parser_parse(&parser) : Parser_parseParallel(&parser, threads);
+
+    // The report is output, not compile data, and its size depends on the
+    // offending lines, so it is formatted on the heap outside the plan
+    const bool failed = reporter_throwIfAnyWith(&reporter, src,
+        countedAllocator(&counters[MEM_REPORT], printMem));
+    if (printPlan) printStats(&plan, &tl, &pool, &ast, &lines);
+    if (printMem) printMemStats(counters, MEM_COUNT, &arena, arenaBytes);
 
-    toklist_release(&tl);
+    arena_release(&arena);
     strPool_release(&pool);
+    lines_release(&lines);
+    source_release(&src);
 
     cleanupGlobals();
-    return 0;
-}
\ No newline at end of file
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * @file convert-pow5.h
+ *
+ * 128-bit truncated powers of five for the Eisel-Lemire float parser
+ * in convert.h. Entry q holds the 128 most significant bits of 5^q
+ * (rounded up for negative q), for the q range a binary32 can reach
+ * from a 19-digit decimal mantissa.
+ *
+ * Generated (same scheme as the fast_float tables):
+ *   q < 0:  z = bit length of 5^-q,
+ *           c = 2^b // 5^-q + 1 with b = z + 127 (q >= -27) or 2z + 128,
+ *           then halved until it fits 128 bits
+ *   q >= 0: 5^q shifted until its top bit is bit 127
+ */
+
+#pragma once
+
+#include "short-types.h"
+
+#define CVT_POW5_MIN (-65)
+#define CVT_POW5_MAX 38
+
+// { high, low } per power, indexed by q - CVT_POW5_MIN
+static const
+u64 _cvt_pow5[CVT_POW5_MAX - CVT_POW5_MIN + 1][2] = {
+    { 0x86CCBB52EA94BAEAULL, 0x98E947129FC2B4E9ULL }, // 5^-65
+    { 0xA87FEA27A539E9A5ULL, 0x3F2398D747B36224ULL }, // 5^-64
+    { 0xD29FE4B18E88640EULL, 0x8EEC7F0D19A03AADULL }, // 5^-63
+    { 0x83A3EEEEF9153E89ULL, 0x1953CF68300424ACULL }, // 5^-62
+    { 0xA48CEAAAB75A8E2BULL, 0x5FA8C3423C052DD7ULL }, // 5^-61
+    { 0xCDB02555653131B6ULL, 0x3792F412CB06794DULL }, // 5^-60
+    { 0x808E17555F3EBF11ULL, 0xE2BBD88BBEE40BD0ULL }, // 5^-59
+    { 0xA0B19D2AB70E6ED6ULL, 0x5B6ACEAEAE9D0EC4ULL }, // 5^-58
+    { 0xC8DE047564D20A8BULL, 0xF245825A5A445275ULL }, // 5^-57
+    { 0xFB158592BE068D2EULL, 0xEED6E2F0F0D56712ULL }, // 5^-56
+    { 0x9CED737BB6C4183DULL, 0x55464DD69685606BULL }, // 5^-55
+    { 0xC428D05AA4751E4CULL, 0xAA97E14C3C26B886ULL }, // 5^-54
+    { 0xF53304714D9265DFULL, 0xD53DD99F4B3066A8ULL }, // 5^-53
+    { 0x993FE2C6D07B7FABULL, 0xE546A8038EFE4029ULL }, // 5^-52
+    { 0xBF8FDB78849A5F96ULL, 0xDE98520472BDD033ULL }, // 5^-51
+    { 0xEF73D256A5C0F77CULL, 0x963E66858F6D4440ULL }, // 5^-50
+    { 0x95A8637627989AADULL, 0xDDE7001379A44AA8ULL }, // 5^-49
+    { 0xBB127C53B17EC159ULL, 0x5560C018580D5D52ULL }, // 5^-48
+    { 0xE9D71B689DDE71AFULL, 0xAAB8F01E6E10B4A6ULL }, // 5^-47
+    { 0x9226712162AB070DULL, 0xCAB3961304CA70E8ULL }, // 5^-46
+    { 0xB6B00D69BB55C8D1ULL, 0x3D607B97C5FD0D22ULL }, // 5^-45
+    { 0xE45C10C42A2B3B05ULL, 0x8CB89A7DB77C506AULL }, // 5^-44
+    { 0x8EB98A7A9A5B04E3ULL, 0x77F3608E92ADB242ULL }, // 5^-43
+    { 0xB267ED1940F1C61CULL, 0x55F038B237591ED3ULL }, // 5^-42
+    { 0xDF01E85F912E37A3ULL, 0x6B6C46DEC52F6688ULL }, // 5^-41
+    { 0x8B61313BBABCE2C6ULL, 0x2323AC4B3B3DA015ULL }, // 5^-40
+    { 0xAE397D8AA96C1B77ULL, 0xABEC975E0A0D081AULL }, // 5^-39
+    { 0xD9C7DCED53C72255ULL, 0x96E7BD358C904A21ULL }, // 5^-38
+    { 0x881CEA14545C7575ULL, 0x7E50D64177DA2E54ULL }, // 5^-37
+    { 0xAA242499697392D2ULL, 0xDDE50BD1D5D0B9E9ULL }, // 5^-36
+    { 0xD4AD2DBFC3D07787ULL, 0x955E4EC64B44E864ULL }, // 5^-35
+    { 0x84EC3C97DA624AB4ULL, 0xBD5AF13BEF0B113EULL }, // 5^-34
+    { 0xA6274BBDD0FADD61ULL, 0xECB1AD8AEACDD58EULL }, // 5^-33
+    { 0xCFB11EAD453994BAULL, 0x67DE18EDA5814AF2ULL }, // 5^-32
+    { 0x81CEB32C4B43FCF4ULL, 0x80EACF948770CED7ULL }, // 5^-31
+    { 0xA2425FF75E14FC31ULL, 0xA1258379A94D028DULL }, // 5^-30
+    { 0xCAD2F7F5359A3B3EULL, 0x096EE45813A04330ULL }, // 5^-29
+    { 0xFD87B5F28300CA0DULL, 0x8BCA9D6E188853FCULL }, // 5^-28
+    { 0x9E74D1B791E07E48ULL, 0x775EA264CF55347EULL }, // 5^-27
+    { 0xC612062576589DDAULL, 0x95364AFE032A819EULL }, // 5^-26
+    { 0xF79687AED3EEC551ULL, 0x3A83DDBD83F52205ULL }, // 5^-25
+    { 0x9ABE14CD44753B52ULL, 0xC4926A9672793543ULL }, // 5^-24
+    { 0xC16D9A0095928A27ULL, 0x75B7053C0F178294ULL }, // 5^-23
+    { 0xF1C90080BAF72CB1ULL, 0x5324C68B12DD6339ULL }, // 5^-22
+    { 0x971DA05074DA7BEEULL, 0xD3F6FC16EBCA5E04ULL }, // 5^-21
+    { 0xBCE5086492111AEAULL, 0x88F4BB1CA6BCF585ULL }, // 5^-20
+    { 0xEC1E4A7DB69561A5ULL, 0x2B31E9E3D06C32E6ULL }, // 5^-19
+    { 0x9392EE8E921D5D07ULL, 0x3AFF322E62439FD0ULL }, // 5^-18
+    { 0xB877AA3236A4B449ULL, 0x09BEFEB9FAD487C3ULL }, // 5^-17
+    { 0xE69594BEC44DE15BULL, 0x4C2EBE687989A9B4ULL }, // 5^-16
+    { 0x901D7CF73AB0ACD9ULL, 0x0F9D37014BF60A11ULL }, // 5^-15
+    { 0xB424DC35095CD80FULL, 0x538484C19EF38C95ULL }, // 5^-14
+    { 0xE12E13424BB40E13ULL, 0x2865A5F206B06FBAULL }, // 5^-13
+    { 0x8CBCCC096F5088CBULL, 0xF93F87B7442E45D4ULL }, // 5^-12
+    { 0xAFEBFF0BCB24AAFEULL, 0xF78F69A51539D749ULL }, // 5^-11
+    { 0xDBE6FECEBDEDD5BEULL, 0xB573440E5A884D1CULL }, // 5^-10
+    { 0x89705F4136B4A597ULL, 0x31680A88F8953031ULL }, // 5^-9
+    { 0xABCC77118461CEFCULL, 0xFDC20D2B36BA7C3EULL }, // 5^-8
+    { 0xD6BF94D5E57A42BCULL, 0x3D32907604691B4DULL }, // 5^-7
+    { 0x8637BD05AF6C69B5ULL, 0xA63F9A49C2C1B110ULL }, // 5^-6
+    { 0xA7C5AC471B478423ULL, 0x0FCF80DC33721D54ULL }, // 5^-5
+    { 0xD1B71758E219652BULL, 0xD3C36113404EA4A9ULL }, // 5^-4
+    { 0x83126E978D4FDF3BULL, 0x645A1CAC083126EAULL }, // 5^-3
+    { 0xA3D70A3D70A3D70AULL, 0x3D70A3D70A3D70A4ULL }, // 5^-2
+    { 0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCDULL }, // 5^-1
+    { 0x8000000000000000ULL, 0x0000000000000000ULL }, // 5^0
+    { 0xA000000000000000ULL, 0x0000000000000000ULL }, // 5^1
+    { 0xC800000000000000ULL, 0x0000000000000000ULL }, // 5^2
+    { 0xFA00000000000000ULL, 0x0000000000000000ULL }, // 5^3
+    { 0x9C40000000000000ULL, 0x0000000000000000ULL }, // 5^4
+    { 0xC350000000000000ULL, 0x0000000000000000ULL }, // 5^5
+    { 0xF424000000000000ULL, 0x0000000000000000ULL }, // 5^6
+    { 0x9896800000000000ULL, 0x0000000000000000ULL }, // 5^7
+    { 0xBEBC200000000000ULL, 0x0000000000000000ULL }, // 5^8
+    { 0xEE6B280000000000ULL, 0x0000000000000000ULL }, // 5^9
+    { 0x9502F90000000000ULL, 0x0000000000000000ULL }, // 5^10
+    { 0xBA43B74000000000ULL, 0x0000000000000000ULL }, // 5^11
+    { 0xE8D4A51000000000ULL, 0x0000000000000000ULL }, // 5^12
+    { 0x9184E72A00000000ULL, 0x0000000000000000ULL }, // 5^13
+    { 0xB5E620F480000000ULL, 0x0000000000000000ULL }, // 5^14
+    { 0xE35FA931A0000000ULL, 0x0000000000000000ULL }, // 5^15
+    { 0x8E1BC9BF04000000ULL, 0x0000000000000000ULL }, // 5^16
+    { 0xB1A2BC2EC5000000ULL, 0x0000000000000000ULL }, // 5^17
+    { 0xDE0B6B3A76400000ULL, 0x0000000000000000ULL }, // 5^18
+    { 0x8AC7230489E80000ULL, 0x0000000000000000ULL }, // 5^19
+    { 0xAD78EBC5AC620000ULL, 0x0000000000000000ULL }, // 5^20
+    { 0xD8D726B7177A8000ULL, 0x0000000000000000ULL }, // 5^21
+    { 0x878678326EAC9000ULL, 0x0000000000000000ULL }, // 5^22
+    { 0xA968163F0A57B400ULL, 0x0000000000000000ULL }, // 5^23
+    { 0xD3C21BCECCEDA100ULL, 0x0000000000000000ULL }, // 5^24
+    { 0x84595161401484A0ULL, 0x0000000000000000ULL }, // 5^25
+    { 0xA56FA5B99019A5C8ULL, 0x0000000000000000ULL }, // 5^26
+    { 0xCECB8F27F4200F3AULL, 0x0000000000000000ULL }, // 5^27
+    { 0x813F3978F8940984ULL, 0x4000000000000000ULL }, // 5^28
+    { 0xA18F07D736B90BE5ULL, 0x5000000000000000ULL }, // 5^29
+    { 0xC9F2C9CD04674EDEULL, 0xA400000000000000ULL }, // 5^30
+    { 0xFC6F7C4045812296ULL, 0x4D00000000000000ULL }, // 5^31
+    { 0x9DC5ADA82B70B59DULL, 0xF020000000000000ULL }, // 5^32
+    { 0xC5371912364CE305ULL, 0x6C28000000000000ULL }, // 5^33
+    { 0xF684DF56C3E01BC6ULL, 0xC732000000000000ULL }, // 5^34
+    { 0x9A130B963A6C115CULL, 0x3C7F400000000000ULL }, // 5^35
+    { 0xC097CE7BC90715B3ULL, 0x4B9F100000000000ULL }, // 5^36
+    { 0xF0BDC21ABB48DB20ULL, 0x1E86D40000000000ULL }, // 5^37
+    { 0x96769950B50D88F4ULL, 0x1314448000000000ULL }, // 5^38
+};
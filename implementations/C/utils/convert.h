@@ -1,6 +1,18 @@
 #pragma once
 
 #include "short-types.h"
+#include "convert-pow5.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(TSTM_NO_SIMD) && ARCH_hasSSE2 && defined(__SSE2__)
+#   include <emmintrin.h>
+#   define CVT_SSE2 1
+#else
+#   define CVT_SSE2 0
+#endif
 
 // ================================
 // UTILITY FUNCTIONS
@@ -141,6 +153,57 @@ ArgbColor cvt_hexToColorARGB(const u32 value) {
     return value;
 }
 
+/**
+ * Expands `count` already decoded hex digits to ARGB,
+ * following the same digit-count rules as cvt_hexStrToColor:
+ * - 1 digit  C        -> 0xFFCCCCCC
+ * - 2 digits CA       -> 0xAACCCCCC
+ * - 3 digits RGB      -> 0xFFRRGGBB
+ * - 4 digits RGBA     -> 0xAARRGGBB
+ * - 6 digits RRGGBB   -> 0xFFRRGGBB
+ * - 8 digits RRGGBBAA -> 0xAARRGGBB
+ * Any other count gives 0.
+ */
+static inline
+ArgbColor cvt_hexDigitsToColor(const u32 value, const u32 count) {
+    switch (count) {
+        case 1: {
+            const u32 c = (value & 0xF) * 0x11;
+            return 0xFF000000 | (c << 16) | (c << 8) | c;
+        }
+
+        case 2: {
+            const u32 c = ((value >> 4) & 0xF) * 0x11;
+            const u32 a = (value & 0xF) * 0x11;
+            return (a << 24) | (c << 16) | (c << 8) | c;
+        }
+
+        case 3: {
+            const u32 r = ((value >> 8) & 0xF) * 0x11;
+            const u32 g = ((value >> 4) & 0xF) * 0x11;
+            const u32 b = (value & 0xF) * 0x11;
+            return 0xFF000000 | (r << 16) | (g << 8) | b;
+        }
+
+        case 4: {
+            const u32 r = ((value >> 12) & 0xF) * 0x11;
+            const u32 g = ((value >> 8) & 0xF) * 0x11;
+            const u32 b = ((value >> 4) & 0xF) * 0x11;
+            const u32 a = (value & 0xF) * 0x11;
+            return (a << 24) | (r << 16) | (g << 8) | b;
+        }
+
+        case 6:
+            return 0xFF000000 | (value & 0xFFFFFF);
+
+        case 8:
+            return (value << 24) | (value >> 8);
+
+        default:
+            return 0;
+    }
+}
+
 // ================================
 // STRING TO ARGB COLOR
 // ================================
@@ -363,8 +426,11 @@ ArgbColor cvt_hexStrToColorARGB(const char* str, const usize len, bool* success)
 // INTEGER CONVERSIONS
 // ================================
 
+// One character per iteration. Reference behavior for the SWAR
+// versions below, and their fallback for very long literals.
+
 static inline
-i32 cvt_binToInt(const char* str, const usize len) {
+i32 _cvt_binToIntScalar(const char* str, const usize len) {
     if (!str || len == 0) return 0;
 
     i32 result = 0;
@@ -397,7 +463,7 @@ i32 cvt_binToInt(const char* str, const usize len) {
 }
 
 static inline
-i32 cvt_octToInt(const char* str, const usize len) {
+i32 _cvt_octToIntScalar(const char* str, const usize len) {
     if (!str || len == 0) return 0;
 
     i32 result = 0;
@@ -577,7 +643,7 @@ u64 cvt_maskToInt(const char* str, const usize len) {
 }
 
 static inline
-i32 cvt_hexToInt(const char* str, const usize len) {
+i32 _cvt_hexToIntScalar(const char* str, const usize len) {
     if (!str || len == 0) return 0;
 
     i32 result = 0;
@@ -610,7 +676,7 @@ i32 cvt_hexToInt(const char* str, const usize len) {
 }
 
 static inline
-i32 cvt_decimalToInt(const char* str, const usize len) {
+i32 _cvt_decimalToIntScalar(const char* str, const usize len) {
     if (!str || len == 0) return 0;
 
     i32 result = 0;
@@ -643,161 +709,630 @@ i32 cvt_decimalToInt(const char* str, const usize len) {
 }
 
 // ================================
-// FLOAT CONVERSIONS
+// SWAR INTEGER DECODING
 // ================================
+//
+// The digit run is read 8 bytes at a time into a u64 (16 with SSE2 for
+// hex and binary) and folded into an accumulator one block per step.
+// '_' separators are squeezed out of a block without a branch per byte.
+// The u64 holds the first character in its lowest byte, so this path is
+// little endian only.
+
+#define CVT_SWAR OS_LITTLE_ENDIAN
+
+#define _CVT_REP(b) (0x0101010101010101ULL * (u8)(b))
 
 static inline
-f32 cvt_floatToFloat(const char* str, const usize len) {
-    if (!str || len == 0) return 0.0f;
+u64 _cvt_load8(const char* p) {
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
 
-    f32 result = 0.0f;
-    f32 sign = 1.0f;
-    usize i = 0;
+// Up to 8 bytes of `str[i..len)`, zero filled past `len`
+static inline
+u64 _cvt_loadTail(const char* str, const usize i, const usize len) {
+    if (i + 8 <= len) return _cvt_load8(str + i);
+    if (i >= len) return 0;
+
+    const char* p = str + i;
+    const u32 rest = (u32)(len - i);
+
+    // 4..7 bytes: two overlapping 4-byte loads
+    if (rest >= 4) {
+        u32 lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + rest - 4, 4);
+        return (u64)lo | (u64)hi << (8 * (rest - 4));
+    }
 
-    // Handle sign
-    if (str[0] == '-') {
-        sign = -1.0f;
-        i++;
-    } else if (str[0] == '+') {
-        i++;
+    // 1..3 bytes: first, middle and last (some may coincide)
+    return (u64)(u8)p[0]
+        | (u64)(u8)p[rest / 2] << (8 * (rest / 2))
+        | (u64)(u8)p[rest - 1] << (8 * (rest - 1));
+}
+
+// 0x80 in every byte of `x` within [lo, hi]. Bytes must be < 0x80
+static inline
+u64 _cvt_swarInRange(const u64 x, const u8 lo, const u8 hi) {
+    return (x + _CVT_REP(0x80 - lo)) & ~(x + _CVT_REP(0x7F - hi)) & _CVT_REP(0x80);
+}
+
+// 0x80 in every byte of `x` that is a digit of `base`
+static inline
+u64 _cvt_swarDigits(const u64 x, const u32 base) {
+    const u64 ascii = ~x & _CVT_REP(0x80);
+    const u64 low = x & _CVT_REP(0x7F);
+
+    switch (base) {
+        case 2:  return ascii & _cvt_swarInRange(low, '0', '1');
+        case 8:  return ascii & _cvt_swarInRange(low, '0', '7');
+        case 10: return ascii & _cvt_swarInRange(low, '0', '9');
+        default: return ascii & (_cvt_swarInRange(low, '0', '9')
+                    | _cvt_swarInRange(low | _CVT_REP(0x20), 'a', 'f'));
     }
+}
 
-    // Parse integer part
-    bool has_digits = false;
-    while (i < len) {
-        const char c = str[i];
-        if (c == '_') {
-            i++;
-            continue;
-        }
+// 0x80 in every byte of `x` that is a '_' separator
+static inline
+u64 _cvt_swarSeparators(const u64 x) {
+    return ~x & _CVT_REP(0x80) & _cvt_swarInRange(x & _CVT_REP(0x7F), '_', '_');
+}
 
-        if (c == '.') {
-            i++;
-            break;
-        }
+// Bytes of a block that still belong to the run (before the first byte
+// that is neither digit nor separator), all ones when the block is full
+static inline
+u64 _cvt_runMask(const u64 digits, const u64 separators) {
+    const u64 stop = ~(digits | separators) & _CVT_REP(0x80);
+    return stop ? (stop & (0 - stop)) - 1 : ~0ULL;
+}
 
-        if (!_cvt_isDigit(c)) break;
-        has_digits = true;
-        result = result * 10.0f + (f32)(c - '0');
-        i++;
+// Number of 0x80 bytes in a class mask (byte sum by multiply, no popcnt needed)
+static inline
+u32 _cvt_swarCount(const u64 mask) {
+    return (u32)(((mask >> 7) * _CVT_REP(1)) >> 56);
+}
+
+// Drops the separator bytes flagged in `separators`, moving the rest of
+// the block down. One shift-and-merge per separator, none per digit
+static inline
+u64 _cvt_squeeze(u64 x, u64 separators) {
+    while (separators) {
+        const u64 below = (separators & (0 - separators)) >> 7;     // 0x01 at the separator
+        const u64 low = below - 1;                                 // bytes in front of it
+        x = (x & low) | ((x >> 8) & ~low);
+        separators = (separators & ~(below << 7)) >> 8;
     }
 
-    // Parse fractional part
-    if (i < len && str[i-1] == '.') {
-        f32 fraction = 0.0f;
-        f32 divisor = 1.0f;
+    return x;
+}
 
-        for (; i < len; i++) {
-            const char c = str[i];
-            if (c == '_') continue;
+// `n` (0..8) digits in the low bytes of `x` as one group, left padded with '0'.
+// Shifts are split in two so n = 0 and n = 8 stay defined without a branch
+static inline
+u64 _cvt_padGroup(const u64 x, const u32 n) {
+    const u32 half = 32 - 4 * n;
+    return (x << half << half) | (_CVT_REP('0') >> (4 * n) >> (4 * n));
+}
 
-            if (!_cvt_isDigit(c)) break;
+// 8 decimal digits -> value
+static inline
+u32 _cvt_swarDec8(u64 x) {
+    x -= _CVT_REP('0');
+    x = (x * 10 + (x >> 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x * 100 + (x >> 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x * 10000 + (x >> 32)) & 0xFFFFFFFFULL;
+    return (u32)x;
+}
 
-            has_digits = true;
-            fraction = fraction * 10.0f + (f32)(c - '0');
-            divisor *= 10.0f;
-        }
+// 8 hex digits -> value
+static inline
+u32 _cvt_swarHex8(u64 x) {
+    // '0'-'9' -> 0-9, 'a'-'f' and 'A'-'F' -> 10-15 (bit 6 marks a letter)
+    x = (x & _CVT_REP(0x0F)) + ((x >> 6) & _CVT_REP(0x01)) * 9;
+    x = ((x << 4) | (x >> 8)) & 0x00FF00FF00FF00FFULL;
+    x = ((x << 8) | (x >> 16)) & 0x0000FFFF0000FFFFULL;
+    x = ((x << 16) | (x >> 32)) & 0xFFFFFFFFULL;
+    return (u32)x;
+}
+
+// 8 octal digits -> 24-bit value
+static inline
+u32 _cvt_swarOct8(u64 x) {
+    x -= _CVT_REP('0');
+    x = ((x << 3) | (x >> 8)) & 0x00FF00FF00FF00FFULL;
+    x = ((x << 6) | (x >> 16)) & 0x0000FFFF0000FFFFULL;
+    x = ((x << 12) | (x >> 32)) & 0xFFFFFFULL;
+    return (u32)x;
+}
+
+// 8 binary digits -> byte, gathered by one multiply (first digit -> bit 7)
+static inline
+u32 _cvt_swarBin8(const u64 x) {
+    return (u32)(((x - _CVT_REP('0')) * 0x8040201008040201ULL) >> 56);
+}
 
-        result += fraction / divisor;
+// Appends a padded group of `n` digits to `acc` (base 2, 8 or 16)
+static inline
+u64 _cvt_foldGroup(const u64 acc, const u64 group, const u32 n, const u32 base) {
+    switch (base) {
+        case 2:  return acc << n | _cvt_swarBin8(group);
+        case 8:  return acc << (3 * n) | _cvt_swarOct8(group);
+        default: return acc << (4 * n) | _cvt_swarHex8(group);
     }
+}
 
-    // If no digits were found, return 0
-    if (!has_digits) return 0.0f;
+#if CVT_SSE2
 
-    return sign * result;
+// 16 binary digits -> 16-bit value
+static inline
+u32 _cvt_sseBin16(const char* p) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+
+    // Reverse the bytes so the first digit ends up in the top mask bit
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+    // '1' has bit 0 set, '0' does not
+    return (u32)_mm_movemask_epi8(_mm_slli_epi16(v, 7));
 }
 
+// Digit mask of 16 bytes, for base 2 or 16
 static inline
-f32 cvt_expToFloat(const char* str, const usize len) {
-    if (!str || len == 0) return 0.0f;
+u32 _cvt_sseDigits16(const char* p, const u32 base) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)p);
+
+    if (base == 2) {
+        return (u32)_mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('0')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('1'))));
+    }
 
-    f32 mantissa = 0.0f;
-    f32 sign = 1.0f;
+    // Signed compares: bytes >= 0x80 are negative and never match
+    const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    return (u32)_mm_movemask_epi8(_mm_or_si128(
+        _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                      _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1))),
+        _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                      _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)))));
+}
+
+#endif
+
+/**
+ * Folds the digit run at `str[i..len)` into a u64, wrapping like the
+ * scalar loops do. The run ends at the first byte that is neither a digit
+ * of `base` nor a '_' separator. `count` receives the number of digits.
+ * Without `squeeze` (bases up to 10 only) the first block holding a
+ * separator ends the SWAR steps and the rest goes one byte at a time.
+ */
+static inline
+u64 _cvt_swarRun(const char* str, usize i, const usize len, const u32 base, const bool squeeze,
+                 u32* count) {
+    u64 acc = 0;
+    u32 total = 0;
+
+#if CVT_SSE2
+    // Long separator-free runs: 16 digits per step
+    if (base == 2 || base == 16) {
+        while (i + 16 <= len && _cvt_sseDigits16(str + i, base) == 0xFFFF) {
+            acc = base == 2
+                ? acc << 16 | _cvt_sseBin16(str + i)
+                : _cvt_swarHex8(_cvt_load8(str + i + 8)); // 64 bits shifted in, only the last 8 digits remain
+            total += 16;
+            i += 16;
+        }
+    }
+#endif
+
+    for (;;) {
+        u64 x = _cvt_loadTail(str, i, len);
+        const u64 digits = _cvt_swarDigits(x, base);
+
+        // Whole block of digits: nothing to mask, count or pad
+        if (digits == _CVT_REP(0x80)) {
+            acc = _cvt_foldGroup(acc, x, 8, base);
+            total += 8;
+            if (i + 8 >= len) break;
+            i += 8;
+            continue;
+        }
+
+        const u64 separators = _cvt_swarSeparators(x);
+        const u64 run = _cvt_runMask(digits, separators);
+        const u32 n = _cvt_swarCount(digits & run);
+
+        if (separators & run) {
+            if (!squeeze) {
+                for (; i < len; i++) {
+                    const u32 d = (u32)(str[i] - '0');
+                    if (str[i] == '_') continue;
+                    if (d >= base) break;
+
+                    acc = acc * base + d;
+                    total++;
+                }
+
+                break;
+            }
+
+            x = _cvt_squeeze(x, separators & run);
+        }
+
+        acc = _cvt_foldGroup(acc, _cvt_padGroup(x, n), n, base);
+        total += n;
+
+        if (run != ~0ULL || i + 8 >= len) break;
+        i += 8;
+    }
+
+    *count = total;
+    return acc;
+}
+
+// Sign and optional "0<p>" prefix shared by the integer parsers
+static inline
+usize _cvt_intPrefix(const char* str, const usize len, const char prefix, bool* negative) {
     usize i = 0;
+    *negative = false;
 
-    // Handle overall sign
     if (str[0] == '-') {
-        sign = -1.0f;
+        *negative = true;
         i++;
     } else if (str[0] == '+') {
         i++;
     }
 
-    // Parse mantissa (can be float)
-    bool has_mantissa_digits = false;
-    bool in_fraction = false;
-    f32 fraction_multiplier = 1.0f;
+    if (prefix && len - i >= 2 && str[i] == '0' &&
+        (str[i+1] == prefix || str[i+1] == prefix - 'a' + 'A')) {
+        i += 2;
+    }
 
-    for (; i < len; i++) {
-        const char c = str[i];
-        if (c == '_') continue;
+    return i;
+}
+
+// Shift-based parsers keep the low 32 bits of the folded run. Runs
+// shorter than `minLength` bytes take `scalar`, whose loop is cheaper there
+static inline
+i32 _cvt_swarShiftInt(const char* str, const usize len, const char prefix, const u32 base,
+                      const usize minLength, const bool squeeze, i32 (*scalar)(const char*, usize)) {
+    bool negative;
+    u32 count;
+    const usize i = _cvt_intPrefix(str, len, prefix, &negative);
+    if (len - i < minLength) return scalar(str, len);
+
+    const u32 result = (u32)_cvt_swarRun(str, i, len, base, squeeze, &count);
+    return negative ? (i32)(0u - result) : (i32)result;
+}
+
+static inline
+i32 cvt_binToInt(const char* str, const usize len) {
+    if (!str || len == 0) return 0;
 
-        // Move past 'e'
-        if (c == 'e' || c == 'E') { i++; break;}
+#if CVT_SWAR
+    // Separated masks ("0b1111_0000") pay a squeeze per group and lose to
+    // the scalar loop, which skips a '_' for free
+    return _cvt_swarShiftInt(str, len, 'b', 2, 8, false, _cvt_binToIntScalar);
+#else
+    return _cvt_binToIntScalar(str, len);
+#endif
+}
 
-        if (c == '.') {
-            in_fraction = true;
-            continue;
+// Octal literals fit at most 11 digits in an i32, too few for the SWAR
+// run to beat the scalar loop at any length (bench-convert)
+static inline
+i32 cvt_octToInt(const char* str, const usize len) {
+    if (!str || len == 0) return 0;
+
+    return _cvt_octToIntScalar(str, len);
+}
+
+static inline
+i32 cvt_hexToInt(const char* str, const usize len) {
+    if (!str || len == 0) return 0;
+
+#if CVT_SWAR
+    // Even a short hex run beats the per-character letter branches
+    return _cvt_swarShiftInt(str, len, 'x', 16, 0, true, _cvt_hexToIntScalar);
+#else
+    return _cvt_hexToIntScalar(str, len);
+#endif
+}
+
+static inline
+i32 cvt_decimalToInt(const char* str, const usize len) {
+    if (!str || len == 0) return 0;
+
+#if CVT_SWAR
+    bool negative;
+    const usize i = _cvt_intPrefix(str, len, 0, &negative);
+
+    // Only a plain 8-digit block pays off: shorter runs have the shorter
+    // chain in the scalar loop, and separated ones are rare in decimals
+    if (len - i >= 8) {
+        const u64 x = _cvt_load8(str + i);
+
+        if (_cvt_swarDigits(x, 10) == _CVT_REP(0x80)) {
+            // 8 digits cannot reach the overflow check, the rest take the
+            // scalar loop's saturate-or-wrap steps one digit at a time
+            u32 result = _cvt_swarDec8(x);
+
+            for (usize j = i + 8; j < len; j++) {
+                const char c = str[j];
+                if (c == '_') continue;
+                if (!_cvt_isDigit(c)) break;
+
+                if ((i32)result > (INT32_MAX / 10))
+                    return negative ? INT32_MIN : INT32_MAX;
+                result = result * 10 + (u32)(c - '0');
+            }
+
+            return negative ? (i32)(0u - result) : (i32)result;
         }
+    }
+#endif
+
+    return _cvt_decimalToIntScalar(str, len);
+}
+
+// ================================
+// FLOAT CONVERSIONS
+// ================================
+//
+// Decimal literals are reduced to `w * 10^q` with w holding at most 19
+// significant digits, then converted with correct rounding:
+// - Clinger's fast path when w and 10^|q| are both exact in f32,
+// - Eisel-Lemire otherwise: one (rarely two) 64x128-bit multiplies
+//   against a truncated power of five, which is always sufficient for an
+//   exact w (Mushtak & Lemire, "Fast number parsing without fallback"),
+// - strtof on the cleaned text when digits past the 19th were dropped and
+//   w and w + 1 round differently.
+
+// Powers of ten exact in f32, for Clinger's fast path
+static const
+f32 _cvt_pow10f[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+// 64x64 -> 128-bit product, high half returned
+static inline
+u64 _cvt_mul128(const u64 a, const u64 b, u64* low) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 r = (unsigned __int128)a * b;
+    *low = (u64)r;
+    return (u64)(r >> 64);
+#else
+    const u64 aLo = (u32)a, aHi = a >> 32;
+    const u64 bLo = (u32)b, bHi = b >> 32;
+    const u64 ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+    const u64 mid = (ll >> 32) + (u32)lh + (u32)hl;
+
+    *low = (mid << 32) | (u32)ll;
+    return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+static inline
+f32 _cvt_f32FromBits(const u32 bits) {
+    f32 f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/**
+ * Eisel-Lemire for binary32: correctly rounded `w * 10^q`.
+ * Expects w != 0 and CVT_POW5_MIN <= q <= CVT_POW5_MAX.
+ */
+static inline
+u32 _cvt_eiselLemire32(u64 w, const i32 q) {
+    enum { MANTISSA_BITS = 23, MIN_EXPONENT = -127, INF_POWER = 0xFF };
+
+    const u32 lz = (u32)__builtin_clzll(w);
+    w <<= lz;
+
+    // Product with the truncated 5^q, refined with the low 64 bits of the
+    // power only when the bits below the needed precision are all ones
+    const u64* pow5 = _cvt_pow5[q - CVT_POW5_MIN];
+    const u64 precisionMask = ~0ULL >> (MANTISSA_BITS + 3);
+
+    u64 low;
+    u64 high = _cvt_mul128(w, pow5[0], &low);
+
+    if ((high & precisionMask) == precisionMask) {
+        u64 low2;
+        const u64 high2 = _cvt_mul128(w, pow5[1], &low2);
+        low += high2;
+        if (high2 > low) high++;
+    }
+
+    const u32 upper = (u32)(high >> 63);
+    const u32 shift = upper + 64 - MANTISSA_BITS - 3;
+    u64 mantissa = high >> shift;
+
+    // floor(log2(10^q)) + 63, then biased
+    i32 power2 = ((((152170 + 65536) * q) >> 16) + 63) + (i32)upper - (i32)lz - MIN_EXPONENT;
 
-        if (!_cvt_isDigit(c)) return sign * mantissa;
+    // Subnormal
+    if (power2 <= 0) {
+        if (-power2 + 1 >= 64) return 0;
 
-        has_mantissa_digits = true;
-        if (in_fraction) {
-            fraction_multiplier *= 0.1f;
-            mantissa = mantissa + (f32)(c - '0') * fraction_multiplier;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+
+        // Rounding up may carry into the smallest normal
+        power2 = mantissa < (1ULL << MANTISSA_BITS) ? 0 : 1;
+        return (u32)power2 << MANTISSA_BITS | (u32)(mantissa & ((1ULL << MANTISSA_BITS) - 1));
+    }
+
+    // Exactly halfway between two floats: round to even. Only small q can
+    // produce an exact product, which `low <= 1` detects
+    if (low <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1) {
+        if ((mantissa << shift) == high) mantissa &= ~1ULL;
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+
+    if (mantissa >= (2ULL << MANTISSA_BITS)) {
+        mantissa = 1ULL << MANTISSA_BITS;
+        power2++;
+    }
+
+    if (power2 >= INF_POWER) return (u32)INF_POWER << MANTISSA_BITS;
+
+    return (u32)power2 << MANTISSA_BITS | (u32)(mantissa & ((1ULL << MANTISSA_BITS) - 1));
+}
+
+/**
+ * Correctly rounded `mantissa * 10^exp10` as a float.
+ * Used directly by the lexer, which collects the decimal digits and
+ * exponent while it validates a literal, so the text is never parsed twice.
+ * `mantissa` must be exact: at most 19 digits, nothing dropped.
+ */
+static inline
+f32 cvt_decimalPartsToFloat(const u64 mantissa, const i32 exp10) {
+    if (mantissa == 0 || exp10 < CVT_POW5_MIN) return 0.0f;
+    if (exp10 > CVT_POW5_MAX) return _cvt_f32FromBits(0x7F800000);
+
+#if FLT_EVAL_METHOD == 0
+    // Clinger: both operands exact, so one IEEE operation rounds once
+    if (mantissa <= (1u << 24) && exp10 >= -10 && exp10 <= 10) {
+        const f32 value = (f32)mantissa;
+        return exp10 < 0 ? value / _cvt_pow10f[-exp10] : value * _cvt_pow10f[exp10];
+    }
+#endif
+
+    return _cvt_f32FromBits(_cvt_eiselLemire32(mantissa, exp10));
+}
+
+// Decimal literal reduced to `mantissa * 10^exp10`
+typedef struct CvtDecimal {
+    u64 mantissa;       // first 19 significant digits
+    i32 exp10;
+    bool negative;
+    bool truncated;     // non-zero digits past the 19th were dropped
+    bool valid;         // at least one mantissa digit
+    usize end;          // bytes consumed
+} CvtDecimal;
+
+// One digit run of a decimal mantissa. Fraction digits lower the exponent
+// when kept, integer digits raise it when dropped
+static inline
+usize _cvt_scanDigits(const char* str, usize i, const usize len, const bool fraction, CvtDecimal* d) {
+    for (; i < len; i++) {
+        const u32 digit = (u32)(u8)str[i] - '0';
+
+        if (digit > 9) {
+            if (str[i] == '_') continue;
+            break;
+        }
+
+        d->valid = true;
+
+        // Below 10^18 one more digit still fits: keeps 19 significant digits
+        if (d->mantissa < 1000000000000000000ULL) {
+            d->mantissa = d->mantissa * 10 + digit;
+            d->exp10 -= fraction;
         } else {
-            mantissa = mantissa * 10.0f + (f32)(c - '0');
+            d->exp10 += !fraction;
+            d->truncated |= digit != 0;
         }
     }
 
-    // If no mantissa digits, return 0
-    if (!has_mantissa_digits) return 0.0f;
+    return i;
+}
 
-    // Parse exponent if present
-    if (i < len) {
-        i32 exponent = 0;
-        i32 exp_sign = 1;
+/**
+ * Reads `[+-]digits[.digits]` and, when `allowExp` is set, `[eE][+-]digits`.
+ * '_' separators are skipped anywhere in the digits. Stops at the first
+ * byte that does not fit, like the lexer does.
+ */
+static inline
+CvtDecimal cvt_scanDecimal(const char* str, const usize len, const bool allowExp) {
+    CvtDecimal d = { 0 };
+    usize i = 0;
 
-        // Handle exponent sign
-        if (str[i] == '-') {
-            exp_sign = -1;
-            i++;
-        } else if (str[i] == '+') {
-            i++;
-        }
+    if (i < len && (str[i] == '-' || str[i] == '+'))
+        d.negative = str[i++] == '-';
 
-        // Parse exponent digits
-        bool has_exp_digits = false;
-        for (; i < len; i++) {
-            const char c = str[i];
-            if (c == '_') continue;
+    i = _cvt_scanDigits(str, i, len, false, &d);
+    if (i < len && str[i] == '.')
+        i = _cvt_scanDigits(str, i + 1, len, true, &d);
 
-            if (!_cvt_isDigit(c)) break;
-            has_exp_digits = true;
+    d.end = i;
+    if (!allowExp || !d.valid || i >= len || (str[i] != 'e' && str[i] != 'E'))
+        return d;
 
-            // Check for overflow
-            if (exponent > (INT32_MAX / 10)) {
-                // Exponent too large, handle gracefully
-                exponent = INT32_MAX;
-                break;
-            }
-            exponent = exponent * 10 + (c - '0');
-        }
+    bool expNegative = false;
+    i32 exponent = 0;
+    bool any = false;
 
-        // Apply exponent if we have digits
-        if (has_exp_digits) {
-            const i32 exp_value = exp_sign * exponent;
+    i++;
+    if (i < len && (str[i] == '-' || str[i] == '+'))
+        expNegative = str[i++] == '-';
 
-            // Apply 10^exp_value to mantissa
-            if (exp_value > 0) {
-                for (i32 e = 0; e < exp_value; e++) mantissa *= 10.0f;
+    for (; i < len; i++) {
+        const char c = str[i];
+        if (c == '_') continue;
+        if (!_cvt_isDigit(c)) break;
 
-            } else if (exp_value < 0) {
-                for (i32 e = 0; e > exp_value; e--) mantissa *= 0.1f;
-            }
-        }
+        // Anything this large is already inf or 0
+        if (exponent < 100000) exponent = exponent * 10 + (c - '0');
+        any = true;
+    }
+
+    if (any) {
+        d.exp10 += expNegative ? -exponent : exponent;
+        d.end = i;
     }
 
-    return sign * mantissa;
+    return d;
+}
+
+// Slow path: strtof on the literal without its separators
+static inline
+f32 _cvt_strtofClean(const char* str, const usize len) {
+    char stack[128];
+    char* buf = len < sizeof(stack) ? stack : malloc(len + 1);
+    if (!buf) return 0.0f;
+
+    usize n = 0;
+    for (usize i = 0; i < len; i++)
+        if (str[i] != '_') buf[n++] = str[i];
+    buf[n] = '\0';
+
+    const f32 value = strtof(buf, NULL);
+    if (buf != stack) free(buf);
+    return value;
+}
+
+/**
+ * Correctly rounded float of a scanned decimal. `str` is the text it came
+ * from, only read again when dropped digits make the rounding ambiguous.
+ */
+static inline
+f32 cvt_decimalToFloat(const CvtDecimal d, const char* str) {
+    if (!d.valid) return 0.0f;
+
+    f32 value = cvt_decimalPartsToFloat(d.mantissa, d.exp10);
+
+    // The true value lies between w and w + 1 (times 10^q):
+    // if both round the same way, so does it
+    if (d.truncated && value != cvt_decimalPartsToFloat(d.mantissa + 1, d.exp10))
+        return _cvt_strtofClean(str, d.end);
+
+    return d.negative ? -value : value;
+}
+
+static inline
+f32 cvt_floatToFloat(const char* str, const usize len) {
+    if (!str || len == 0) return 0.0f;
+    return cvt_decimalToFloat(cvt_scanDecimal(str, len, false), str);
+}
+
+static inline
+f32 cvt_expToFloat(const char* str, const usize len) {
+    if (!str || len == 0) return 0.0f;
+    return cvt_decimalToFloat(cvt_scanDecimal(str, len, true), str);
 }
@@ -1,6 +1,7 @@
 #include "globals.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifdef _WIN32
     #include <windows.h>
@@ -10,6 +11,11 @@
 #else
     #include <unistd.h>
     #include <limits.h>
+    #ifdef PATH_MAX
+        #define _G_PATH_MAX PATH_MAX
+    #else
+        #define _G_PATH_MAX 4096
+    #endif
 #endif
 
 // Define the actual storage for the extern variables
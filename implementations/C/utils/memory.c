@@ -3,6 +3,19 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if OS_isWINDOWS
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#endif
+
+#if !defined(TSTM_NO_SIMD) && ARCH_hasSSE2 && defined(__SSE2__)
+#   include <emmintrin.h>
+#   define MEM_SSE2 1
+#else
+#   define MEM_SSE2 0
+#endif
+
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
    Core Memory Primitives
    ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -30,19 +43,33 @@ void memSwap(void* a, void* b, usize size) {
     u8* p1 = (u8*)a;
     u8* p2 = (u8*)b;
 
-    // Use the largest natural word size possible
+#if MEM_SSE2
+    while (size >= 16) {
+        const __m128i tmp = _mm_loadu_si128((const __m128i*)p1);
+        _mm_storeu_si128((__m128i*)p1, _mm_loadu_si128((const __m128i*)p2));
+        _mm_storeu_si128((__m128i*)p2, tmp);
+        p1 += 16; p2 += 16; size -= 16;
+    }
+#endif
+
+    // Use the largest natural word size possible, unaligned accesses go
+    // through memcpy
 #if ARCH_is64BIT
     while (size >= 8) {
-        const u64 tmp = *(u64*)p1;
-        *(u64*)p1 = *(u64*)p2;
-        *(u64*)p2 = tmp;
+        u64 tmp1, tmp2;
+        __builtin_memcpy(&tmp1, p1, 8);
+        __builtin_memcpy(&tmp2, p2, 8);
+        __builtin_memcpy(p1, &tmp2, 8);
+        __builtin_memcpy(p2, &tmp1, 8);
         p1 += 8; p2 += 8; size -= 8;
     }
 #elif ARCH_is32BIT
     while (size >= 4) {
-        const u32 tmp = *(u32*)p1;
-        *(u32*)p1 = *(u32*)p2;
-        *(u32*)p2 = tmp;
+        u32 tmp1, tmp2;
+        __builtin_memcpy(&tmp1, p1, 4);
+        __builtin_memcpy(&tmp2, p2, 4);
+        __builtin_memcpy(p1, &tmp2, 4);
+        __builtin_memcpy(p2, &tmp1, 4);
         p1 += 4; p2 += 4; size -= 4;
     }
 #endif
@@ -98,10 +125,413 @@ void memTransfer(void* dst, void* src, const usize size) {
 }
 
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+   Allocators
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void* memAlloc(const Allocator* a, const usize size) {
+    return a->alloc ? a->alloc(a->ctx, size) : malloc(size);
+}
+
+void* memResize(const Allocator* a, void* ptr, const usize oldSize, const usize newSize) {
+    return a->resize ? a->resize(a->ctx, ptr, oldSize, newSize) : realloc(ptr, newSize);
+}
+
+void memFree(const Allocator* a, void* ptr, const usize size) {
+    if (!ptr) return;
+
+    if (a->free) a->free(a->ctx, ptr, size);
+    else free(ptr);
+}
+
+
+MemCounter memCounter_new(const char* name, const Allocator inner) {
+    return (MemCounter) { .name = name, .inner = inner };
+}
+
+static inline
+void _memCounter_add(MemCounter* c, const usize size) {
+    c->live += size;
+    c->total += size;
+    if (c->live > c->peak) c->peak = c->live;
+}
+
+// Blocks go to the inner allocator as they are, sizes come back from the
+// caller, so a counted compile lays out its memory like an uncounted one
+static void* _memCounter_allocFn(void* ctx, const usize size) {
+    MemCounter* c = ctx;
+
+    void* block = memAlloc(&c->inner, size);
+    if (!block) return NULL;
+
+    c->allocs++;
+    _memCounter_add(c, size);
+    return block;
+}
+
+static void* _memCounter_resizeFn(void* ctx, void* ptr, const usize oldSize, const usize newSize) {
+    MemCounter* c = ctx;
+
+    if (!ptr) return _memCounter_allocFn(ctx, newSize);
+
+    void* block = memResize(&c->inner, ptr, oldSize, newSize);
+    if (!block) return NULL;
+
+    c->resizes++;
+
+    // Growth counts as allocated bytes, a shrink only lowers live bytes
+    if (newSize >= oldSize) _memCounter_add(c, newSize - oldSize);
+    else c->live -= oldSize - newSize;
+    return block;
+}
+
+static void _memCounter_freeFn(void* ctx, void* ptr, const usize size) {
+    MemCounter* c = ctx;
+
+    c->frees++;
+    c->live -= size;
+    memFree(&c->inner, ptr, size);
+}
+
+Allocator memCounter_allocator(MemCounter* counter) {
+    return (Allocator) {
+        .alloc = _memCounter_allocFn,
+        .resize = _memCounter_resizeFn,
+        .free = _memCounter_freeFn,
+        .ctx = counter,
+    };
+}
+
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+   Arenas
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#define _ARENA_DEFAULT_BLOCK (64u * 1024u)
+
+typedef enum ArenaBlockKind {
+    _ARENA_HEAP,        // malloc'd
+    _ARENA_MAPPED,      // Page mapping, huge pages where possible
+    _ARENA_FIXED,       // Caller buffer, never freed
+} ArenaBlockKind;
+
+struct ArenaBlock {
+    ArenaBlock* prev;
+    usize size;         // Bytes of the block, this header included
+    ArenaBlockKind kind;
+};
+
+// Data starts after the header, at ARENA_ALIGN
+#define _ARENA_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(usize)(ARENA_ALIGN - 1))
+
+static inline
+u8* _arena_data(ArenaBlock* block) {
+    return (u8*)block + _ARENA_HEADER;
+}
+
+static inline
+u8* _arena_end(ArenaBlock* block) {
+    return (u8*)block + block->size;
+}
+
+// Maps `size` bytes (a multiple of ARENA_HUGE_SIZE) at a huge page boundary
+static inline
+void* _arena_map(const usize size) {
+#if OS_isWINDOWS
+    // Large pages need a privilege most accounts lack, plain pages it is
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    // Over-map by one huge page and trim, so the block is 2 MiB aligned and
+    // transparent huge pages can back all of it
+    u8* raw = mmap(NULL, size + ARENA_HUGE_SIZE, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+
+    u8* start = (u8*)(((uintptr_t)raw + ARENA_HUGE_SIZE - 1) & ~(uintptr_t)(ARENA_HUGE_SIZE - 1));
+    if (start > raw) munmap(raw, (usize)(start - raw));
+    munmap(start + size, (usize)(raw + ARENA_HUGE_SIZE - start));
+
+#   if defined(MADV_HUGEPAGE)
+    madvise(start, size, MADV_HUGEPAGE);
+#   endif
+    return start;
+#endif
+}
+
+static inline
+void _arena_freeBlock(ArenaBlock* block) {
+    if (block->kind == _ARENA_HEAP) free(block);
+    else if (block->kind == _ARENA_MAPPED) {
+#if OS_isWINDOWS
+        VirtualFree(block, 0, MEM_RELEASE);
+#else
+        munmap(block, block->size);
+#endif
+    }
+}
+
+Arena arena_new(const usize blockSize) {
+    return (Arena) { .blockSize = blockSize ? blockSize : _ARENA_DEFAULT_BLOCK };
+}
+
+Arena arena_fixed(void* buffer, const usize size) {
+    Arena arena = { 0 };
+
+    u8* start = (u8*)(((uintptr_t)buffer + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1));
+    const usize lost = (usize)(start - (u8*)buffer);
+    if (!buffer || size < lost + _ARENA_HEADER) return arena;
+
+    ArenaBlock* block = (ArenaBlock*)start;
+    block->prev = NULL;
+    block->size = size - lost;
+    block->kind = _ARENA_FIXED;
+
+    arena.block = block;
+    arena.at = _arena_data(block);
+    arena.end = _arena_end(block);
+    arena.reserved = block->size;
+    return arena;
+}
+
+void* _arena_allocBlock(Arena* arena, const usize size, const usize align) {
+    // A fixed arena is full
+    if (arena->blockSize == 0) return NULL;
+
+    usize bytes = _ARENA_HEADER + size + (align > ARENA_ALIGN ? align : 0);
+    if (bytes < arena->blockSize) bytes = arena->blockSize;
+
+    ArenaBlock* block;
+    ArenaBlockKind kind = _ARENA_HEAP;
+
+    if (bytes >= ARENA_HUGE_SIZE) {
+        bytes = (bytes + ARENA_HUGE_SIZE - 1) & ~(usize)(ARENA_HUGE_SIZE - 1);
+        block = _arena_map(bytes);
+        kind = _ARENA_MAPPED;
+    } else {
+        block = malloc(bytes);
+    }
+
+    if (!block) return NULL;
+
+    block->prev = arena->block;
+    block->size = bytes;
+    block->kind = kind;
+
+    // The tail of the previous block is given up
+    arena->block = block;
+    arena->at = _arena_data(block);
+    arena->end = _arena_end(block);
+    arena->reserved += bytes;
+
+    return arena_allocAligned(arena, size, align);
+}
+
+void* arena_resize(Arena* arena, void* ptr, const usize oldSize, const usize newSize) {
+    if (!ptr) return arena_alloc(arena, newSize);
+
+    if ((u8*)ptr == arena->last && (usize)(arena->end - (u8*)ptr) >= newSize) {
+        arena->used = arena->used - oldSize + newSize;
+        arena->at = (u8*)ptr + newSize;
+        return ptr;
+    }
+
+    if (newSize <= oldSize) return ptr;
+
+    void* moved = arena_alloc(arena, newSize);
+    if (moved) memcpy(moved, ptr, oldSize);
+    return moved;
+}
+
+void arena_rewind(Arena* arena, const ArenaMark mark) {
+    while (arena->block != mark.block) {
+        ArenaBlock* block = arena->block;
+        arena->block = block->prev;
+        arena->reserved -= block->size;
+        _arena_freeBlock(block);
+    }
+
+    arena->at = mark.at;
+    arena->end = mark.block ? _arena_end(mark.block) : NULL;
+    arena->used = mark.used;
+    arena->last = NULL;
+}
+
+void arena_reset(Arena* arena) {
+    if (!arena->block) return;
+
+    ArenaBlock* first = arena->block;
+    while (first->prev) first = first->prev;
+
+    arena_rewind(arena, (ArenaMark) { .block = first, .at = _arena_data(first), .used = 0 });
+}
+
+void arena_release(Arena* arena) {
+    arena_reset(arena);
+
+    // A caller buffer stays, the arena is then just empty
+    if (arena->block && arena->block->kind != _ARENA_FIXED) {
+        _arena_freeBlock(arena->block);
+        arena->block = NULL;
+        arena->at = arena->end = NULL;
+        arena->reserved = 0;
+    }
+}
+
+static void* _arena_allocFn(void* ctx, const usize size) {
+    return arena_alloc(ctx, size);
+}
+
+static void* _arena_resizeFn(void* ctx, void* ptr, const usize oldSize, const usize newSize) {
+    return arena_resize(ctx, ptr, oldSize, newSize);
+}
+
+static void _arena_freeFn(void* ctx, void* ptr, const usize size) {
+    Arena* arena = ctx;
+
+    // Only the newest allocation can be given back
+    if ((u8*)ptr == arena->last && (u8*)ptr + size == arena->at) {
+        arena->at = ptr;
+        arena->used -= size;
+        arena->last = NULL;
+    }
+}
+
+Allocator arena_allocator(Arena* arena) {
+    return (Allocator) {
+        .alloc = _arena_allocFn,
+        .resize = _arena_resizeFn,
+        .free = _arena_freeFn,
+        .ctx = arena,
+    };
+}
+
+
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
    Bit-Level Memory Operations
    ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+// The bit stream is big-endian: byte 0 holds the highest bits, so words are
+// loaded and stored big-endian and shift as one 64-bit number
+static inline
+u64 _mem_loadBE64(const u8* p) {
+    u64 w;
+    __builtin_memcpy(&w, p, 8);
+#if OS_LITTLE_ENDIAN
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+static inline
+void _mem_storeBE64(u8* p, u64 w) {
+#if OS_LITTLE_ENDIAN
+    w = __builtin_bswap64(w);
+#endif
+    __builtin_memcpy(p, &w, 8);
+}
+
+// Shifts `size` bytes left by `s` bits (1..7), `next` is the byte that
+// follows the last one. Runs front to back, each step reads one byte past
+// what it writes, before that byte is overwritten.
+static void _mem_bitShlBytes(u8* p, const usize size, const u32 s, const u8 next) {
+    usize i = 0;
+
+#if MEM_SSE2
+    // SSE2 has no byte shifts: shift 16-bit lanes and mask off the bits
+    // that crossed into the neighbour byte
+    const __m128i count = _mm_cvtsi32_si128((int)s);
+    const __m128i back = _mm_cvtsi32_si128((int)(8 - s));
+    const __m128i highMask = _mm_set1_epi8((char)(0xFF << s));
+    const __m128i lowMask = _mm_set1_epi8((char)(0xFF >> (8 - s)));
+
+    for (; i + 17 <= size; i += 16) {
+        const __m128i cur = _mm_loadu_si128((const __m128i*)(p + i));
+        const __m128i nxt = _mm_loadu_si128((const __m128i*)(p + i + 1));
+
+        const __m128i high = _mm_and_si128(_mm_sll_epi16(cur, count), highMask);
+        const __m128i low = _mm_and_si128(_mm_srl_epi16(nxt, back), lowMask);
+        _mm_storeu_si128((__m128i*)(p + i), _mm_or_si128(high, low));
+    }
+#endif
+
+    for (; i + 9 <= size; i += 8)
+        _mem_storeBE64(p + i, (_mem_loadBE64(p + i) << s) | (u64)(p[i + 8] >> (8 - s)));
+
+    for (; i + 1 < size; ++i)
+        p[i] = (u8)((p[i] << s) | (p[i + 1] >> (8 - s)));
+
+    p[size - 1] = (u8)((p[size - 1] << s) | (next >> (8 - s)));
+}
+
+// Shifts `size` bytes right by `s` bits (1..7), `prev` is the byte before
+// the first one. Runs back to front, the mirror of _mem_bitShlBytes.
+static void _mem_bitShrBytes(u8* p, const usize size, const u32 s, const u8 prev) {
+    usize i = size;  // Bytes [i, size) are done
+
+#if MEM_SSE2
+    const __m128i count = _mm_cvtsi32_si128((int)s);
+    const __m128i back = _mm_cvtsi32_si128((int)(8 - s));
+    const __m128i lowMask = _mm_set1_epi8((char)(0xFF >> s));
+    const __m128i highMask = _mm_set1_epi8((char)(0xFF << (8 - s)));
+
+    for (; i >= 17; i -= 16) {
+        const __m128i cur = _mm_loadu_si128((const __m128i*)(p + i - 16));
+        const __m128i prv = _mm_loadu_si128((const __m128i*)(p + i - 17));
+
+        const __m128i low = _mm_and_si128(_mm_srl_epi16(cur, count), lowMask);
+        const __m128i high = _mm_and_si128(_mm_sll_epi16(prv, back), highMask);
+        _mm_storeu_si128((__m128i*)(p + i - 16), _mm_or_si128(low, high));
+    }
+#endif
+
+    for (; i >= 9; i -= 8)
+        _mem_storeBE64(p + i - 8, (_mem_loadBE64(p + i - 8) >> s) | ((u64)p[i - 9] << (64 - s)));
+
+    for (; i > 1; --i)
+        p[i - 1] = (u8)((p[i - 1] >> s) | (p[i - 2] << (8 - s)));
+
+    p[0] = (u8)((p[0] >> s) | (prev << (8 - s)));
+}
+
+// Largest side a byte rotation moves through the stack
+#define _MEM_ROTATE_STACK 256
+
+// Rotates `size` bytes left by `k` bytes in place. Each block swap puts one
+// side in its final place, once a side fits the stack buffer the rest is a
+// single memmove.
+static void _mem_rotateBytesLeft(u8* p, usize size, usize k) {
+    u8 tmp[_MEM_ROTATE_STACK];
+
+    while (k && k < size) {
+        const usize m = size - k;
+
+        if (k <= _MEM_ROTATE_STACK) {
+            memCopy(tmp, p, k);
+            memMove(p, p + k, m);
+            memCopy(p + m, tmp, k);
+            return;
+        }
+        if (m <= _MEM_ROTATE_STACK) {
+            memCopy(tmp, p + k, m);
+            memMove(p + m, p, k);
+            memCopy(p, tmp, m);
+            return;
+        }
+
+        if (k <= m) {
+            // A B1 B2 -> B2 B1 A, then rotate B2 B1 by k
+            memSwap(p, p + m, k);
+            size = m;
+        } else {
+            // A1 A2 B -> B A2 A1, then rotate A2 A1 by k - m
+            memSwap(p, p + k, m);
+            p += m;
+            size = k;
+            k -= m;
+        }
+    }
+}
+
 void memBitShl(void* data, usize bits, const usize size) {
     if (!size) return;
 
@@ -111,20 +541,15 @@ void memBitShl(void* data, usize bits, const usize size) {
     u8* p = (u8*)data;
 
     const usize byteShift = bits >> 3;
-    const usize bitShift  = bits & 7;
+    const u32 bitShift = (u32)(bits & 7);
 
     if (byteShift) {
         memMove(p, p + byteShift, size - byteShift);
         memSet(p + size - byteShift, 0, byteShift);
     }
 
-    if (bitShift) {
-        for (usize i = 0; i < size - 1; ++i) {
-            p[i] = (u8)((p[i] << bitShift) |
-                        (p[i + 1] >> (8 - bitShift)));
-        }
-        p[size - 1] <<= bitShift;
-    }
+    // The vacated tail is already zero
+    if (bitShift) _mem_bitShlBytes(p, size - byteShift, bitShift, 0);
 }
 
 void memBitShr(void* data, usize bits, const usize size) {
@@ -136,20 +561,14 @@ void memBitShr(void* data, usize bits, const usize size) {
     u8* p = (u8*)data;
 
     const usize byteShift = bits >> 3;
-    const usize bitShift  = bits & 7;
+    const u32 bitShift = (u32)(bits & 7);
 
     if (byteShift) {
         memMove(p + byteShift, p, size - byteShift);
         memSet(p, 0, byteShift);
     }
 
-    if (bitShift) {
-        for (usize i = size - 1; i > 0; --i) {
-            p[i] = (u8)((p[i] >> bitShift) |
-                        (p[i - 1] << (8 - bitShift)));
-        }
-        p[0] >>= bitShift;
-    }
+    if (bitShift) _mem_bitShrBytes(p + byteShift, size - byteShift, bitShift, 0);
 }
 
 void memBitRol(void* data, usize rotate, const usize size) {
@@ -159,24 +578,12 @@ void memBitRol(void* data, usize rotate, const usize size) {
     if (!rotate) return;
 
     u8* p = (u8*)data;
+    const u32 bitShift = (u32)(rotate & 7);
 
-    u8 stackBuf[256];
-    u8* tmp = (size <= sizeof(stackBuf))
-        ? stackBuf
-        : (u8*)malloc(size);
-
-    if (!tmp) return;
-
-    __builtin_memcpy(tmp, p, size);
-
-    memBitShl(p, rotate, size);
-    memBitShr(tmp, (size * 8) - rotate, size);
-
-    for (usize i = 0; i < size; ++i)
-        p[i] |= tmp[i];
+    _mem_rotateBytesLeft(p, size, rotate >> 3);
 
-    if (tmp != stackBuf)
-        free(tmp);
+    // The first byte wraps around behind the last one
+    if (bitShift) _mem_bitShlBytes(p, size, bitShift, p[0]);
 }
 
 void memBitRor(void* data, usize rotate, const usize size) {
@@ -186,22 +593,11 @@ void memBitRor(void* data, usize rotate, const usize size) {
     if (!rotate) return;
 
     u8* p = (u8*)data;
+    const usize byteShift = rotate >> 3;
+    const u32 bitShift = (u32)(rotate & 7);
 
-    u8 stackBuf[256];
-    u8* tmp = (size <= sizeof(stackBuf))
-        ? stackBuf
-        : (u8*)malloc(size);
-
-    if (!tmp) return;
-
-    __builtin_memcpy(tmp, p, size);
-
-    memBitShr(p, rotate, size);
-    memBitShl(tmp, (size * 8) - rotate, size);
-
-    for (usize i = 0; i < size; ++i)
-        p[i] |= tmp[i];
+    if (byteShift) _mem_rotateBytesLeft(p, size, size - byteShift);
 
-    if (tmp != stackBuf)
-        free(tmp);
+    // The last byte wraps around in front of the first one
+    if (bitShift) _mem_bitShrBytes(p, size, bitShift, p[size - 1]);
 }
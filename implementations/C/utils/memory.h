@@ -2,6 +2,8 @@
 
 #include "short-types.h"
 
+#include <stddef.h>
+
 typedef struct mem_t {
     void* address;
     usize size;
@@ -113,6 +115,178 @@ void* memCloneWith(const void* src, usize size, void* (*alloc)(usize));
 void memTransfer(void* dst, void* src, usize size);
 
 
+/* ============================================================
+   Allocators
+   ============================================================ */
+
+/**
+ * Where a container gets its memory from.
+ *
+ * Containers (TokenStore, AstArena, ErrorReporter) keep one by value and
+ * pass sizes back on resize and free, so arena-style allocators need no
+ * bookkeeping of their own. The zero value `mem_heap` is malloc/free.
+ */
+typedef struct Allocator {
+    void* (*alloc)(void* ctx, usize size);
+    void* (*resize)(void* ctx, void* ptr, usize oldSize, usize newSize);
+    void (*free)(void* ctx, void* ptr, usize size);
+    void* ctx;
+} Allocator;
+
+#define mem_heap ((Allocator) { 0 })
+
+/**
+ * Allocates `size` bytes from `a`.
+ *
+ * @return New block, or NULL on failure.
+ */
+void* memAlloc(const Allocator* a, usize size);
+
+/**
+ * Resizes a block from `a` to `newSize` bytes, keeping the first
+ * min(oldSize, newSize) bytes. May move it.
+ *
+ * @return Resized block, or NULL on failure (the old block stays valid).
+ */
+void* memResize(const Allocator* a, void* ptr, usize oldSize, usize newSize);
+
+/**
+ * Returns a block of `size` bytes to `a`. NULL is ignored.
+ */
+void memFree(const Allocator* a, void* ptr, usize size);
+
+
+/**
+ * Counts what goes through an allocator, for one subsystem.
+ *
+ * Sizes are the ones callers pass back on resize and free (see
+ * Allocator), nothing is added to the blocks, so counting does not change
+ * how much of an arena a compile uses.
+ */
+typedef struct MemCounter {
+    const char* name;
+    Allocator inner;        // Where the memory really comes from
+    usize live;             // Bytes allocated and not freed
+    usize peak;             // Most live bytes at any time
+    usize total;            // Bytes ever allocated, growth by resize included
+    u32 allocs;
+    u32 resizes;            // Regrowths (and shrinks) of existing blocks
+    u32 frees;
+} MemCounter;
+
+// Counter named `name` over `inner`
+MemCounter memCounter_new(const char* name, Allocator inner);
+
+// Allocator that counts into `counter`, which must outlive what it hands out
+Allocator memCounter_allocator(MemCounter* counter);
+
+
+/* ============================================================
+   Arenas
+   ============================================================ */
+
+// Alignment of arena_alloc, enough for any scalar and SSE vector
+#define ARENA_ALIGN 16
+
+// Blocks at least this big are mapped and backed by huge pages if the
+// system allows it
+#define ARENA_HUGE_SIZE (2u * 1024u * 1024u)
+
+typedef struct ArenaBlock ArenaBlock;
+
+/**
+ * Bump allocator: allocation is a pointer increment, freeing happens all
+ * at once by rewinding to a mark, resetting or releasing the arena.
+ *
+ * Growable arenas append blocks of at least `blockSize` bytes, earlier
+ * blocks never move. A fixed arena lives in a caller buffer and fails
+ * allocations once it is full, which caps what a compile may use.
+ */
+typedef struct Arena {
+    ArenaBlock* block;      // Current block, older ones chained behind it
+    u8* at;                 // Next free byte of the current block
+    u8* end;                // End of the current block
+    u8* last;               // Start of the newest allocation, resized in place
+    usize blockSize;        // Minimum size of appended blocks, 0 when fixed
+    usize used;             // Bytes handed out, alignment padding included
+    usize reserved;         // Bytes of all blocks
+} Arena;
+
+// Position to rewind to, valid while the arena is not rewound past it
+typedef struct ArenaMark {
+    ArenaBlock* block;
+    u8* at;
+    usize used;
+} ArenaMark;
+
+/**
+ * Growable arena. The first block is allocated on first use.
+ *
+ * @param blockSize  Minimum block size, 0 picks a default. Sizing it for the
+ *                   whole compile keeps it in one (huge-page) block.
+ */
+Arena arena_new(usize blockSize);
+
+/**
+ * Arena inside `buffer`, which the caller owns and which must outlive it.
+ * Allocations fail once `size` bytes are used.
+ */
+Arena arena_fixed(void* buffer, usize size);
+
+// Slow path of arena_allocAligned: appends a block for the allocation
+void* _arena_allocBlock(Arena* arena, usize size, usize align);
+
+/**
+ * Allocates `size` bytes aligned to `align` (a power of two).
+ *
+ * @return New block, or NULL if the arena is fixed and full or memory ran out.
+ */
+static inline
+void* arena_allocAligned(Arena* arena, const usize size, const usize align) {
+    u8* at = (u8*)(((uintptr_t)arena->at + (align - 1)) & ~(uintptr_t)(align - 1));
+
+    // Aligning can step past the end of a nearly full block
+    if (arena->block == NULL || at > arena->end || (usize)(arena->end - at) < size)
+        return _arena_allocBlock(arena, size, align);
+
+    arena->used += (usize)(at - arena->at) + size;
+    arena->at = at + size;
+    arena->last = at;
+    return at;
+}
+
+// Allocates `size` bytes aligned to ARENA_ALIGN
+static inline
+void* arena_alloc(Arena* arena, const usize size) {
+    return arena_allocAligned(arena, size, ARENA_ALIGN);
+}
+
+/**
+ * Resizes a block from the arena. The newest allocation grows or shrinks
+ * in place while its block has room, anything else is copied.
+ */
+void* arena_resize(Arena* arena, void* ptr, usize oldSize, usize newSize);
+
+// Current position, for arena_rewind
+static inline
+ArenaMark arena_mark(const Arena* arena) {
+    return (ArenaMark) { .block = arena->block, .at = arena->at, .used = arena->used };
+}
+
+// Frees everything allocated after `mark`, blocks appended since included
+void arena_rewind(Arena* arena, ArenaMark mark);
+
+// Frees every allocation, keeps the first block for reuse
+void arena_reset(Arena* arena);
+
+// Frees every block, the arena can be used again afterwards
+void arena_release(Arena* arena);
+
+// Allocator handing out memory from `arena`, free only rolls back the
+// newest allocation
+Allocator arena_allocator(Arena* arena);
+
+
 /* ============================================================
    Bit-Level Memory Operations
    ============================================================ */
@@ -122,6 +296,7 @@ void memTransfer(void* dst, void* src, usize size);
  *
  * Entire buffer is treated as a contiguous big-endian bit stream.
  * Vacated bits are filled with zero.
+ * Shifts 64-bit words at a time, 16 bytes with SSE2.
  *
  * @param data   Target buffer.
  * @param bits   Number of bits to shift.
@@ -134,6 +309,7 @@ void memBitShl(void* data, usize bits, usize size);
  *
  * Entire buffer is treated as a contiguous big-endian bit stream.
  * Vacated bits are filled with zero.
+ * Shifts 64-bit words at a time, 16 bytes with SSE2.
  *
  * @param data   Target buffer.
  * @param bits   Number of bits to shift.
@@ -146,6 +322,7 @@ void memBitShr(void* data, usize bits, usize size);
  *
  * Entire buffer is treated as a contiguous big-endian bit stream.
  * Bits shifted out of the high end re-enter at the low end.
+ * Rotates in place, without scratch memory.
  *
  * @param data    Target buffer.
  * @param rotate  Number of bits to rotate.
@@ -158,6 +335,7 @@ void memBitRol(void* data, usize rotate, usize size);
  *
  * Entire buffer is treated as a contiguous big-endian bit stream.
  * Bits shifted out of the low end re-enter at the high end.
+ * Rotates in place, without scratch memory.
  *
  * @param data    Target buffer.
  * @param rotate  Number of bits to rotate.
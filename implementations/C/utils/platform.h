@@ -281,6 +281,7 @@
 #define ARCH_HAS_SSSE3 0
 #define ARCH_HAS_SSE4_1 0
 #define ARCH_HAS_SSE4_2 0
+#define ARCH_HAS_AVX2 0
 #define ARCH_HAS_NEON 0
 #define ARCH_HAS_AES 0
 #define ARCH_HAS_CRC32 0
@@ -494,6 +495,12 @@
 #   error "Unsupported or unknown architecture"
 #endif
 
+// AVX2 is opt-in at compile time (-mavx2 / -march=native)
+#if ARCH_FAMILY_X86 && defined(__AVX2__)
+#   undef ARCH_HAS_AVX2
+#   define ARCH_HAS_AVX2 1
+#endif
+
 // Helper macros for checking architecture and bitness (these work anywhere)
 #define ARCH_is64BIT (ARCH_64BIT)
 #define ARCH_is32BIT (ARCH_32BIT)
@@ -537,6 +544,7 @@
 #define ARCH_hasSSSE3      (ARCH_HAS_SSSE3)
 #define ARCH_hasSSE4_1     (ARCH_HAS_SSE4_1)
 #define ARCH_hasSSE4_2     (ARCH_HAS_SSE4_2)
+#define ARCH_hasAVX2       (ARCH_HAS_AVX2)
 #define ARCH_hasNEON       (ARCH_HAS_NEON)
 #define ARCH_hasAES        (ARCH_HAS_AES)
 #define ARCH_hasCRC32      (ARCH_HAS_CRC32)
@@ -5,34 +5,59 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+// Formats into one exact-size buffer of `length + 1` bytes, NUL terminated
+static inline
+char* _string_format(const Allocator* allocator, const char* format, va_list args, i32* length) {
+    va_list again;
+    va_copy(again, args);
+
+    const i32 len = vsnprintf(NULL, 0, format, args);
+    char* str = len >= 0 ? memAlloc(allocator, (usize)len + 1) : NULL;
+    if (str) vsnprintf(str, (usize)len + 1, format, again);
+
+    va_end(again);
+    *length = str ? len : 0;
+    return str;
+}
+
 str_t str_build(const u32 length, const char* data, ...) {
-    char* buf = malloc(length + 1024);
+    (void)length;
 
     va_list args;
     va_start(args, data);
 
-    const i32 len = vsnprintf(buf, sizeof(buf), data, args);
+    const Allocator heap = mem_heap;
+    i32 len;
+    const char* str = _string_format(&heap, data, args, &len);
 
     va_end(args);
 
-    const char* str = memClone(buf, len);
-    free(buf);
-
     return (str_t){ .data = str, .length = (u32)len };
 }
 
 string_t string_build(const u32 length, char* data, ...) {
-    char* buf = malloc(length + 1024);
+    (void)length;
 
     va_list args;
     va_start(args, data);
 
-    const i32 len = vsnprintf(buf, sizeof(buf), data, args);
+    const Allocator heap = mem_heap;
+    i32 len;
+    char* str = _string_format(&heap, data, args, &len);
 
     va_end(args);
 
-    char* str = memClone(buf, len);
-    free(buf);
+    return (string_t){ .data = str, .length = (u32)len };
+}
+
+string_t string_buildWith(const Allocator* allocator, const char* data, ...) {
+    va_list args;
+    va_start(args, data);
+
+    i32 len;
+    char* str = _string_format(allocator, data, args, &len);
+
+    va_end(args);
 
     return (string_t){ .data = str, .length = (u32)len };
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "short-types.h"
+#include "memory.h"
 
 typedef struct str_t {
     const char* data;
@@ -37,5 +38,8 @@ string_t string_new(char* data, const u32 length) {
 str_t str_build(u32 length, const char* data, ...);
 string_t string_build(u32 length, char* data, ...);
 
+// string_build into `length + 1` bytes from `allocator`
+string_t string_buildWith(const Allocator* allocator, const char* data, ...);
+
 #define str_b(str, ...) str_build(sizeof(str) - 1, str, __VA_ARGS__)
 #define string_b(str, ...) string_build(sizeof(str) - 1, str, __VA_ARGS__)
\ No newline at end of file
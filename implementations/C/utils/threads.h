@@ -0,0 +1,78 @@
+#pragma once
+
+#include "short-types.h"
+
+#if OS_isWINDOWS
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#   include <unistd.h>
+#endif
+
+// Body of a thread
+typedef void (*ThreadFn)(void* arg);
+
+// Must stay in place from thread_start until thread_join
+typedef struct Thread {
+#if OS_isWINDOWS
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    ThreadFn fn;
+    void* arg;
+} Thread;
+
+#if OS_isWINDOWS
+
+static DWORD WINAPI _thread_entry(LPVOID t) {
+    ((Thread*)t)->fn(((Thread*)t)->arg);
+    return 0;
+}
+
+#else
+
+static void* _thread_entry(void* t) {
+    ((Thread*)t)->fn(((Thread*)t)->arg);
+    return NULL;
+}
+
+#endif
+
+// Runs fn(arg) on a new thread, false if the thread could not be created
+static inline
+bool thread_start(Thread* t, const ThreadFn fn, void* arg) {
+    t->fn = fn;
+    t->arg = arg;
+
+#if OS_isWINDOWS
+    t->handle = CreateThread(NULL, 0, _thread_entry, t, 0, NULL);
+    return t->handle != NULL;
+#else
+    return pthread_create(&t->handle, NULL, _thread_entry, t) == 0;
+#endif
+}
+
+// Waits for the thread to finish
+static inline
+void thread_join(const Thread* t) {
+#if OS_isWINDOWS
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+#else
+    pthread_join(t->handle, NULL);
+#endif
+}
+
+// Logical processors available, at least 1
+static inline
+u32 thread_hardwareCount(void) {
+#if OS_isWINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? (u32)info.dwNumberOfProcessors : 1;
+#else
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (u32)n : 1;
+#endif
+}